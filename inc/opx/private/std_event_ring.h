@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_event_ring.h
+ */
+
+/*
+ * Shared memory ring used to deliver events from the event service to a
+ * subscriber on the same box without a socket write per event.
+ *
+ * The ring lives in a memfd created by the server and passed to the client
+ * with an eventfd doorbell over the client's socket.  There is one producer
+ * (the server, serialized by the ring's lock since the server publishes from
+ * several threads) and one consumer (the client).  Each record is a 32 bit
+ * length followed by the same event_serv_msg_t + std_event_msg_t + data that
+ * would be sent on the socket.  The doorbell is only written when the
+ * consumer has said it is about to sleep.
+ */
+
+#ifndef STD_EVENT_RING_H_
+#define STD_EVENT_RING_H_
+
+#include "std_error_codes.h"
+#include "std_mutex_lock.h"
+
+#include <sys/uio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* ring sizes are a power of 2 between these */
+#define STD_EVENT_RING_MIN_SIZE (64*1024)
+#define STD_EVENT_RING_MAX_SIZE (64*1024*1024)
+
+struct std_event_ring_hdr_t;
+
+struct std_event_ring_t {
+    std_event_ring_hdr_t *hdr;
+    uint8_t *data;
+    size_t size;        /* bytes of record space */
+    size_t map_len;
+    int mem_fd;
+    int bell_fd;
+    std_mutex_type_t lock;  /* serializes producers */
+};
+
+/**
+ * @brief create a ring in a new memfd (server side)
+ * @param size the requested record space, rounded up to a power of 2 and
+ *      limited to STD_EVENT_RING_MIN_SIZE..STD_EVENT_RING_MAX_SIZE
+ * @param ring set to the new ring
+ * @return STD_ERR_OK or an error if the memory or fds could not be created
+ */
+t_std_error std_event_ring_create(size_t size, std_event_ring_t **ring);
+
+/**
+ * @brief map a ring created by std_event_ring_create (client side).  Takes
+ * ownership of the fds, also on failure
+ * @param mem_fd the ring's memfd
+ * @param bell_fd the ring's eventfd
+ * @param ring set to the ring
+ * @return STD_ERR_OK or an error if the memory is not a valid ring
+ */
+t_std_error std_event_ring_attach(int mem_fd, int bell_fd, std_event_ring_t **ring);
+
+/**
+ * @brief unmap the ring and close its fds
+ */
+void std_event_ring_free(std_event_ring_t *ring);
+
+/**
+ * @brief add one record made of the iovecs to the ring, waiting up to
+ * timeout ms for space.  Thread safe against other writers
+ * @return STD_ERR_OK, STD_ERR(COM,TOOBIG,0) if the record can never fit or
+ *      STD_ERR(COM,FAIL,0) if the consumer didn't make space in time
+ */
+t_std_error std_event_ring_write(std_event_ring_t *ring, const struct iovec *iov,
+        size_t iov_len, size_t timeout);
+
+/**
+ * @brief copy the next record to buff at offset without waiting
+ * @param len set to the length of the record
+ * @return STD_ERR_OK, STD_ERR(COM,NEXIST,0) if the ring is empty or
+ *      STD_ERR(COM,TOOBIG,0) if the record didn't fit and was dropped
+ */
+t_std_error std_event_ring_take(std_event_ring_t *ring, std::vector<uint8_t> &buff,
+        size_t offset, bool allow_resize, size_t *len);
+
+/**
+ * @brief wait until the ring has a record or sock is readable (sock_ready)
+ */
+t_std_error std_event_ring_wait(std_event_ring_t *ring, int sock, bool *sock_ready);
+
+/**
+ * @brief take the next record from the ring into buff.  If the ring is empty
+ * wait on the doorbell and on sock.  If sock becomes readable while the ring
+ * is empty (a message that was too big for the ring, or the server went
+ * away) sock_ready is set and the socket is left for the caller to read
+ * @param ring the ring
+ * @param sock the client's socket
+ * @param buff the record is copied to the start.  The buffer is grown if
+ *      needed but never shrunk
+ * @param allow_resize if false a record larger than buff is dropped and
+ *      STD_ERR(COM,TOOBIG,0) is returned
+ * @param sock_ready set to true if the caller needs to read the socket
+ * @return STD_ERR_OK when a record was read or sock_ready is set
+ */
+t_std_error std_event_ring_read(std_event_ring_t *ring, int sock,
+        std::vector<uint8_t> &buff, bool allow_resize, bool *sock_ready);
+
+/**
+ * @brief send a message with the ring's fds attached
+ */
+t_std_error std_event_ring_send_fds(int sock, std_event_ring_t *ring,
+        const void *data, size_t len);
+
+/**
+ * @brief receive exactly len bytes of a message sent with
+ * std_event_ring_send_fds and the fds attached to it, waiting up to timeout ms
+ */
+t_std_error std_event_ring_recv_fds(int sock, void *data, size_t len,
+        int *mem_fd, int *bell_fd, size_t timeout);
+
+#endif /* STD_EVENT_RING_H_ */
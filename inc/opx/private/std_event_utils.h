@@ -40,6 +40,20 @@ enum event_serv_msg_types_t {
     event_serv_msg_t_DEL_REG,
     event_serv_msg_t_PUBLISH,
     event_serv_msg_t_BUFFER,
+    event_serv_msg_t_SHM_RING,  /* ask for events through a std_event_ring_t */
+    event_serv_msg_t_SHM_RING_USE, /* the client has mapped the ring it was sent */
+};
+
+/* header at the start of every message on the socket */
+struct std_event_ipc_hdr_t {
+    uint32_t size;
+    uint32_t version;
+};
+
+struct std_event_ipc_data_t {
+    std_event_ipc_hdr_t hdr;
+    uint32_t version;
+    uint32_t size;      /* bytes that follow the header */
 };
 
 struct event_serv_msg_t {
@@ -64,4 +78,29 @@ t_std_error std_event_util_event_recv(std_event_client_handle handle,
 t_std_error std_event_util_event_recv_msg(std_event_client_handle handle,
         std_event_msg_t *msg, void * data, size_t len) ;
 
+/* append the framed message to out - what std_event_util_event_send would write */
+t_std_error std_event_util_event_frame(std::vector<uint8_t> &out,
+        event_serv_msg_t *msg, std_event_msg_descr_t *data, size_t len);
+
+/* write out the whole buffer (one or more frames) */
+t_std_error std_event_util_write(std_event_client_handle handle, const void *data,
+        size_t len, size_t timeout);
+
+/*
+ * find the next complete frame in stream[start,end).  On success payload and
+ * len describe what follows the frame header and start is moved past the
+ * frame.  Returns STD_ERR(COM,NEXIST,0) if the frame isn't all there yet and
+ * need is set to the bytes the whole frame takes
+ */
+t_std_error std_event_util_event_next(std::vector<uint8_t> &stream, size_t &start,
+        size_t end, uint8_t **payload, size_t *len, size_t *need);
+
+/*
+ * block until the socket has data and read as much as fits into
+ * stream[end,stream.size()), moving any unread bytes to the front first and
+ * growing the stream so that it can hold at least need bytes
+ */
+t_std_error std_event_util_event_fill(std_event_client_handle handle,
+        std::vector<uint8_t> &stream, size_t &start, size_t &end, size_t need);
+
 #endif /* STD_EVENT_UTILS_H_ */
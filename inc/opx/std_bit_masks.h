@@ -153,6 +153,238 @@ int std_find_first_bit(void *array, size_t len, size_t from) ;
  */
 int std_find_last_bit(void *varray, size_t len, size_t from);
 
+/**
+ * Find the first bit set to 0 in the array of bits.
+ * @param array the array of bits
+ * @param len the length of array in bits
+ * @param from starting from a specific bit position in the range 0 to len-1
+ * @return -1 if all bits from 'from' to len-1 are set otherwise the bit position
+ */
+int std_find_first_zero_bit(void *array, size_t len, size_t from);
+
+/**
+ * Find the next bit set to 1 after a bit.  Use it to walk the set bits
+@verbatim
+for (int bit = std_find_next_set_bit(a,len,-1); bit >= 0;
+        bit = std_find_next_set_bit(a,len,bit)) { ... }
+@endverbatim
+ * @param array the array of bits
+ * @param len the length of array in bits
+ * @param prev the last bit found or -1 to start at bit 0
+ * @return -1 if there are no more set bits below len otherwise the bit position
+ */
+int std_find_next_set_bit(void *array, size_t len, int prev);
+
+/**
+ * Bulk operations on whole bit arrays.  dst can be the same array as a or b.
+ * The and/or/xor/andnot operations work on whole bytes so the bits of the
+ * last byte past len are combined too, the tests and the count ignore them.
+ */
+
+/**
+ * dst = a & b
+ * @param dst the result array
+ * @param a the first array
+ * @param b the second array
+ * @param len the length of the arrays in bits
+ */
+void std_bitmap_and(void *dst, const void *a, const void *b, size_t len);
+
+/**
+ * dst = a | b
+ * @param dst the result array
+ * @param a the first array
+ * @param b the second array
+ * @param len the length of the arrays in bits
+ */
+void std_bitmap_or(void *dst, const void *a, const void *b, size_t len);
+
+/**
+ * dst = a ^ b
+ * @param dst the result array
+ * @param a the first array
+ * @param b the second array
+ * @param len the length of the arrays in bits
+ */
+void std_bitmap_xor(void *dst, const void *a, const void *b, size_t len);
+
+/**
+ * dst = a & ~b - the bits of a that are not in b
+ * @param dst the result array
+ * @param a the first array
+ * @param b the second array
+ * @param len the length of the arrays in bits
+ */
+void std_bitmap_andnot(void *dst, const void *a, const void *b, size_t len);
+
+/**
+ * Count the set bits
+ * @param array the array of bits
+ * @param len the length of the array in bits
+ * @return the number of bits set
+ */
+size_t std_bitmap_popcount(const void *array, size_t len);
+
+/**
+ * Check if two arrays have any set bit in common
+ * @param a the first array
+ * @param b the second array
+ * @param len the length of the arrays in bits
+ * @return true if a & b is not empty
+ */
+bool std_bitmap_intersects(const void *a, const void *b, size_t len);
+
+/**
+ * Check if all of the bits set in a are also set in b
+ * @param a the first array
+ * @param b the second array
+ * @param len the length of the arrays in bits
+ * @return true if a is a subset of b
+ */
+bool std_bitmap_is_subset(const void *a, const void *b, size_t len);
+
+/**
+ * Check if two arrays have the same bits set
+ * @param a the first array
+ * @param b the second array
+ * @param len the length of the arrays in bits
+ * @return true if they are equal
+ */
+bool std_bitmap_equal(const void *a, const void *b, size_t len);
+
+/**
+ * Get the positions of the set bits a batch at a time
+@verbatim
+size_t from = 0;
+uint32_t pos[64];
+size_t n;
+while ((n = std_bitmap_get_set_bits(ports,len,&from,pos,64)) > 0) {
+    for (size_t ix = 0; ix < n ; ++ix) ... pos[ix] ...
+}
+@endverbatim
+ * @param array the array of bits
+ * @param len the length of the array in bits
+ * @param from [in/out] the bit to start at - updated to where the next call carries on
+ * @param positions filled in with the set bit positions in ascending order
+ * @param max the size of positions
+ * @return the number of positions filled in - 0 when there are no more
+ */
+size_t std_bitmap_get_set_bits(const void *array, size_t len, size_t *from,
+        uint32_t *positions, size_t max);
+
+/**
+ * Atomic bit operations.  These work on 64 bit words with the same bit numbering
+ * as the STD_BIT_ARRAY macros so an atomic array can still be read with them
+ * and the scan functions above.  The array must be 64 bit aligned and a whole
+ * number of words long - create it with STD_BIT_ARRAY_ATOMIC_CREATE or
+ * std_bitmap_create_atomic_array.
+ *
+ * The order parameter is the memory ordering of the operation, one of the gcc
+ * __ATOMIC_RELAXED, __ATOMIC_ACQUIRE, __ATOMIC_RELEASE, __ATOMIC_ACQ_REL
+ * or __ATOMIC_SEQ_CST constants (loads can't be release, stores can't be acquire)
+ */
+
+/**
+ * The number of 64 bit words needed for numbits
+ */
+#define STD_BIT_ARRAY_ATOMIC_WORDS(numbits) \
+    (((numbits)+63)/64)
+
+/**
+ * Create a bit array that can be used with the atomic operations
+ */
+#define STD_BIT_ARRAY_ATOMIC_CREATE(name, numbits) \
+    uint64_t name[STD_BIT_ARRAY_ATOMIC_WORDS(numbits)]
+
+static inline uint64_t * std_bit_atomic_word(void *array, size_t bit) {
+    return (uint64_t*)array + bit/64;
+}
+
+/* the mask of the bit in its word - on big endian byte 0 is the top of the word */
+static inline uint64_t std_bit_atomic_mask(size_t bit) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return 1ULL << (bit%64);
+#else
+    return 1ULL << ((7 - (bit/8)%8)*8 + bit%8);
+#endif
+}
+
+/**
+ * Atomically set a bit
+ * @param array the atomic bit array
+ * @param bit the bit to set
+ * @param order the memory ordering
+ */
+static inline void std_bit_atomic_set(void *array, size_t bit, int order) {
+    __atomic_fetch_or(std_bit_atomic_word(array,bit),std_bit_atomic_mask(bit),order);
+}
+
+/**
+ * Atomically clear a bit
+ * @param array the atomic bit array
+ * @param bit the bit to clear
+ * @param order the memory ordering
+ */
+static inline void std_bit_atomic_clear(void *array, size_t bit, int order) {
+    __atomic_fetch_and(std_bit_atomic_word(array,bit),~std_bit_atomic_mask(bit),order);
+}
+
+/**
+ * Atomically read a bit
+ * @param array the atomic bit array
+ * @param bit the bit to read
+ * @param order the memory ordering
+ * @return true if the bit is set
+ */
+static inline bool std_bit_atomic_test(void *array, size_t bit, int order) {
+    return (__atomic_load_n(std_bit_atomic_word(array,bit),order) &
+            std_bit_atomic_mask(bit)) != 0;
+}
+
+/**
+ * Atomically set a bit and return its old value
+ * @param array the atomic bit array
+ * @param bit the bit to set
+ * @param order the memory ordering
+ * @return true if the bit was already set
+ */
+static inline bool std_bit_atomic_test_and_set(void *array, size_t bit, int order) {
+    uint64_t mask = std_bit_atomic_mask(bit);
+    return (__atomic_fetch_or(std_bit_atomic_word(array,bit),mask,order) & mask) != 0;
+}
+
+/**
+ * Atomically clear a bit and return its old value
+ * @param array the atomic bit array
+ * @param bit the bit to clear
+ * @param order the memory ordering
+ * @return true if the bit was set
+ */
+static inline bool std_bit_atomic_test_and_clear(void *array, size_t bit, int order) {
+    uint64_t mask = std_bit_atomic_mask(bit);
+    return (__atomic_fetch_and(std_bit_atomic_word(array,bit),~mask,order) & mask) != 0;
+}
+
+/**
+ * Create a cleared bit array for the atomic operations.  Free it with
+ * std_bitmaparray_free_data
+ * @param len the number of bits
+ * @return the array or NULL if out of memory
+ */
+void *std_bitmap_create_atomic_array(unsigned long len);
+
+/**
+ * Find the first clear bit from 'from' on and set it.  Many threads can call
+ * this on the same array and each bit is handed to only one of them
+ * @param array the atomic bit array
+ * @param len the length of the array in bits
+ * @param from the bit to start searching at
+ * @param order the memory ordering of the successful set
+ * @return the bit that was set or -1 if all the bits from 'from' on are set
+ */
+int std_bit_atomic_find_and_set_first_clear(void *array, size_t len, size_t from,
+        int order);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_cbitmap.h
+ */
+
+/*!
+ * \file   std_cbitmap.h
+ * \brief  Compressed bitmap of 32 bit values (Roaring style)
+ *
+ * The value space is split into 64K chunks by the upper 16 bits of the value.
+ * Only chunks with values in them exist and each one picks the smallest of
+ * three containers for the lower 16 bits:
+ *  - a sorted array of values while the chunk has up to 4096 values
+ *  - a 64K bit bitset (8KB) when it has more
+ *  - a sorted list of runs of consecutive values - used when
+ *    std_cbitmap_add_range or std_cbitmap_optimize find it is smaller
+ *
+ * So a few hundred VLANs out of 4K take a few hundred bytes rather than 512,
+ * and union and intersection work a container at a time rather than a bit
+ * at a time.
+ *
+ * Not thread safe - the caller has to lock around the calls.
+ */
+
+#ifndef _STD_CBITMAP_H_
+#define _STD_CBITMAP_H_
+
+#include "std_error_codes.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque compressed bitmap */
+typedef struct std_cbitmap_s std_cbitmap_t;
+
+/**
+ * Create an empty bitmap
+ * @return the bitmap or NULL if out of memory
+ */
+std_cbitmap_t * std_cbitmap_create(void);
+
+/**
+ * Free a bitmap
+ * @param bm the bitmap - can be NULL
+ */
+void std_cbitmap_free(std_cbitmap_t *bm);
+
+/**
+ * Add a value
+ * @param bm the bitmap
+ * @param value the value to add
+ * @return STD_ERR_OK if successful (including if it was already there) otherwise
+ *      an error if out of memory
+ */
+t_std_error std_cbitmap_add(std_cbitmap_t *bm, uint32_t value);
+
+/**
+ * Add all values from first to last inclusive
+ * @param bm the bitmap
+ * @param first the first value
+ * @param last the last value
+ * @return STD_ERR_OK if successful otherwise an error if out of memory or last < first
+ */
+t_std_error std_cbitmap_add_range(std_cbitmap_t *bm, uint32_t first, uint32_t last);
+
+/**
+ * Remove a value
+ * @param bm the bitmap
+ * @param value the value to remove
+ * @return STD_ERR_OK if successful (including if it wasn't there) otherwise
+ *      an error if out of memory
+ */
+t_std_error std_cbitmap_remove(std_cbitmap_t *bm, uint32_t value);
+
+/**
+ * Check for a value
+ * @param bm the bitmap
+ * @param value the value
+ * @return true if the value is in the bitmap
+ */
+bool std_cbitmap_contains(const std_cbitmap_t *bm, uint32_t value);
+
+/**
+ * Get the number of values in the bitmap
+ * @param bm the bitmap
+ * @return the number of values
+ */
+uint64_t std_cbitmap_cardinality(const std_cbitmap_t *bm);
+
+/**
+ * Get the number of bytes the bitmap is using
+ * @param bm the bitmap
+ * @return the bytes allocated for the bitmap
+ */
+size_t std_cbitmap_memory_usage(const std_cbitmap_t *bm);
+
+/**
+ * Convert each chunk to whichever of array, bitset or runs is smallest.
+ * Worth calling after building a bitmap that has long runs of values
+ * @param bm the bitmap
+ */
+void std_cbitmap_optimize(std_cbitmap_t *bm);
+
+/**
+ * Create a bitmap with the values that are in either of two bitmaps
+ * @param a the first bitmap
+ * @param b the second bitmap
+ * @return the new bitmap or NULL if out of memory
+ */
+std_cbitmap_t * std_cbitmap_or(const std_cbitmap_t *a, const std_cbitmap_t *b);
+
+/**
+ * Create a bitmap with the values that are in both of two bitmaps
+ * @param a the first bitmap
+ * @param b the second bitmap
+ * @return the new bitmap or NULL if out of memory
+ */
+std_cbitmap_t * std_cbitmap_and(const std_cbitmap_t *a, const std_cbitmap_t *b);
+
+/**
+ * Get the values in ascending order a batch at a time
+@verbatim
+uint64_t from = 0;
+uint32_t vals[256];
+size_t n;
+while ((n = std_cbitmap_get_values(bm,&from,vals,256)) > 0) { ... }
+@endverbatim
+ * @param bm the bitmap
+ * @param from [in/out] the value to start at - updated to where the next call carries on
+ * @param values filled in with the values
+ * @param max the size of values
+ * @return the number of values filled in - 0 when there are no more
+ */
+size_t std_cbitmap_get_values(const std_cbitmap_t *bm, uint64_t *from, uint32_t *values,
+        size_t max);
+
+/**
+ * Get the size of the serialized form of a bitmap
+ * @param bm the bitmap
+ * @return the size in bytes
+ */
+size_t std_cbitmap_serialized_size(const std_cbitmap_t *bm);
+
+/**
+ * Serialize a bitmap.  The format is little endian so it can be sent to
+ * another machine.
+ * @param bm the bitmap
+ * @param buf the buffer to write to - at least std_cbitmap_serialized_size bytes
+ * @return the number of bytes written
+ */
+size_t std_cbitmap_serialize(const std_cbitmap_t *bm, void *buf);
+
+/**
+ * Create a bitmap from its serialized form
+ * @param buf the serialized bitmap
+ * @param len the length of buf
+ * @return the bitmap or NULL if buf is not a valid bitmap or out of memory
+ */
+std_cbitmap_t * std_cbitmap_deserialize(const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_CBITMAP_H_ */
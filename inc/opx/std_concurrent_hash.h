@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * std_concurrent_hash.h
+ */
+
+#ifndef STD_CONCURRENT_HASH_H_
+#define STD_CONCURRENT_HASH_H_
+
+#include "std_error_codes.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \defgroup ConcurrentHash Thread safe hash map
+*
+* A hash map that can be shared between threads.  The map is split into a
+* number of shards, each one an std_hash table with its own read/write lock,
+* so threads working on different keys rarely touch the same lock.  Each shard
+* grows on its own.
+*
+* Keys are described the same way as std_hash_create (key offset and length in
+* the user node).
+*
+* The shard lock is only held for the duration of a call, so a node returned
+* by std_chash_find can be removed by another thread at any time after.  To
+* make it safe to keep using the node, readers bracket their use of it with
+* std_chash_read_enter/std_chash_read_exit and writers hand removed nodes to
+* std_chash_retire instead of freeing them directly.  Retired nodes are freed
+* (epoch based) once no reader that could have seen them is still inside a
+* read section.
+*
+* @verbatim
+
+    std_chash_read_enter(h);
+    obj_t *o = (obj_t*)std_chash_find(h,&key);
+    if (o!=NULL) use(o);
+    std_chash_read_exit(h);
+
+    ...
+    obj_t *o = (obj_t*)std_chash_remove(h,&key);
+    if (o!=NULL) std_chash_retire(h,o,free);
+
+@endverbatim
+* \{
+*/
+
+typedef void *std_chash_handle_t;
+
+/**
+ * The function used to free a retired user node
+ * @param data the user node
+ */
+typedef void (*std_chash_free_fn)(void *data);
+
+/**
+ * Create a concurrent hash map
+ * @param handle the handle of the map that is created
+ * @param name the name of the map
+ * @param keyoffset offset of the key in the user node
+ * @param keylength length of the key in bytes
+ * @param shards the number of shards - rounded up to a power of 2.  0 for the default
+ * @return STD_ERR_OK if successful otherwise a specific error code
+ */
+t_std_error std_chash_create(std_chash_handle_t *handle, const char *name,
+        int keyoffset, int keylength, size_t shards);
+
+/**
+ * Delete the map.  Any retired nodes that are still pending are freed.  The nodes
+ * in the map are not freed.  No other thread can be using the map
+ * @param handle the map
+ * @return STD_ERR_OK on success otherwise a failure
+ */
+t_std_error std_chash_destroy(std_chash_handle_t handle);
+
+/**
+ * Insert a user node into the map
+ * @param handle the map
+ * @param data the user node with the key at the configured offset
+ * @return STD_ERR_OK on success, a failure if the key exists or there is no memory
+ */
+t_std_error std_chash_insert(std_chash_handle_t handle, void *data);
+
+/**
+ * Find the user node that has the same key as data
+ * @param handle the map
+ * @param data a node with the key to search for (can be a temporary)
+ * @return the user node or NULL if not found.  Only valid past this call if the
+ *      caller is in a read section and writers retire the nodes they remove
+ */
+void * std_chash_find(std_chash_handle_t handle, const void *data);
+
+/**
+ * Remove the user node that has the same key as data from the map
+ * @param handle the map
+ * @param data a node with the key to remove
+ * @return the user node that was removed or NULL if not found.  Pass it to
+ *      std_chash_retire if readers may still be using it
+ */
+void * std_chash_remove(std_chash_handle_t handle, const void *data);
+
+/**
+ * Get the number of user nodes in the map.  Other threads may change it at any time
+ * @param handle the map
+ * @return the number of user nodes
+ */
+size_t std_chash_count(std_chash_handle_t handle);
+
+/**
+ * Enter a read section.  Nodes found within the read section will not be freed
+ * through std_chash_retire until the section is exited.  Read sections can be nested
+ * @param handle the map
+ */
+void std_chash_read_enter(std_chash_handle_t handle);
+
+/**
+ * Exit a read section entered with std_chash_read_enter
+ * @param handle the map
+ */
+void std_chash_read_exit(std_chash_handle_t handle);
+
+/**
+ * Free a removed user node once all readers that could still be using it are done.
+ * Must not be called from inside a read section
+ * @param handle the map
+ * @param data the user node that was removed from the map
+ * @param free_fn the function that will be called to free the node
+ * @return STD_ERR_OK on success or a failure if the node could not be queued
+ */
+t_std_error std_chash_retire(std_chash_handle_t handle, void *data, std_chash_free_fn free_fn);
+
+/**
+ * Free any retired nodes that are now safe to free.  This is done automatically by
+ * std_chash_retire once enough nodes are pending
+ * @param handle the map
+ */
+void std_chash_reclaim(std_chash_handle_t handle);
+
+/**
+ * \}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STD_CONCURRENT_HASH_H_ */
@@ -96,6 +96,23 @@ extern "C" {
 t_std_error std_event_server_init(std_event_server_handle_t *handle, const char * event_channel_name,
         size_t threads);
 
+/**
+ * @brief set how long the server may hold events for a subscriber so that
+ * more can be written with them.
+ *
+ * The events published in one read from a publisher are always written to
+ * each subscriber with a single write.  With a latency of 0 (the default)
+ * that happens as soon as the read has been processed.  Otherwise events are
+ * held until they are latency ms old (or a subscriber has 64KB queued) so
+ * that bursts from several publishers are combined too.
+ *
+ * @param handle the event service
+ * @param latency the longest time in ms an event may be held
+ * @return a standard error code or STD_ERR_OK if successful
+ */
+t_std_error std_event_server_set_flush_latency(std_event_server_handle_t handle,
+        size_t latency);
+
 /**
  * @brief connect to the event service from another process (or thread)
  * @param handle the handle to hold the client's connection details
@@ -104,6 +121,28 @@ t_std_error std_event_server_init(std_event_server_handle_t *handle, const char
  */
 t_std_error std_server_client_connect(std_event_client_handle * handle, const char *event_channel_name);
 
+/**
+ * @brief connect to the event service and ask for the events to be delivered
+ * through a shared memory ring instead of the socket.  Falls back to the
+ * socket if the server can't provide a ring or doesn't answer in time.  The
+ * server only switches to the ring once the client confirms that it has
+ * mapped it, so a late answer doesn't change the transport.
+ *
+ * With a ring the events don't make the handle readable - the client must
+ * block in std_client_wait_for_event or std_client_wait_for_event_data rather
+ * than polling the handle.  An event too large for half of the ring still
+ * comes over the socket and may be received ahead of smaller events that
+ * were published before it.
+ *
+ * @param handle the handle to hold the client's connection details
+ * @param event_channel_name the event channel name
+ * @param ring_size the bytes of events the ring can hold - rounded up to a
+ *      power of 2 between 64KB and 64MB
+ * @return standard return code
+ */
+t_std_error std_server_client_connect_shm(std_event_client_handle * handle,
+        const char *event_channel_name, size_t ring_size);
+
 /**
  * Close a channel with the common event service
  * @param handle a valid event service handle
@@ -177,6 +216,26 @@ t_std_error std_client_set_receive_buffer(std_event_client_handle handle, size_t
  */
 t_std_error std_client_wait_for_event(std_event_client_handle handle, std_event_msg_buff_t buff);
 
+/**
+ * @brief wait for at least one message from the event service and return
+ * up to max_msgs of the ones that have already arrived.  Reads as much as the
+ * socket has with one call so a burst of events costs one system call.
+ *
+ * The messages are copied into buff, which grows as needed whatever the
+ * limit given when it was allocated, and are valid until the buffer is used
+ * again.  Events read but not returned are kept in the buffer for the next
+ * call, so keep using the same buffer with the handle.
+ *
+ * @param handle opened from a previous client registration
+ * @param buff the message buffer used to receive the messages
+ * @param msgs filled with pointers to the messages
+ * @param max_msgs the size of msgs
+ * @param count set to the number of messages returned
+ * @return standard return code
+ */
+t_std_error std_client_wait_for_events(std_event_client_handle handle, std_event_msg_buff_t buff,
+        std_event_msg_t **msgs, size_t max_msgs, size_t *count);
+
 /**
  * @brief wait for a message from the event service
  * @param handle opened from a previous client registration
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_ext_sort.h
+ */
+
+/*!
+ * \file   std_ext_sort.h
+ * \brief  Stable external merge sort of fixed size records within a memory budget
+ *
+ * Records are added in any number of batches.  Whenever the records held in
+ * memory reach the budget they are sorted with std_merge_sort_elem and spilled
+ * to a temporary file as a sorted run.  Once all of the records are added the
+ * runs are merged with a loser tree - if there are too many runs to give each
+ * one a reasonable read buffer within the budget, groups of runs are first
+ * merged into longer runs.  If nothing was spilled the records are returned
+ * straight from memory.
+ *
+@verbatim
+
+std_ext_sort_handle_t h;
+std_ext_sort_create(&h, sizeof(route_t), 64*1024*1024, NULL, NULL, route_cmp);
+while (... more routes ...) std_ext_sort_add(h, routes, n);
+std_ext_sort_finish(h);
+while (std_ext_sort_read(h, routes, 1024, &n)==STD_ERR_OK && n!=0) {
+    ... routes[0..n-1] are the next n routes in order
+}
+std_ext_sort_destroy(h);
+
+@endverbatim
+ */
+
+#ifndef __STD_EXT_SORT_H__
+#define __STD_EXT_SORT_H__
+
+#include "std_error_codes.h"
+#include "std_mergesort.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque handle to an external sort */
+typedef struct std_ext_sort_s *std_ext_sort_handle_t;
+
+/**
+ * @brief create an external sort
+ *
+ * @param handle[out] the new sort
+ * @param recordSize Size of each record in bytes.
+ * @param memBudget The max bytes of record buffers the sort will allocate.
+ *          Must hold at least a few records.
+ * @param tmpDir Directory for the temporary run files.  NULL uses $TMPDIR or
+ *          /tmp.  The files are unlinked as soon as they are created.
+ * @param context Passed to cmp.
+ * @param cmp Function that compares two records.
+ * @return STD_ERR_OK on success or an error if the parameters are invalid or
+ *          memory can't be allocated
+ */
+t_std_error std_ext_sort_create (std_ext_sort_handle_t *handle, size_t recordSize,
+             size_t memBudget, const char *tmpDir, void *context,
+             std_merge_sort_elem_cmp cmp);
+
+/**
+ * @brief add records to the sort.  Can only be called before std_ext_sort_finish
+ *
+ * @param handle the sort
+ * @param records Array of records to add - copied by the sort.
+ * @param numRecords Number of records in the array.
+ * @return STD_ERR_OK on success or an error if a run can't be written
+ */
+t_std_error std_ext_sort_add (std_ext_sort_handle_t handle, const void *records,
+             size_t numRecords);
+
+/**
+ * @brief finish adding records and get ready to read them back in order
+ *
+ * @param handle the sort
+ * @return STD_ERR_OK on success or an error if a run can't be written or merged
+ */
+t_std_error std_ext_sort_finish (std_ext_sort_handle_t handle);
+
+/**
+ * @brief read the next records in sorted order.  Records with equal keys come
+ *          back in the order they were added.
+ *
+ * @param handle the sort
+ * @param records Array to copy the records into.
+ * @param maxRecords Size of the array in records.
+ * @param numRead[out] Number of records copied - 0 once all have been read.
+ * @return STD_ERR_OK on success or an error if a run can't be read
+ */
+t_std_error std_ext_sort_read (std_ext_sort_handle_t handle, void *records,
+             size_t maxRecords, size_t *numRead);
+
+/**
+ * @brief get the number of records added to the sort
+ *
+ * @param handle the sort
+ * @return the number of records
+ */
+size_t std_ext_sort_count (std_ext_sort_handle_t handle);
+
+/**
+ * @brief free the sort and close its temporary files
+ *
+ * @param handle the sort
+ */
+void std_ext_sort_destroy (std_ext_sort_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__STD_EXT_SORT_H__ */
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_hash.h
+ */
+
+/*!
+ * \file   std_hash.h
+ * \brief  Open addressing hash index for exact match lookups.
+ *
+ * The hash index is configured the same way as a simple RB tree
+ * (see std_rbtree_create_simple) - the key lives in the user node at a
+ * fixed offset and has a fixed length.  Only exact match operations are
+ * supported; use the RB tree when ordered walks are needed.
+ *
+ * The table uses Swiss table style open addressing.  Slots are arranged in
+ * groups of 16 with a one byte control tag per slot holding 7 bits of the
+ * key's hash.  A lookup reads the 16 control bytes of a group, compares them
+ * all at once (SSE2 when available) and then only dereferences the user
+ * nodes whose tag matched.
+ *
+ * When the table needs to grow, a new table is allocated and entries are
+ * moved a few groups at a time on each insert/remove instead of all at once,
+ * so no single operation pays for the whole rehash.
+ *
+ * The table does not do any locking.
+ */
+
+#ifndef _STD_HASH_H_
+#define _STD_HASH_H_
+
+#include "std_error_codes.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Max length of name of the hash table
+#define STD_HASH_NAME_MAX_LEN 50
+
+/// Handle to a hash table.  Treat the contents as private.
+typedef struct _std_hash_table * std_hash_handle;
+
+/**
+ * @brief callback used by std_hash_walk
+ * @param context the context passed to std_hash_walk
+ * @param data the user node
+ * @return 0 to continue the walk, non-zero to stop it
+ */
+typedef int (*std_hash_walk_cb)(void *context, void *data);
+
+/**
+ * @brief create a hash table where the key is keylength bytes at keyoffset in
+ * each user node.  Keys are compared with memcmp
+ * @param name the string name of the table
+ * @param keyoffset the offset of the key in the user node (can use std_struct_utils.h)
+ * @param keylength the length of the key in bytes
+ * @param initial_size the number of entries to size the table for.  Can be 0
+ * @return the handle of the table or NULL on failure
+ */
+std_hash_handle std_hash_create(const char *name, int keyoffset, int keylength,
+                                size_t initial_size);
+
+/**
+ * @brief create a hash table with the default initial size.  Mirrors
+ * std_rbtree_create_simple
+ * @param name the string name of the table
+ * @param keyoffset the offset of the key in the user node
+ * @param keylength the length of the key in bytes
+ * @return the handle of the table or NULL on failure
+ */
+std_hash_handle std_hash_create_simple(const char *name, int keyoffset, int keylength);
+
+/**
+ * @brief destroy the hash table.  The user nodes are not freed and
+ * the caller must ensure that they are no longer referenced through the table
+ * @param h the hash table
+ */
+void std_hash_destroy(std_hash_handle h);
+
+/**
+ * @brief insert a user node.  The key must be at the configured offset
+ * @param h the hash table
+ * @param data the user node to insert
+ * @return STD_ERR_OK on success, STD_ERR(COM,PARAM,0) if the key already exists
+ *      or STD_ERR(COM,NOMEM,0) if the table could not grow
+ */
+t_std_error std_hash_insert(std_hash_handle h, void *data);
+
+/**
+ * @brief find the user node that has the same key as data.  The data node may
+ * be a temporary on the stack with just the key filled in
+ * @param h the hash table
+ * @param data a node with the key to search for
+ * @return the user node in the table or NULL if not found
+ */
+void * std_hash_getexact(std_hash_handle h, const void *data);
+
+/**
+ * @brief remove the user node with the same key as data from the table.
+ * The node is not freed
+ * @param h the hash table
+ * @param data a node with the key to remove
+ * @return the user node that was removed or NULL if not found
+ */
+void * std_hash_remove(std_hash_handle h, const void *data);
+
+/**
+ * @brief get the number of user nodes in the table
+ * @param h the hash table
+ * @return the number of user nodes
+ */
+size_t std_hash_count(std_hash_handle h);
+
+/**
+ * @brief walk all of the user nodes in the table in no particular order.
+ * The table must not be modified from the callback
+ * @param h the hash table
+ * @param cb the callback called for each user node
+ * @param context passed to the callback
+ * @return the user node on which the callback returned non-zero or NULL if the
+ *      walk completed
+ */
+void * std_hash_walk(std_hash_handle h, std_hash_walk_cb cb, void *context);
+
+/**
+ * @brief hash a block of memory.  This is the hash used internally by the table
+ * and is exposed for other containers that need the same hashing
+ * @param data the data to hash
+ * @param len the length of the data in bytes
+ * @return a 64 bit hash of the data
+ */
+uint64_t std_hash_bytes(const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_HASH_H_ */
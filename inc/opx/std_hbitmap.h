@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_hbitmap.h
+ */
+
+/*!
+ * \file   std_hbitmap.h
+ * \brief  Bitmap with summary levels for fast searches for set or clear bits
+ *
+ * The bits are kept in 64 bit words.  Above them there are two trees of
+ * summary words - in one a bit is set when the word below has any bit set and
+ * in the other when the word below has any bit clear.  Each level has 1/64 of
+ * the words of the level below, so a 1M bit map has 3 summary levels and a
+ * search for the first set or clear bit reads one or two words per level
+ * rather than scanning the whole map.  Setting or clearing a bit only touches
+ * the summaries when a word goes to or from all zero or all ones.
+ *
+ * Not thread safe - the caller has to lock around the calls.
+ */
+
+#ifndef _STD_HBITMAP_H_
+#define _STD_HBITMAP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque hierarchical bitmap */
+typedef struct std_hbitmap_s std_hbitmap_t;
+
+/**
+ * Create a bitmap
+ * @param len the number of bits - at most INT_MAX
+ * @param set true to start with all bits set otherwise all bits are clear
+ * @return the bitmap or NULL if out of memory or len is invalid
+ */
+std_hbitmap_t * std_hbitmap_create(size_t len, bool set);
+
+/**
+ * Free a bitmap
+ * @param bm the bitmap - can be NULL
+ */
+void std_hbitmap_free(std_hbitmap_t *bm);
+
+/**
+ * Get the number of bits in the bitmap
+ * @param bm the bitmap
+ * @return the length in bits
+ */
+size_t std_hbitmap_len(const std_hbitmap_t *bm);
+
+/**
+ * Set a bit
+ * @param bm the bitmap
+ * @param bit the bit in the range 0 to len-1
+ */
+void std_hbitmap_set(std_hbitmap_t *bm, size_t bit);
+
+/**
+ * Clear a bit
+ * @param bm the bitmap
+ * @param bit the bit in the range 0 to len-1
+ */
+void std_hbitmap_clear(std_hbitmap_t *bm, size_t bit);
+
+/**
+ * Check a bit
+ * @param bm the bitmap
+ * @param bit the bit in the range 0 to len-1
+ * @return true if the bit is set
+ */
+bool std_hbitmap_test(const std_hbitmap_t *bm, size_t bit);
+
+/**
+ * Find the first set bit at or after a position
+ * @param bm the bitmap
+ * @param from the bit to start at
+ * @return the bit position or -1 if there are no set bits from 'from' on
+ */
+int std_hbitmap_find_first_set(const std_hbitmap_t *bm, size_t from);
+
+/**
+ * Find the first clear bit at or after a position
+ * @param bm the bitmap
+ * @param from the bit to start at
+ * @return the bit position or -1 if there are no clear bits from 'from' on
+ */
+int std_hbitmap_find_first_clear(const std_hbitmap_t *bm, size_t from);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_HBITMAP_H_ */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_id_allocator.h
+ */
+
+#ifndef STD_ID_ALLOCATOR_H_
+#define STD_ID_ALLOCATOR_H_
+
+#include "std_error_codes.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \defgroup IdAllocator Thread safe ID allocator
+*
+* Hands out IDs from a fixed range [first, first+count).  Any thread can call
+* any of the functions without a lock.
+*
+* The IDs in use are tracked in a bitmap that is only changed with atomic
+* operations.  Each thread also keeps a small cache of IDs - alloc takes from
+* the cache and free puts back into it, and the cache is refilled or drained
+* a bitmap word at a time.  So the common path doesn't touch memory shared with
+* other threads at all.
+*
+* An ID sitting in another thread's cache counts as free - alloc_specific and
+* reserve take it from the cache, alloc takes one from another cache once the
+* bitmap is exhausted and alloc_contiguous gives all cached IDs back to the
+* bitmap before it fails.
+*
+* @verbatim
+
+    std_id_allocator_handle_t ids;
+    std_id_allocator_create(&ids,1,100000);
+    std_id_allocator_reserve(ids,1,10);     // never hand out 1-10
+
+    uint64_t nh_id;
+    if (std_id_allocator_alloc(ids,&nh_id)==STD_ERR_OK) {
+        ...
+        std_id_allocator_free(ids,nh_id);
+    }
+
+@endverbatim
+* \{
+*/
+
+typedef void *std_id_allocator_handle_t;
+
+/**
+ * Create an ID allocator
+ * @param handle the new allocator
+ * @param first the lowest ID
+ * @param count the number of IDs
+ * @return STD_ERR_OK if successful otherwise a specific error code
+ */
+t_std_error std_id_allocator_create(std_id_allocator_handle_t *handle, uint64_t first,
+        uint64_t count);
+
+/**
+ * Destroy an ID allocator.  No other thread can be using it
+ * @param handle the allocator
+ */
+void std_id_allocator_destroy(std_id_allocator_handle_t handle);
+
+/**
+ * Allocate any free ID
+ * @param handle the allocator
+ * @param id the ID allocated
+ * @return STD_ERR_OK if successful otherwise an error if there are no free IDs
+ */
+t_std_error std_id_allocator_alloc(std_id_allocator_handle_t handle, uint64_t *id);
+
+/**
+ * Allocate a specific ID
+ * @param handle the allocator
+ * @param id the ID to allocate
+ * @return STD_ERR_OK if successful otherwise an error if the ID is out of range
+ *      or in use
+ */
+t_std_error std_id_allocator_alloc_specific(std_id_allocator_handle_t handle, uint64_t id);
+
+/**
+ * Allocate a block of consecutive IDs
+ * @param handle the allocator
+ * @param num the number of IDs
+ * @param first the first ID of the block
+ * @return STD_ERR_OK if successful otherwise an error if there is no free block
+ */
+t_std_error std_id_allocator_alloc_contiguous(std_id_allocator_handle_t handle, size_t num,
+        uint64_t *first);
+
+/**
+ * Free an ID
+ * @param handle the allocator
+ * @param id the ID to free
+ * @return STD_ERR_OK if successful otherwise an error if the ID isn't allocated
+ */
+t_std_error std_id_allocator_free(std_id_allocator_handle_t handle, uint64_t id);
+
+/**
+ * Free a range of IDs, for example a block from std_id_allocator_alloc_contiguous
+ * or a range reserved with std_id_allocator_reserve.  The IDs go straight back
+ * to the bitmap so the block is available as a block again.
+ * @param handle the allocator
+ * @param first the first ID
+ * @param num the number of IDs
+ * @return STD_ERR_OK if successful otherwise an error if any ID isn't allocated
+ *      (in which case none are freed)
+ */
+t_std_error std_id_allocator_free_range(std_id_allocator_handle_t handle, uint64_t first,
+        size_t num);
+
+/**
+ * Mark a range of IDs as in use so they are never handed out.  Either all of
+ * the IDs are reserved or none are
+ * @param handle the allocator
+ * @param first the first ID
+ * @param num the number of IDs
+ * @return STD_ERR_OK if successful otherwise an error if any ID is out of range
+ *      or already in use
+ */
+t_std_error std_id_allocator_reserve(std_id_allocator_handle_t handle, uint64_t first,
+        size_t num);
+
+/**
+ * \}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STD_ID_ALLOCATOR_H_ */
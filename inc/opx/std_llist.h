@@ -190,6 +190,42 @@ void std_dll_insertbefore(std_dll_head *head, std_dll *before, std_dll *newnode)
  */
 void std_dll_remove(std_dll_head *head, std_dll *item);
 
+/**
+ * @brief move the elements first..last (inclusive) from one list into another in
+ * O(1).  The sort order of dst is not checked - it is up to the caller to splice to
+ * the correct position in a sorted list
+ * @param dst the list to move the elements to (can be the same as src)
+ * @param after the element in dst to insert after or NULL to insert at the front
+ * @param src the list the elements are currently on
+ * @param first the first element of the range to move
+ * @param last the last element of the range to move (can be the same as first)
+ */
+void std_dll_splice(std_dll_head *dst, std_dll *after, std_dll_head *src,
+                    std_dll *first, std_dll *last);
+
+/**
+ * @brief move all elements of src to the back of dst in O(1).  src is left empty
+ * @param dst the list to move the elements to
+ * @param src the list to empty
+ */
+void std_dll_splice_list(std_dll_head *dst, std_dll_head *src);
+
+/**
+ * @brief merge the sorted list src into the sorted list dst in O(n+m) using dst's
+ * compare function.  On equal keys elements from dst come first.  src is left empty
+ * @param dst a sorted list (std_dll_init_sort)
+ * @param src a list sorted with the same compare function
+ */
+void std_dll_merge(std_dll_head *dst, std_dll_head *src);
+
+/**
+ * @brief sort the list in place in O(n log n) with the compare function, offset and
+ * len the list was initialized with (std_dll_init_sort).  The sort is stable
+ * and needs no extra memory
+ * @param head the list to sort
+ */
+void std_dll_sort(std_dll_head *head);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,7 +28,14 @@
 #ifndef __STD_MERGE_SORT_H__
 #define __STD_MERGE_SORT_H__
 
+#include "std_thread_pool.h"
+
 #include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * @brief std_merge_sort_cmp function User defined comparison function
@@ -68,4 +75,123 @@ typedef void (* std_merge_sort_copyfn) (void *context,
 void std_merge_sort (void *context, void *array, int numElements,
              void *tmpArray, std_merge_sort_cmp cmp_func,
              std_merge_sort_copyfn copy_func);
+
+/**
+ * @brief std_merge_sort_elem_cmp User defined comparison function for
+ *          std_merge_sort_elem
+ *
+ * @param context Context provided by the application.
+ * @param elem_a  Pointer to the first element
+ * @param elem_b  Pointer to the second element
+ * @return < 0 if elem_a sorts before elem_b, > 0 if after and 0 if equal
+ */
+typedef int (* std_merge_sort_elem_cmp) (void *context, const void *elem_a,
+                                     const void *elem_b);
+
+/**
+ * @brief std_merge_sort_elem stable merge sort of an array of fixed size
+ *          elements.  Elements are moved with memcpy so there is no copy
+ *          callback, small runs are insertion sorted and the merge passes
+ *          alternate between array and tmpArray rather than copying back
+ *          after every merge.
+ *
+ * @param context Context provided by the application.
+ * @param array  The input array that needs to be sorted.
+ * @param numElements Number of elements in the array.
+ * @param elemSize Size of each element in bytes.
+ * @param tmpArray A temporary array of at least numElements * elemSize bytes.
+ * @param cmp_func  User defined comparison function.
+ * @return void
+ */
+void std_merge_sort_elem (void *context, void *array, size_t numElements,
+             size_t elemSize, void *tmpArray, std_merge_sort_elem_cmp cmp_func);
+
+/**
+ * @brief std_merge_sort_parallel stable merge sort that spreads the work over
+ *          the threads of a thread pool.  The array is split into chunks that
+ *          are sorted by the pool's threads and then merged pairwise, with each
+ *          merge split between threads by merge path partitioning.
+ *
+ *          Same context/cmp/copy contract as std_merge_sort - the callbacks
+ *          are called from the pool's threads (concurrently) and the result is
+ *          identical to std_merge_sort.  Small arrays, a NULL pool or
+ *          1 thread are sorted directly on the calling thread with
+ *          std_merge_sort.  Must not be called from a job running on the
+ *          same pool.
+ *
+ * @param pool The thread pool to run the work on.
+ * @param threads The number of parallel tasks to split the sort into - normally
+ *          the number of threads in the pool.
+ * @param context Context provided by the application.
+ * @param array  The input array that needs to be sorted.
+ * @param numElements Number of elements in the array.
+ * @param tmpArray A temporary array which is used by this function internally.
+ * @param std_merge_sort_cmp  User defined comparison function.
+ * @param std_merge_sort_copyfn  User defined copy function.
+ * @return void
+ */
+void std_merge_sort_parallel (std_thread_pool_handle_t pool, size_t threads,
+             void *context, void *array, int numElements,
+             void *tmpArray, std_merge_sort_cmp cmp_func,
+             std_merge_sort_copyfn copy_func);
+
+#ifdef __cplusplus
+}
+
+#include <algorithm>
+
+/**
+ * @brief std_merge_sort_typed stable merge sort of an array of T using a
+ *          "less than" functor that the compiler can inline.  Same algorithm as
+ *          std_merge_sort_elem.
+ *
+ * @param array  The input array that needs to be sorted.
+ * @param numElements Number of elements in the array.
+ * @param tmpArray A temporary array of at least numElements elements.
+ * @param less  Callable returning true if the first argument sorts before
+ *              the second.
+ */
+template <typename T, typename Less>
+void std_merge_sort_typed(T *array, size_t numElements, T *tmpArray, Less less)
+{
+    size_t run = 16;
+    size_t passes = 0;
+    size_t width;
+
+    /* pick the run length so the merge passes end up back in array */
+    for (width = run; width < numElements; width *= 2) ++passes;
+    if (passes & 1) run *= 2;
+
+    for (size_t lo = 0; lo < numElements; lo += run) {
+        size_t hi = std::min(lo + run, numElements);
+        for (size_t ix = lo + 1; ix < hi; ++ix) {
+            T v = array[ix];
+            size_t jx = ix;
+            for ( ; jx > lo && less(v, array[jx - 1]); --jx) array[jx] = array[jx - 1];
+            array[jx] = v;
+        }
+    }
+
+    T *src = array;
+    T *dst = tmpArray;
+    for (width = run; width < numElements; width *= 2) {
+        for (size_t lo = 0; lo < numElements; lo += 2 * width) {
+            size_t mid = std::min(lo + width, numElements);
+            size_t hi = std::min(lo + 2 * width, numElements);
+            size_t l = lo, r = mid, out = lo;
+            if (mid == hi || !less(src[mid], src[mid - 1])) {
+                std::copy(src + lo, src + hi, dst + lo);
+                continue;
+            }
+            while (l < mid && r < hi) dst[out++] = less(src[r], src[l]) ? src[r++] : src[l++];
+            out = std::copy(src + l, src + mid, dst + out) - dst;
+            std::copy(src + r, src + hi, dst + out);
+        }
+        std::swap(src, dst);
+    }
+    if (src != array) std::copy(src, src + numElements, array);
+}
+
+#endif
+
 #endif /* !__STD_MERGE_SORT_H__ */
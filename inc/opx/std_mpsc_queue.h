@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_mpsc_queue.h
+ */
+
+/*!
+ * \file   std_mpsc_queue.h
+ * \brief  Lock free intrusive multi producer single consumer queue
+ */
+
+#ifndef _STD_MPSC_QUEUE_H_
+#define _STD_MPSC_QUEUE_H_
+
+#include "std_error_codes.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The link that has to be embedded in any structure put on the queue.  As with
+ * std_dll it is easiest to make it the first field of the structure
+@verbatim
+
+struct my_work_s {
+    std_mpsc_node link;
+    int value;
+};
+
+@endverbatim
+ */
+typedef struct _std_mpsc_node {
+    struct _std_mpsc_node *next;
+} std_mpsc_node;
+
+/**
+ * The queue.  Any number of threads can push but only one thread can pop.
+ * Pushing is a single atomic exchange - there are no locks.  Treat all fields
+ * as private
+ */
+typedef struct _std_mpsc_queue {
+    std_mpsc_node *head;        //! last pushed node - written by the producers
+    char pad[64 - sizeof(std_mpsc_node *)];
+    std_mpsc_node *tail;        //! next node to pop - consumer only
+    std_mpsc_node stub;         //! placeholder node that keeps the list non-empty
+    int wake_fd;                //! eventfd used to wake the consumer or -1
+    int sleeping;               //! set while the consumer is waiting on wake_fd
+} std_mpsc_queue_t;
+
+/**
+ * Initialize a queue
+ * @param q the queue to initialize
+ * @param use_wakeup true to create an eventfd so that the consumer can block in
+ *      std_mpsc_queue_pop_wait.  Without it the consumer can only poll
+ * @return STD_ERR_OK on success otherwise an error if the eventfd can't be created
+ */
+t_std_error std_mpsc_queue_init(std_mpsc_queue_t *q, bool use_wakeup);
+
+/**
+ * Clean up a queue.  Any nodes still on the queue are not touched
+ * @param q the queue
+ */
+void std_mpsc_queue_destroy(std_mpsc_queue_t *q);
+
+/**
+ * Add a node to the back of the queue.  Can be called from any thread
+ * @param q the queue
+ * @param node the node to add
+ */
+void std_mpsc_queue_push(std_mpsc_queue_t *q, std_mpsc_node *node);
+
+/**
+ * Take the node at the front of the queue.  Consumer thread only.
+ * May return NULL for an instant while a producer is half way through a push
+ * @param q the queue
+ * @return the node or NULL if the queue is empty
+ */
+std_mpsc_node * std_mpsc_queue_pop(std_mpsc_queue_t *q);
+
+/**
+ * Take the node at the front of the queue and wait for one if the queue is empty.
+ * Consumer thread only and the queue must have been created with use_wakeup
+ * @param q the queue
+ * @param timeout_ms the max time to wait in milliseconds or -1 to wait forever
+ * @return the node or NULL on timeout
+ */
+std_mpsc_node * std_mpsc_queue_pop_wait(std_mpsc_queue_t *q, int timeout_ms);
+
+/**
+ * Check if there is anything on the queue.  Consumer thread only
+ * @param q the queue
+ * @return true if the queue is empty
+ */
+bool std_mpsc_queue_empty(std_mpsc_queue_t *q);
+
+/**
+ * Get the file descriptor that becomes readable when a producer wakes the consumer.
+ * Allows the consumer to wait for the queue in a select loop along with other fds.
+ * Before selecting the consumer must call std_mpsc_queue_prepare_wait and only
+ * select if it returns true
+ * @param q the queue
+ * @return the fd or -1 if the queue was created without use_wakeup
+ */
+int std_mpsc_queue_wake_fd(std_mpsc_queue_t *q);
+
+/**
+ * Tell producers that the consumer is about to wait on the wake fd.
+ * @param q the queue
+ * @return true if the queue is empty and the consumer can go ahead and wait
+ *      or false if there are nodes to pop
+ */
+bool std_mpsc_queue_prepare_wait(std_mpsc_queue_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_MPSC_QUEUE_H_ */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_radix_sort.h
+ */
+
+/*!
+ * \file   std_radix_sort.h
+ * \brief  LSD radix sort of record arrays on integer or fixed length binary keys
+ *
+ * All of the sorts are stable and sort an array of fixed size records on a key
+ * at a fixed offset in each record.  The key is sorted a byte at a time from the
+ * least significant byte up - bytes that are the same in every record are
+ * skipped.  Small arrays are sorted with std_merge_sort_elem instead.
+ */
+
+#ifndef __STD_RADIX_SORT_H__
+#define __STD_RADIX_SORT_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief sort records in ascending order of an unsigned 32 bit key (host byte order)
+ *
+ * @param records The array of records to sort.
+ * @param numRecords Number of records in the array.
+ * @param recordSize Size of each record in bytes.
+ * @param keyOffset Offset of the uint32_t key in the record.
+ * @param tmpRecords A temporary array of at least numRecords * recordSize bytes.
+ */
+void std_radix_sort_u32 (void *records, size_t numRecords, size_t recordSize,
+             size_t keyOffset, void *tmpRecords);
+
+/**
+ * @brief sort records in ascending order of an unsigned 64 bit key (host byte order)
+ *
+ * @param records The array of records to sort.
+ * @param numRecords Number of records in the array.
+ * @param recordSize Size of each record in bytes.
+ * @param keyOffset Offset of the uint64_t key in the record.
+ * @param tmpRecords A temporary array of at least numRecords * recordSize bytes.
+ */
+void std_radix_sort_u64 (void *records, size_t numRecords, size_t recordSize,
+             size_t keyOffset, void *tmpRecords);
+
+/**
+ * @brief sort records in memcmp order of a fixed length binary key - for example
+ *          IPv4/IPv6 addresses or MAC addresses in network byte order.
+ *
+ * @param records The array of records to sort.
+ * @param numRecords Number of records in the array.
+ * @param recordSize Size of each record in bytes.
+ * @param keyOffset Offset of the key in the record.
+ * @param keyLen Length of the key in bytes.
+ * @param tmpRecords A temporary array of at least numRecords * recordSize bytes.
+ */
+void std_radix_sort_bytes (void *records, size_t numRecords, size_t recordSize,
+             size_t keyOffset, size_t keyLen, void *tmpRecords);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__STD_RADIX_SORT_H__ */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_skiplist.h
+ */
+
+/*!
+ * \file   std_skiplist.h
+ * \brief  Sorted linked list with skip list express lanes
+ */
+
+#ifndef _STD_SKIPLIST_H_
+#define _STD_SKIPLIST_H_
+
+#include "std_llist.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Max number of express lanes above the base list
+#define STD_SKIPLIST_MAX_LEVEL 16
+
+/**
+ * A sorted std_dll list with extra "express lane" links on about a quarter of
+ * the nodes (and a quarter of those on the next lane up, etc.) so that inserts
+ * and searches are O(log n) rather than a walk from the head.
+ *
+ * The base list is a normal sorted std_dll_head so std_dll_getfirst,
+ * std_dll_getnext etc. can be used on &head->list to walk it.  Nodes must only
+ * be added and removed with the std_skiplist calls though, since the express
+ * lanes need to be kept up to date.  Unlike a plain sorted std_dll, a node
+ * can't be taken off with std_dll_remove - the lanes would still point at it
+ * and std_dll_head has nothing to tell them.  Code moved over from a std_dll
+ * has to switch its std_dll_remove calls to std_skiplist_remove (debug builds
+ * assert if a removed node is found on a lane).
+ *
+ * The node has to be first in the user structure (as with std_dll) and the
+ * compare offset is from the start of the structure.
+@verbatim
+
+struct my_timer_s {
+    std_skiplist_node node;
+    uint64_t expiry;
+};
+
+std_skiplist_init(&head,std_compare_binary_function,offsetof(struct my_timer_s,expiry),
+        sizeof(uint64_t));
+
+@endverbatim
+ */
+typedef struct _std_skiplist_node {
+    std_dll dll;                        //! base list linkage - must be first
+    struct _std_skiplist_tower *tower;  //! express lane links - private
+} std_skiplist_node;
+
+/**
+ * The skip list head.  Please treat all fields except list as private
+ */
+typedef struct _std_skiplist_head {
+    std_dll_head list;                                  //! the sorted base list
+    std_skiplist_node *lanes[STD_SKIPLIST_MAX_LEVEL];   //! first node on each lane
+    unsigned int levels;                                //! number of lanes in use
+    uint32_t seed;                                      //! lane selection state
+    size_t count;                                       //! number of nodes
+} std_skiplist_head;
+
+/**
+ * @brief initialize a skip list
+ * @param head the skip list to init
+ * @param compare function to compare keys (same as std_dll_init_sort)
+ * @param offset of field to compare - use offsetof(struct,field) from stddef.h
+ * @param len length of data type to compare
+ */
+void std_skiplist_init(std_skiplist_head *head, std_compare_function compare,
+                       unsigned int offset, unsigned int len);
+
+/**
+ * @brief insert a node in sorted order.  Nodes with equal keys are kept in
+ * insertion order (same as std_dll_insert)
+ * @param head the skip list
+ * @param node the node to insert
+ */
+void std_skiplist_insert(std_skiplist_head *head, std_skiplist_node *node);
+
+/**
+ * @brief remove a node from the skip list
+ * @param head the skip list
+ * @param node the node to remove
+ */
+void std_skiplist_remove(std_skiplist_head *head, std_skiplist_node *node);
+
+/**
+ * @brief find the first node with a key equal to the key in key_node
+ * @param head the skip list
+ * @param key_node a node with the key at the configured offset (can be a temporary)
+ * @return the node or NULL if there is no match
+ */
+std_skiplist_node * std_skiplist_getexact(std_skiplist_head *head, const void *key_node);
+
+/**
+ * @brief find the first node with a key equal to or greater than the key in key_node
+ * @param head the skip list
+ * @param key_node a node with the key at the configured offset (can be a temporary)
+ * @return the node or NULL if all nodes are less than the key
+ */
+std_skiplist_node * std_skiplist_getexactornext(std_skiplist_head *head, const void *key_node);
+
+/**
+ * @brief get the first (lowest) node
+ * @param head the skip list
+ * @return the first node or NULL if empty
+ */
+std_skiplist_node * std_skiplist_getfirst(std_skiplist_head *head);
+
+/**
+ * @brief get the node after a node
+ * @param head the skip list
+ * @param node the current node
+ * @return the next node or NULL if at the end
+ */
+std_skiplist_node * std_skiplist_getnext(std_skiplist_head *head, std_skiplist_node *node);
+
+/**
+ * @brief get the number of nodes in the list
+ * @param head the skip list
+ * @return the number of nodes
+ */
+size_t std_skiplist_count(std_skiplist_head *head);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_SKIPLIST_H_ */
@@ -267,6 +267,25 @@ static inline void * std_tlv_efind(register void * data, size_t *dlen, std_tlv_t
     return data;
 }
 
+/**
+ * Get the next TLV without any checks.  Only for buffers that have been
+ * checked with std_tlv_validate
+ * @param data the current TLV
+ * @return the TLV after it (or the end of the buffer)
+ */
+static inline void * std_tlv_next_unchecked(void *data) {
+    return std_tlv_offset(data, (size_t)std_tlv_total_len(data));
+}
+
+/**
+ * Says which TLVs hold nested TLVs - the TLV format itself can't tell a list
+ * of TLVs from any other value
+ * @param context the context passed along with the function
+ * @param tag the tag of a TLV
+ * @return true if the value of TLVs with the tag is itself a list of TLVs
+ */
+typedef bool (*std_tlv_nested_fn)(void *context, std_tlv_tag_t tag);
+
 /** @} */
 
 #endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_builder.h
+ */
+
+/*!
+ * \file   std_tlv_builder.h
+ * \brief  Growable TLV writer with nested TLVs and iovec output
+ *
+ * std_tlv_add needs a buffer big enough for the whole message up front.  The
+ * builder instead copies headers and small values into chunks that it takes
+ * from its own arena as it goes, so there is no size to guess and nothing is
+ * ever moved.  Nested TLVs are opened and closed around their contents and the
+ * length is filled in on close.  Large values can be added by reference and
+ * are only read when the message is sent.
+ *
+ * The result is a list of iovecs that can be handed to writev or std_socket_op
+ * without flattening the message first.
+@verbatim
+std_tlv_builder_t *b = std_tlv_builder_create(0);
+std_tlv_builder_add_u32(b,ATTR_ID,id);
+std_tlv_builder_open(b,ATTR_LIST);
+std_tlv_builder_add_ref(b,ATTR_BLOB,blob,blob_len);
+std_tlv_builder_close(b);
+
+const struct iovec *iov;
+size_t n;
+if (std_tlv_builder_iov(b,&iov,&n)==STD_ERR_OK) {
+    std_socket_msg_t msg = {0};
+    msg.msg_iov = (struct iovec*)iov;
+    msg.msg_iovlen = n;
+    std_socket_op(std_socket_transit_o_WRITE,fd,&msg,std_socket_transit_f_ALL,0,&rc);
+}
+std_tlv_builder_reset(b);   // ready for the next message, the memory is kept
+@endverbatim
+ * Not thread safe.
+ */
+
+#ifndef _STD_TLV_BUILDER_H_
+#define _STD_TLV_BUILDER_H_
+
+#include "std_error_codes.h"
+#include "std_tlv.h"
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque TLV builder */
+typedef struct std_tlv_builder_s std_tlv_builder_t;
+
+/**
+ * Create a builder
+ * @param chunk_size the size of the arena chunks or 0 for the default (4K).
+ *      Values bigger than a chunk get a chunk of their own
+ * @return the builder or NULL if out of memory
+ */
+std_tlv_builder_t * std_tlv_builder_create(size_t chunk_size);
+
+/**
+ * Free a builder and its arena
+ * @param b the builder
+ */
+void std_tlv_builder_free(std_tlv_builder_t *b);
+
+/**
+ * Empty the builder so that it can build another message.  The arena is kept
+ * @param b the builder
+ */
+void std_tlv_builder_reset(std_tlv_builder_t *b);
+
+/**
+ * Add a TLV copying the value
+ * @param b the builder
+ * @param tag the tag
+ * @param data the value
+ * @param len the length of the value
+ * @return STD_ERR_OK or STD_ERR(COM,NOMEM,0)
+ */
+t_std_error std_tlv_builder_add(std_tlv_builder_t *b, std_tlv_tag_t tag, const void *data,
+        size_t len);
+
+/**
+ * Add a TLV that refers to the value rather than copying it.  The value must
+ * stay unchanged until the message has been sent or copied out
+ * @param b the builder
+ * @param tag the tag
+ * @param data the value
+ * @param len the length of the value
+ * @return STD_ERR_OK or STD_ERR(COM,NOMEM,0)
+ */
+t_std_error std_tlv_builder_add_ref(std_tlv_builder_t *b, std_tlv_tag_t tag,
+        const void *data, size_t len);
+
+/**
+ * Add a uint16_t TLV in the same format as std_tlv_add_u16
+ */
+t_std_error std_tlv_builder_add_u16(std_tlv_builder_t *b, std_tlv_tag_t tag, uint16_t val);
+
+/**
+ * Add a uint32_t TLV in the same format as std_tlv_add_u32
+ */
+t_std_error std_tlv_builder_add_u32(std_tlv_builder_t *b, std_tlv_tag_t tag, uint32_t val);
+
+/**
+ * Add a uint64_t TLV in the same format as std_tlv_add_u64
+ */
+t_std_error std_tlv_builder_add_u64(std_tlv_builder_t *b, std_tlv_tag_t tag, uint64_t val);
+
+/**
+ * Start a TLV whose value is the TLVs added until the matching
+ * std_tlv_builder_close.  Nested TLVs can be opened inside each other
+ * @param b the builder
+ * @param tag the tag
+ * @return STD_ERR_OK or STD_ERR(COM,NOMEM,0)
+ */
+t_std_error std_tlv_builder_open(std_tlv_builder_t *b, std_tlv_tag_t tag);
+
+/**
+ * Finish the last opened TLV and fill in its length
+ * @param b the builder
+ * @return STD_ERR_OK or STD_ERR(COM,PARAM,0) if there is no open TLV
+ */
+t_std_error std_tlv_builder_close(std_tlv_builder_t *b);
+
+/**
+ * Get the length of the message so far
+ * @param b the builder
+ * @return the length in bytes
+ */
+size_t std_tlv_builder_len(const std_tlv_builder_t *b);
+
+/**
+ * Get the message as a list of iovecs.  The iovecs belong to the builder and
+ * are good until the next change to it
+ * @param b the builder
+ * @param iov [out] the iovecs
+ * @param count [out] the number of iovecs
+ * @return STD_ERR_OK, STD_ERR(COM,PARAM,0) if there is still an open TLV or
+ *      STD_ERR(COM,FAIL,0) if an earlier add failed and the message is incomplete
+ */
+t_std_error std_tlv_builder_iov(const std_tlv_builder_t *b, const struct iovec **iov,
+        size_t *count);
+
+/**
+ * Copy the message into a flat buffer
+ * @param b the builder
+ * @param buf the buffer
+ * @param len the size of the buffer - at least std_tlv_builder_len
+ * @return STD_ERR_OK, the errors of std_tlv_builder_iov or
+ *      STD_ERR(COM,TOOBIG,0) if the buffer is too small
+ */
+t_std_error std_tlv_builder_copy(const std_tlv_builder_t *b, void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_TLV_BUILDER_H_ */
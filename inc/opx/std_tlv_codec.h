@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_codec.h
+ */
+
+/*!
+ * \file   std_tlv_codec.h
+ * \brief  Compile time TLV schemas for C++ structures
+ *
+ * Declare once which tag each member of a structure is sent as and get the
+ * encode and decode code generated by the compiler.
+@verbatim
+struct intf_t {
+    uint32_t ifindex;
+    uint64_t speed;
+    bool up;
+    std::string name;
+};
+
+typedef std_tlv_schema<intf_t,
+        STD_TLV_FIELD(intf_t, ifindex, ATTR_IFINDEX),
+        STD_TLV_FIELD(intf_t, speed, ATTR_SPEED),
+        STD_TLV_FIELD(intf_t, up, ATTR_UP),
+        STD_TLV_FIELD(intf_t, name, ATTR_NAME)> intf_schema;
+
+size_t len = intf_schema::encode(intf, buf, sizeof(buf));
+...
+intf_t got;
+bool ok = intf_schema::decode(got, buf, len);
+@endverbatim
+ *
+ * The output is the same as std_tlv_add and std_tlv_add_u16/32/64 so it can be
+ * read with std_tlv_find_next and the other way round.  Integers, bools and
+ * enums are sent little endian in their own size, std::string and
+ * std::vector<uint8_t> as their bytes, and a member that is itself a structure
+ * as nested TLVs with STD_TLV_NESTED and the member's schema.
+ *
+ * encode works out the exact size and then writes each member in turn with
+ * no loops or lookups, for a schema of fixed size members encode_size is a
+ * compile time constant (fixed_size).  decode makes one pass over the buffer
+ * and picks the member for each tag with comparisons against constant tags
+ * that the compiler can turn into a jump table.  Neither allocates unless a
+ * string or vector member has to.
+ */
+
+#ifndef _STD_TLV_CODEC_H_
+#define _STD_TLV_CODEC_H_
+
+#ifndef __cplusplus
+#error "std_tlv_codec.h is C++ only"
+#endif
+
+#include "std_tlv.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * How a member type is put into a TLV value.  Specialize it to add types -
+ * a codec has
+ *  fixed, fixed_len    - true and the size if the value always has that size
+ *  size(v)             - the size of the value
+ *  put(p, v)           - write exactly size(v) bytes
+ *  get(v, p, len)      - read the value, false if len is wrong for the type
+ */
+template <typename T, typename Enable = void>
+struct std_tlv_codec;
+
+/* integers, bools and enums - little endian in their own size */
+template <typename T>
+struct std_tlv_codec<T, typename std::enable_if<std::is_integral<T>::value ||
+        std::is_enum<T>::value>::type> {
+    static constexpr bool fixed = true;
+    static constexpr size_t fixed_len = sizeof(T);
+
+    static size_t size(const T &) { return sizeof(T); }
+
+    static void put(uint8_t *p, const T &v) {
+        uint64_t u = (uint64_t)v;
+        for (size_t ix = 0; ix < sizeof(T); ++ix) p[ix] = (uint8_t)(u >> (8 * ix));
+    }
+
+    static bool get(T &v, const uint8_t *p, size_t len) {
+        uint64_t u = 0;
+        if (len != sizeof(T)) return false;
+        for (size_t ix = 0; ix < sizeof(T); ++ix) u |= (uint64_t)p[ix] << (8 * ix);
+        v = (T)u;
+        return true;
+    }
+};
+
+template <>
+struct std_tlv_codec<std::string> {
+    static constexpr bool fixed = false;
+    static constexpr size_t fixed_len = 0;
+    static size_t size(const std::string &v) { return v.size(); }
+    static void put(uint8_t *p, const std::string &v) { memcpy(p, v.data(), v.size()); }
+    static bool get(std::string &v, const uint8_t *p, size_t len) {
+        v.assign((const char *)p, len);
+        return true;
+    }
+};
+
+template <>
+struct std_tlv_codec<std::vector<uint8_t> > {
+    static constexpr bool fixed = false;
+    static constexpr size_t fixed_len = 0;
+    static size_t size(const std::vector<uint8_t> &v) { return v.size(); }
+    static void put(uint8_t *p, const std::vector<uint8_t> &v) {
+        if (!v.empty()) memcpy(p, &v[0], v.size());
+    }
+    static bool get(std::vector<uint8_t> &v, const uint8_t *p, size_t len) {
+        v.assign(p, p + len);
+        return true;
+    }
+};
+
+/**
+ * One member of a structure sent with a tag.  Use STD_TLV_FIELD or STD_TLV_NESTED
+ */
+template <typename C, typename T, T C::*M, std_tlv_tag_t Tag,
+          typename Codec = std_tlv_codec<T> >
+struct std_tlv_field {
+    static constexpr std_tlv_tag_t tag = Tag;
+    static constexpr bool fixed = Codec::fixed;
+    static constexpr size_t fixed_len = STD_TLV_HDR_LEN + Codec::fixed_len;
+
+    static size_t size(const C &obj) {
+        return fixed ? fixed_len : STD_TLV_HDR_LEN + Codec::size(obj.*M);
+    }
+
+    static uint8_t * put(uint8_t *p, const C &obj) {
+        size_t len = fixed ? Codec::fixed_len : Codec::size(obj.*M);
+        std_tlv_set_tag(p, Tag);
+        std_tlv_set_len(p, len);
+        Codec::put(p + STD_TLV_HDR_LEN, obj.*M);
+        return p + STD_TLV_HDR_LEN + len;
+    }
+
+    static bool get(C &obj, const uint8_t *val, size_t len) {
+        return Codec::get(obj.*M, val, len);
+    }
+};
+
+/** A member sent as a TLV of its own type */
+#define STD_TLV_FIELD(cls, member, tag) \
+    std_tlv_field<cls, decltype(cls::member), &cls::member, (tag)>
+
+/** A structure member sent as nested TLVs using its schema */
+#define STD_TLV_NESTED(cls, member, tag, schema) \
+    std_tlv_field<cls, decltype(cls::member), &cls::member, (tag), schema>
+
+/* compile time totals over the fields */
+template <typename... Fields>
+struct std_tlv_fields_sum {
+    static constexpr bool fixed = true;
+    static constexpr size_t size = 0;
+};
+
+template <typename F, typename... Rest>
+struct std_tlv_fields_sum<F, Rest...> {
+    static constexpr bool fixed = F::fixed && std_tlv_fields_sum<Rest...>::fixed;
+    static constexpr size_t size = F::fixed_len + std_tlv_fields_sum<Rest...>::size;
+};
+
+/**
+ * The schema of a structure - the list of its fields.  A schema is also the
+ * codec of the structure so that it can be nested in another one
+ */
+template <typename C, typename... Fields>
+struct std_tlv_schema {
+    typedef std_tlv_fields_sum<Fields...> sum;
+
+    /** true if every field has a fixed size */
+    static constexpr bool fixed = sum::fixed;
+    /** the encoded size when fixed */
+    static constexpr size_t fixed_len = sum::fixed ? sum::size : 0;
+    static constexpr size_t fixed_size = fixed_len;
+
+    /**
+     * Get the exact size that encode will write
+     * @param obj the structure
+     * @return the size in bytes
+     */
+    static size_t encode_size(const C &obj) {
+        if (fixed) return fixed_len;
+        size_t total = 0;
+        int expand[] = { 0, ((total += Fields::size(obj)), 0)... };
+        (void)expand;
+        return total;
+    }
+
+    /**
+     * Encode a structure
+     * @param obj the structure
+     * @param buf the buffer
+     * @param len the size of the buffer
+     * @return the number of bytes written or 0 if the buffer is too small
+     */
+    static size_t encode(const C &obj, void *buf, size_t len) {
+        size_t need = encode_size(obj);
+        if (need > len) return 0;
+        put((uint8_t *)buf, obj);
+        return need;
+    }
+
+    /**
+     * Decode a structure.  Tags that aren't in the schema are skipped, members
+     * whose tags aren't in the buffer are left as they were
+     * @param obj the structure to fill in
+     * @param buf the buffer
+     * @param len the length of the buffer
+     * @return false if the buffer isn't valid or a value has the wrong size
+     */
+    static bool decode(C &obj, const void *buf, size_t len) {
+        const uint8_t *p = (const uint8_t *)buf;
+        bool ok = true;
+        while (len > 0 && ok) {
+            if (len < STD_TLV_HDR_LEN) return false;
+            std_tlv_tag_t tag = std_tlv_tag((void *)p);
+            std_tlv_len_t vlen = std_tlv_len((void *)p);
+            if (vlen > len - STD_TLV_HDR_LEN) return false;
+            const uint8_t *val = p + STD_TLV_HDR_LEN;
+            int expand[] = { 0, ((tag == Fields::tag &&
+                    (ok = Fields::get(obj, val, (size_t)vlen))), 0)... };
+            (void)expand;
+            p = val + vlen;
+            len -= STD_TLV_HDR_LEN + (size_t)vlen;
+        }
+        return ok;
+    }
+
+    /* the codec interface for nesting */
+    static size_t size(const C &obj) { return encode_size(obj); }
+
+    static void put(uint8_t *p, const C &obj) {
+        int expand[] = { 0, ((p = Fields::put(p, obj)), 0)... };
+        (void)expand;
+    }
+
+    static bool get(C &obj, const uint8_t *p, size_t len) { return decode(obj, p, len); }
+};
+
+/* definitions for the constants in case they are used by reference */
+template <typename T>
+constexpr bool std_tlv_codec<T, typename std::enable_if<std::is_integral<T>::value ||
+        std::is_enum<T>::value>::type>::fixed;
+template <typename T>
+constexpr size_t std_tlv_codec<T, typename std::enable_if<std::is_integral<T>::value ||
+        std::is_enum<T>::value>::type>::fixed_len;
+
+template <typename C, typename T, T C::*M, std_tlv_tag_t Tag, typename Codec>
+constexpr std_tlv_tag_t std_tlv_field<C, T, M, Tag, Codec>::tag;
+template <typename C, typename T, T C::*M, std_tlv_tag_t Tag, typename Codec>
+constexpr bool std_tlv_field<C, T, M, Tag, Codec>::fixed;
+template <typename C, typename T, T C::*M, std_tlv_tag_t Tag, typename Codec>
+constexpr size_t std_tlv_field<C, T, M, Tag, Codec>::fixed_len;
+
+template <typename C, typename... Fields>
+constexpr bool std_tlv_schema<C, Fields...>::fixed;
+template <typename C, typename... Fields>
+constexpr size_t std_tlv_schema<C, Fields...>::fixed_len;
+template <typename C, typename... Fields>
+constexpr size_t std_tlv_schema<C, Fields...>::fixed_size;
+
+#endif /* _STD_TLV_CODEC_H_ */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_index.h
+ */
+
+/*!
+ * \file   std_tlv_index.h
+ * \brief  Tag index over a TLV buffer for repeated lookups
+ *
+ * std_tlv_find_next walks the buffer from the start for every tag so pulling
+ * n attributes out of a message costs O(n^2).  The index walks the buffer once,
+ * checks that every TLV fits, and keeps the (tag, offset) pairs sorted by tag
+ * so that each lookup is a binary search.  Nested TLVs are indexed the first
+ * time std_tlv_index_efind goes into them and kept for the next lookup.
+ *
+ * The index points into the caller's buffer which must not change while the
+ * index is in use.  Not thread safe - lookups can add nested levels.
+ */
+
+#ifndef _STD_TLV_INDEX_H_
+#define _STD_TLV_INDEX_H_
+
+#include "std_error_codes.h"
+#include "std_tlv.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque TLV index */
+typedef struct std_tlv_index_s std_tlv_index_t;
+
+/**
+ * Create an empty index.  One index can be built over many buffers in turn
+ * and keeps its memory between them
+ * @return the index or NULL if out of memory
+ */
+std_tlv_index_t * std_tlv_index_create(void);
+
+/**
+ * Free an index
+ * @param idx the index
+ */
+void std_tlv_index_free(std_tlv_index_t *idx);
+
+/**
+ * Index the TLVs in a buffer, replacing whatever the index held before
+ * @param idx the index
+ * @param data the TLV buffer
+ * @param len the length of the buffer - the TLVs must fill it exactly
+ * @return STD_ERR_OK, STD_ERR(COM,PARAM,0) if a TLV runs past the end of the
+ *      buffer or there are stray bytes at the end, or STD_ERR(COM,NOMEM,0)
+ */
+t_std_error std_tlv_index_build(std_tlv_index_t *idx, void *data, size_t len);
+
+/**
+ * Find the first TLV with a tag at the top level
+ * @param idx the index
+ * @param tag the tag to find
+ * @return the TLV or NULL if there isn't one
+ */
+void * std_tlv_index_find(std_tlv_index_t *idx, std_tlv_tag_t tag);
+
+/**
+ * Find all the TLVs with a tag at the top level in buffer order
+ * @param idx the index
+ * @param tag the tag to find
+ * @param tlvs filled in with the TLVs found
+ * @param max the size of tlvs
+ * @return the number of TLVs with the tag (may be more than max)
+ */
+size_t std_tlv_index_find_all(std_tlv_index_t *idx, std_tlv_tag_t tag, void **tlvs,
+        size_t max);
+
+/**
+ * Find a nested TLV by its path of tags - the same as std_tlv_efind but the
+ * levels that it goes into are indexed
+ * @param idx the index
+ * @param tags the tags from the top level down
+ * @param tlen the number of tags
+ * @param dlen [out] the space left in the enclosing TLV from the TLV found
+ *      (as std_tlv_efind)
+ * @return the TLV or NULL if not found or a level on the way isn't valid TLVs
+ */
+void * std_tlv_index_efind(std_tlv_index_t *idx, const std_tlv_tag_t *tags, size_t tlen,
+        size_t *dlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_TLV_INDEX_H_ */
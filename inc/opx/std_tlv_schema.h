@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_schema.h
+ */
+
+/*!
+ * \file   std_tlv_schema.h
+ * \brief  Validate TLV buffers once and extract many attributes in one scan
+ *
+ * std_tlv_validate checks a whole buffer, nested levels included, so that the
+ * reader can then walk it with the unchecked accessors.
+ *
+ * A schema maps tags to the members of a C structure.  std_tlv_extract walks
+ * the buffer once, looks each tag up in the schema and stores the value in the
+ * member, instead of a std_tlv_find_next per member.
+@verbatim
+typedef struct {
+    uint32_t ifindex;
+    uint64_t speed;
+    char name[32];
+    size_t name_len;
+} intf_t;
+
+static const std_tlv_field_t intf_fields[] = {
+    { ATTR_IFINDEX, STD_TLV_FIELD_U32, offsetof(intf_t,ifindex), 0, STD_TLV_NO_FIELD, NULL },
+    { ATTR_SPEED, STD_TLV_FIELD_U64, offsetof(intf_t,speed), 0, STD_TLV_NO_FIELD, NULL },
+    { ATTR_NAME, STD_TLV_FIELD_BYTES, offsetof(intf_t,name), sizeof(((intf_t*)0)->name),
+            offsetof(intf_t,name_len), NULL },
+};
+std_tlv_schema_t *schema = std_tlv_schema_create(intf_fields,3);
+...
+intf_t intf = {0};
+if (std_tlv_extract(schema,msg,msg_len,&intf,NULL)==STD_ERR_OK) ...
+@endverbatim
+ */
+
+#ifndef _STD_TLV_SCHEMA_H_
+#define _STD_TLV_SCHEMA_H_
+
+#include "std_error_codes.h"
+#include "std_tlv.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Check that every TLV in a buffer fits and that the buffer has no stray bytes
+ * at the end.  The values of TLVs that nested says hold TLVs are checked the
+ * same way
+ * @param data the buffer
+ * @param len the length of the buffer
+ * @param nested says which tags hold nested TLVs (NULL if none do)
+ * @param context passed to nested
+ * @return STD_ERR_OK or STD_ERR(COM,PARAM,0) if the buffer is not valid
+ */
+t_std_error std_tlv_validate(void *data, size_t len, std_tlv_nested_fn nested,
+        void *context);
+
+/** No length member for a field */
+#define STD_TLV_NO_FIELD ((size_t)-1)
+
+typedef enum {
+    STD_TLV_FIELD_U8,       //!< uint8_t member, the value must be 1 byte
+    STD_TLV_FIELD_U16,      //!< uint16_t member, the value must be 2 bytes (std_tlv_add_u16)
+    STD_TLV_FIELD_U32,      //!< uint32_t member, the value must be 4 bytes (std_tlv_add_u32)
+    STD_TLV_FIELD_U64,      //!< uint64_t member, the value must be 8 bytes (std_tlv_add_u64)
+    STD_TLV_FIELD_BYTES,    //!< byte array member of 'size' bytes that the value is copied to
+    STD_TLV_FIELD_PTR,      //!< void * member set to point at the value in the buffer
+    STD_TLV_FIELD_NESTED,   //!< the value holds TLVs that are extracted with 'nested'
+} std_tlv_field_type_t;
+
+struct std_tlv_schema_s;
+
+/**
+ * One member of the structure
+ */
+typedef struct {
+    std_tlv_tag_t tag;              //!< the tag of the attribute
+    std_tlv_field_type_t type;
+    size_t offset;                  //!< offsetof the member
+    size_t size;                    //!< the size of a STD_TLV_FIELD_BYTES member
+    size_t len_offset;              //!< offsetof a size_t member for the length of
+                                    //!< a BYTES or PTR value or STD_TLV_NO_FIELD
+    const struct std_tlv_schema_s *nested;  //!< the schema of a STD_TLV_FIELD_NESTED value.
+                                    //!< Its offsets are in the same structure
+} std_tlv_field_t;
+
+/** Opaque compiled schema */
+typedef struct std_tlv_schema_s std_tlv_schema_t;
+
+/**
+ * Compile a schema.  The fields are copied, nested schemas are referenced and
+ * must be kept until this one is freed
+ * @param fields the members
+ * @param num the number of members
+ * @return the schema or NULL if out of memory or a tag is listed twice
+ */
+std_tlv_schema_t * std_tlv_schema_create(const std_tlv_field_t *fields, size_t num);
+
+/**
+ * Free a schema
+ * @param schema the schema
+ */
+void std_tlv_schema_free(std_tlv_schema_t *schema);
+
+/**
+ * Fill in a structure from a TLV buffer in one pass.  Tags that aren't in the
+ * schema are skipped.  If a tag is there more than once the last one is used.
+ * Members whose tag isn't in the buffer are not touched
+ * @param schema the schema
+ * @param data the buffer
+ * @param len the length of the buffer
+ * @param obj the structure to fill in
+ * @param found optional array with an entry per schema field that is set to
+ *      true for the fields found and false for the others.  Fields of nested
+ *      schemas are not reported
+ * @return STD_ERR_OK, STD_ERR(COM,PARAM,0) if the buffer isn't valid or a value
+ *      doesn't have the size of its member or STD_ERR(COM,TOOBIG,0) if a value
+ *      doesn't fit in a BYTES member
+ */
+t_std_error std_tlv_extract(const std_tlv_schema_t *schema, void *data, size_t len,
+        void *obj, bool *found);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_TLV_SCHEMA_H_ */
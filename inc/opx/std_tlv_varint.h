@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_varint.h
+ */
+
+/*!
+ * \file   std_tlv_varint.h
+ * \brief  Compact TLV format with varint tags and lengths
+ *
+ * The std_tlv format spends 16 bytes of header on every attribute.  The varint
+ * TLV (vtlv) format writes the tag and length as unsigned LEB128 - 7 bits a
+ * byte, low bits first, the top bit set on all but the last byte - so a small
+ * tag with a short value costs 2 bytes of header.  Values are unchanged, so
+ * the std_vtlv_data_u16/u32/u64 values are the same little endian fields as
+ * with std_tlv.
+ *
+ * A vtlv message starts with the 4 byte STD_VTLV_MAGIC so that a reader can
+ * tell the formats apart with std_tlv_format.  The magic is only at the start
+ * of the message, nested vtlvs don't have it.  (A std_tlv message would be
+ * taken for a vtlv one only if its first tag had the magic as its low 32 bits.)
+ *
+ * The std_vtlv functions mirror the std_tlv ones and work on the TLVs after the
+ * magic - use std_vtlv_start to write the magic and std_vtlv_first to skip it.
+ */
+
+#ifndef _STD_TLV_VARINT_H_
+#define _STD_TLV_VARINT_H_
+
+#include "std_error_codes.h"
+#include "std_tlv.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The first bytes of a vtlv message */
+#define STD_VTLV_MAGIC          "\xfeVT\x01"
+#define STD_VTLV_MAGIC_LEN      4
+
+/** The longest a varint can be */
+#define STD_VTLV_VARINT_MAX     10
+
+/** The longest a vtlv header can be */
+#define STD_VTLV_MAX_HDR_LEN    (2*STD_VTLV_VARINT_MAX)
+
+typedef enum {
+    STD_TLV_FORMAT_FIXED,   //!< std_tlv - 64 bit tags and lengths
+    STD_TLV_FORMAT_VARINT,  //!< std_vtlv - varint tags and lengths
+} std_tlv_format_t;
+
+/**
+ * Tell which format a message is in
+ * @param data the message
+ * @param len the length of the message
+ * @return STD_TLV_FORMAT_VARINT if it starts with STD_VTLV_MAGIC otherwise
+ *      STD_TLV_FORMAT_FIXED
+ */
+static inline std_tlv_format_t std_tlv_format(const void *data, size_t len) {
+    if (len >= STD_VTLV_MAGIC_LEN && memcmp(data,STD_VTLV_MAGIC,STD_VTLV_MAGIC_LEN)==0)
+        return STD_TLV_FORMAT_VARINT;
+    return STD_TLV_FORMAT_FIXED;
+}
+
+/**
+ * Get the number of bytes that a value takes as a varint
+ * @param v the value
+ * @return the length of the varint
+ */
+static inline size_t std_vtlv_varint_len(uint64_t v) {
+    size_t len = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++len;
+    }
+    return len;
+}
+
+/**
+ * Write a varint
+ * @param p where to write - must have room for std_vtlv_varint_len(v) bytes
+ * @param v the value
+ * @return the number of bytes written
+ */
+static inline size_t std_vtlv_put_varint(uint8_t *p, uint64_t v) {
+    size_t len = 0;
+    while (v >= 0x80) {
+        p[len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[len++] = (uint8_t)v;
+    return len;
+}
+
+/**
+ * Read a varint checking that it is inside the buffer and no longer than a
+ * 64 bit value needs
+ * @param p the varint
+ * @param left the bytes available at p
+ * @param v [out] the value
+ * @return the number of bytes read or 0 if the varint isn't valid
+ */
+static inline size_t std_vtlv_get_varint(const uint8_t *p, size_t left, uint64_t *v) {
+    uint64_t val = 0;
+    size_t ix;
+    if (left > STD_VTLV_VARINT_MAX) left = STD_VTLV_VARINT_MAX;
+    for (ix = 0; ix < left ; ++ix) {
+        val |= (uint64_t)(p[ix] & 0x7f) << (7*ix);
+        if ((p[ix] & 0x80)==0) {
+            /* the 10th byte can only hold the top bit */
+            if (ix == STD_VTLV_VARINT_MAX-1 && p[ix] > 1) return 0;
+            *v = val;
+            return ix+1;
+        }
+    }
+    return 0;
+}
+
+/* read a varint that is known to be valid */
+static inline size_t std_vtlv_get_varint_unchecked(const uint8_t *p, uint64_t *v) {
+    uint64_t val = p[0] & 0x7f;
+    size_t ix = 0;
+    while (p[ix] & 0x80) {
+        ++ix;
+        val |= (uint64_t)(p[ix] & 0x7f) << (7*ix);
+    }
+    *v = val;
+    return ix+1;
+}
+
+/**
+ * Write the magic at the start of a vtlv message
+ * @param data the buffer
+ * @param data_len the space in the buffer (will be updated)
+ * @return the place for the first TLV or NULL if there isn't room
+ */
+static inline void * std_vtlv_start(void *data, size_t *data_len) {
+    if (*data_len < STD_VTLV_MAGIC_LEN) return NULL;
+    memcpy(data,STD_VTLV_MAGIC,STD_VTLV_MAGIC_LEN);
+    *data_len -= STD_VTLV_MAGIC_LEN;
+    return (uint8_t*)data + STD_VTLV_MAGIC_LEN;
+}
+
+/**
+ * Get the first TLV of a vtlv message
+ * @param data the message
+ * @param len the length of the message (will be updated)
+ * @return the first TLV or NULL if the message isn't in the vtlv format
+ */
+static inline void * std_vtlv_first(void *data, size_t *len) {
+    if (std_tlv_format(data,*len) != STD_TLV_FORMAT_VARINT) return NULL;
+    *len -= STD_VTLV_MAGIC_LEN;
+    return (uint8_t*)data + STD_VTLV_MAGIC_LEN;
+}
+
+/**
+ * Get the tag of a TLV
+ * @param data the TLV
+ * @return the tag
+ */
+static inline std_tlv_tag_t std_vtlv_tag(void *data) {
+    uint64_t tag;
+    std_vtlv_get_varint_unchecked((const uint8_t*)data,&tag);
+    return tag;
+}
+
+/**
+ * Get the length of the header of a TLV
+ * @param data the TLV
+ * @return the length of the tag and length fields
+ */
+static inline size_t std_vtlv_hdr_len(void *data) {
+    uint64_t v;
+    size_t hlen = std_vtlv_get_varint_unchecked((const uint8_t*)data,&v);
+    return hlen + std_vtlv_get_varint_unchecked((const uint8_t*)data + hlen,&v);
+}
+
+/**
+ * Get the length of the value of a TLV
+ * @param data the TLV
+ * @return the length
+ */
+static inline std_tlv_len_t std_vtlv_len(void *data) {
+    uint64_t v;
+    size_t hlen = std_vtlv_get_varint_unchecked((const uint8_t*)data,&v);
+    std_vtlv_get_varint_unchecked((const uint8_t*)data + hlen,&v);
+    return v;
+}
+
+/**
+ * Get the length of a TLV including its header
+ * @param data the TLV
+ * @return the header and value length
+ */
+static inline std_tlv_len_t std_vtlv_total_len(void *data) {
+    return std_vtlv_hdr_len(data) + std_vtlv_len(data);
+}
+
+/**
+ * Get the value of a TLV
+ * @param data the TLV
+ * @return a pointer to the value
+ */
+static inline void * std_vtlv_data(void *data) {
+    return (uint8_t*)data + std_vtlv_hdr_len(data);
+}
+
+/**
+ * Get the value of a TLV added with std_vtlv_add_u16
+ */
+static inline uint16_t std_vtlv_data_u16(void *data) {
+    uint16_t v;
+    memcpy(&v,std_vtlv_data(data),sizeof(v));
+    return le16toh(v);
+}
+
+/**
+ * Get the value of a TLV added with std_vtlv_add_u32
+ */
+static inline uint32_t std_vtlv_data_u32(void *data) {
+    uint32_t v;
+    memcpy(&v,std_vtlv_data(data),sizeof(v));
+    return le32toh(v);
+}
+
+/**
+ * Get the value of a TLV added with std_vtlv_add_u64
+ */
+static inline uint64_t std_vtlv_data_u64(void *data) {
+    uint64_t v;
+    memcpy(&v,std_vtlv_data(data),sizeof(v));
+    return le64toh(v);
+}
+
+/**
+ * Create a TLV at data if there is room for it (as std_tlv_add)
+ * @param data the spot to place the TLV
+ * @param data_len the space left (will be updated)
+ * @param tag the tag
+ * @param len the length of the value
+ * @param content the value to copy
+ * @return a pointer to the space directly after the new TLV or NULL if there
+ *      isn't enough space
+ */
+static inline void * std_vtlv_add(void *data, size_t *data_len, std_tlv_tag_t tag,
+        std_tlv_len_t len, const void *content) {
+    size_t hlen = std_vtlv_varint_len(tag) + std_vtlv_varint_len(len);
+    uint8_t *p = (uint8_t*)data;
+    if (*data_len < hlen || *data_len - hlen < len) return NULL;
+    p += std_vtlv_put_varint(p,tag);
+    p += std_vtlv_put_varint(p,len);
+    if (len > 0) memcpy(p,content,(size_t)len);
+    *data_len -= hlen + (size_t)len;
+    return p + len;
+}
+
+/**
+ * Add a uint16_t in an endian neutral way
+ */
+static inline void * std_vtlv_add_u16(void *data, size_t *data_len, std_tlv_tag_t tag,
+        uint16_t content) {
+    content = htole16(content);
+    return std_vtlv_add(data,data_len,tag,sizeof(content),&content);
+}
+
+/**
+ * Add a uint32_t in an endian neutral way
+ */
+static inline void * std_vtlv_add_u32(void *data, size_t *data_len, std_tlv_tag_t tag,
+        uint32_t content) {
+    content = htole32(content);
+    return std_vtlv_add(data,data_len,tag,sizeof(content),&content);
+}
+
+/**
+ * Add a uint64_t in an endian neutral way
+ */
+static inline void * std_vtlv_add_u64(void *data, size_t *data_len, std_tlv_tag_t tag,
+        uint64_t content) {
+    content = htole64(content);
+    return std_vtlv_add(data,data_len,tag,sizeof(content),&content);
+}
+
+/**
+ * Check that the TLV at data has a valid header and fits in len
+ * @param data the TLV
+ * @param len the space from data
+ * @return true if the TLV is valid
+ */
+static inline bool std_vtlv_valid(void *data, size_t len) {
+    const uint8_t *p = (const uint8_t*)data;
+    uint64_t tag, vlen;
+    size_t tl, ll;
+    if (data == NULL || len == 0) return false;
+    if ((tl = std_vtlv_get_varint(p,len,&tag)) == 0) return false;
+    if ((ll = std_vtlv_get_varint(p+tl,len-tl,&vlen)) == 0) return false;
+    return vlen <= len - tl - ll;
+}
+
+/**
+ * Get the next TLV (as std_tlv_next)
+ * @param data the current TLV
+ * @param len the space from data (will be updated)
+ * @return the next TLV or NULL if at the end
+ */
+static inline void * std_vtlv_next(void *data, size_t *len) {
+    size_t tlen;
+    if (data == NULL) return NULL;
+    tlen = (size_t)std_vtlv_total_len(data);
+    if (*len < tlen) return NULL;
+    *len -= tlen;
+    return (uint8_t*)data + tlen;
+}
+
+/**
+ * Find the next TLV with a tag (as std_tlv_find_next)
+ * @param data the TLV to start at
+ * @param dlen the space from data (will be updated)
+ * @param tag the tag to find
+ * @return the TLV or NULL
+ */
+static inline void * std_vtlv_find_next(void *data, size_t *dlen, std_tlv_tag_t tag) {
+    do {
+        if (!std_vtlv_valid(data,*dlen)) return NULL;
+        if (std_vtlv_tag(data) == tag) return data;
+    } while ((data = std_vtlv_next(data,dlen)) != NULL);
+    return NULL;
+}
+
+/**
+ * Find a nested TLV by its path of tags (as std_tlv_efind)
+ * @param data the first TLV
+ * @param dlen [in/out] the space from data, on return the space from the TLV found
+ * @param tags the tags from the top level down
+ * @param tlen the number of tags
+ * @return the TLV or NULL
+ */
+static inline void * std_vtlv_efind(void *data, size_t *dlen, const std_tlv_tag_t *tags,
+        size_t tlen) {
+    size_t ix = 0;
+    size_t len = *dlen;
+    for ( ; ix < tlen; ++ix) {
+        data = std_vtlv_find_next(data,&len,tags[ix]);
+        if (data == NULL) return NULL;
+        if (ix+1 == tlen) break;
+        len = (size_t)std_vtlv_len(data);
+        data = std_vtlv_data(data);
+    }
+    *dlen = len;
+    return data;
+}
+
+/**
+ * Convert a std_tlv message to a vtlv message (with the magic).  Pass dst NULL
+ * to get the size that is needed
+ * @param src the std_tlv message
+ * @param src_len the length of the message
+ * @param dst the buffer for the vtlv message or NULL
+ * @param dst_len [in/out] the size of dst, on return the length of the vtlv message
+ * @param nested says which tags hold nested TLVs (NULL if none do)
+ * @param context passed to nested
+ * @return STD_ERR_OK, STD_ERR(COM,PARAM,0) if src isn't valid or
+ *      STD_ERR(COM,TOOBIG,0) if dst is too small
+ */
+t_std_error std_tlv_to_vtlv(void *src, size_t src_len, void *dst, size_t *dst_len,
+        std_tlv_nested_fn nested, void *context);
+
+/**
+ * Convert a vtlv message (with the magic) to a std_tlv message.  Pass dst NULL
+ * to get the size that is needed
+ * @param src the vtlv message
+ * @param src_len the length of the message
+ * @param dst the buffer for the std_tlv message or NULL
+ * @param dst_len [in/out] the size of dst, on return the length of the std_tlv message
+ * @param nested says which tags hold nested TLVs (NULL if none do)
+ * @param context passed to nested
+ * @return STD_ERR_OK, STD_ERR(COM,PARAM,0) if src isn't valid or
+ *      STD_ERR(COM,TOOBIG,0) if dst is too small
+ */
+t_std_error std_vtlv_to_tlv(void *src, size_t src_len, void *dst, size_t *dst_len,
+        std_tlv_nested_fn nested, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STD_TLV_VARINT_H_ */
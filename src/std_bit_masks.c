@@ -26,6 +26,8 @@
 #include <assert.h>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <endian.h>
+#include <stdint.h>
 #include "std_bit_masks.h"
 
 static inline unsigned int bittobytelen(unsigned int len) {
@@ -60,98 +62,493 @@ void std_bitmaparray_free_data (void *bitMap) {
     if (bitMap) { free (bitMap); }
 }
 
-static int highest_bit[] = {
-//    0 1 2 3 4 5 6 7 8 9 a b c d e f
-    0,1,2,2,3,3,3,3,4,4,4,4,4,4,4,4,        //0
-    5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,        //10
-    6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,        //20
-    6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,        //30
-    7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,        //40
-    7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,        //50
-    7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,        //60
-    7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,        //70
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,        //80
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,        //90
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,        //a0
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,        //b0
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,        //c0
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,        //d0
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,        //e0
-    8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8          //f0
-};
+/*
+ * The bit array is a byte array with bit 0 as the lsb of byte 0.  Loading 8
+ * bytes little endian gives a word with the same bit numbering, so the scans
+ * work a word (or a vector) at a time and only look at single bytes at the
+ * edges.  The vector versions are picked at load time based on the CPU.
+ */
 
-static int lowest_bit[] = {
-//    0 1 2 3 4 5 6 7 8 9 a b c d e f
-    0,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //00
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //10
-    6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //20
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //30
-    7,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //40
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //50
-    6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //60
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //70
-    8,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //80
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //90
-    6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //a0
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //b0
-    7,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //c0
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //d0
-    6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //e0
-    5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,            //f0
-};
+/* return the index of the first byte in [ix,mx) that isn't 'skip' or mx */
+typedef size_t (*std_bit_skip_fwd_fn)(const uint8_t *array, size_t ix, size_t mx,
+        uint8_t skip);
+/* return one past the index of the last byte in [0,mx) that isn't 'skip' or 0 */
+typedef size_t (*std_bit_skip_back_fn)(const uint8_t *array, size_t mx, uint8_t skip);
+
+static inline uint64_t std_bit_load64(const uint8_t *p) {
+    uint64_t w;
+    memcpy(&w,p,sizeof(w));
+    return le64toh(w);
+}
+
+static size_t std_bit_skip_fwd_word(const uint8_t *array, size_t ix, size_t mx,
+        uint8_t skip) {
+    uint64_t pattern = 0x0101010101010101ULL * skip;
+
+    for ( ; ix + sizeof(uint64_t) <= mx ; ix += sizeof(uint64_t)) {
+        uint64_t w = std_bit_load64(array+ix) ^ pattern;
+        if (w!=0) return ix + (__builtin_ctzll(w) / 8);
+    }
+    for ( ; ix < mx ; ++ix) {
+        if (array[ix]!=skip) break;
+    }
+    return ix;
+}
+
+static size_t std_bit_skip_back_word(const uint8_t *array, size_t mx, uint8_t skip) {
+    uint64_t pattern = 0x0101010101010101ULL * skip;
+
+    for ( ; mx >= sizeof(uint64_t) ; mx -= sizeof(uint64_t)) {
+        uint64_t w = std_bit_load64(array + mx - sizeof(uint64_t)) ^ pattern;
+        if (w!=0) return mx - (__builtin_clzll(w) / 8);
+    }
+    for ( ; mx > 0 ; --mx) {
+        if (array[mx-1]!=skip) break;
+    }
+    return mx;
+}
+
+typedef enum {
+    STD_BIT_OP_AND,
+    STD_BIT_OP_OR,
+    STD_BIT_OP_XOR,
+    STD_BIT_OP_ANDNOT,      /* a & ~b */
+    STD_BIT_OP_MAX
+} std_bit_op_t;
+
+typedef void (*std_bit_op_fn)(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t bytes);
+/* true if a op b has any bit set - and, xor and andnot only */
+typedef bool (*std_bit_any_fn)(const uint8_t *a, const uint8_t *b, size_t bytes);
+typedef size_t (*std_bit_popcount_fn)(const uint8_t *array, size_t bytes);
+
+/* The op is always a constant so the switch folds away once inlined */
+static inline uint64_t std_bit_op64(std_bit_op_t op, uint64_t a, uint64_t b) {
+    switch (op) {
+    case STD_BIT_OP_AND: return a & b;
+    case STD_BIT_OP_OR: return a | b;
+    case STD_BIT_OP_XOR: return a ^ b;
+    default: return a & ~b;
+    }
+}
+
+static inline void std_bit_op_word(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+        size_t bytes, std_bit_op_t op) {
+    size_t ix = 0;
+    uint64_t x, y;
+
+    for ( ; ix + sizeof(uint64_t) <= bytes ; ix += sizeof(uint64_t)) {
+        memcpy(&x,a+ix,sizeof(x));
+        memcpy(&y,b+ix,sizeof(y));
+        x = std_bit_op64(op,x,y);
+        memcpy(dst+ix,&x,sizeof(x));
+    }
+    for ( ; ix < bytes ; ++ix) {
+        dst[ix] = (uint8_t)std_bit_op64(op,a[ix],b[ix]);
+    }
+}
+
+static inline bool std_bit_any_word(const uint8_t *a, const uint8_t *b, size_t bytes,
+        std_bit_op_t op) {
+    size_t ix = 0;
+    uint64_t x, y;
+
+    for ( ; ix + sizeof(uint64_t) <= bytes ; ix += sizeof(uint64_t)) {
+        memcpy(&x,a+ix,sizeof(x));
+        memcpy(&y,b+ix,sizeof(y));
+        if (std_bit_op64(op,x,y)!=0) return true;
+    }
+    for ( ; ix < bytes ; ++ix) {
+        if ((uint8_t)std_bit_op64(op,a[ix],b[ix])!=0) return true;
+    }
+    return false;
+}
+
+static inline size_t std_bit_popcount64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+}
 
-static inline unsigned int std_find_last_bit8(register unsigned int byte, register unsigned int from) {
-    register unsigned int mask = ((unsigned int )(~0)) >> from;
-    return highest_bit[byte&mask];
+static size_t std_bit_popcount_word(const uint8_t *array, size_t bytes) {
+    size_t ix = 0;
+    size_t count = 0;
+    uint64_t x;
+
+    for ( ; ix + sizeof(uint64_t) <= bytes ; ix += sizeof(uint64_t)) {
+        memcpy(&x,array+ix,sizeof(x));
+        count += std_bit_popcount64(x);
+    }
+    for ( ; ix < bytes ; ++ix) {
+        count += std_bit_popcount64(array[ix]);
+    }
+    return count;
 }
 
-static inline unsigned int std_find_first_bit8(register unsigned int byte, register unsigned int from) {
-    register unsigned int mask = ((unsigned int )(~0)) << from;
-    return lowest_bit[byte&mask];
+#define STD_BIT_KERNELS(impl, op_name, op) \
+static void std_bit_##op_name##_##impl(uint8_t *dst, const uint8_t *a, const uint8_t *b, \
+        size_t bytes) { \
+    std_bit_op_##impl(dst,a,b,bytes,op); \
+} \
+static bool std_bit_any_##op_name##_##impl(const uint8_t *a, const uint8_t *b, \
+        size_t bytes) { \
+    return std_bit_any_##impl(a,b,bytes,op); \
 }
 
+STD_BIT_KERNELS(word, and, STD_BIT_OP_AND)
+STD_BIT_KERNELS(word, or, STD_BIT_OP_OR)
+STD_BIT_KERNELS(word, xor, STD_BIT_OP_XOR)
+STD_BIT_KERNELS(word, andnot, STD_BIT_OP_ANDNOT)
+
+/* The scan and bulk kernels for the CPU we are running on */
+typedef struct {
+    std_bit_skip_fwd_fn skip_fwd;
+    std_bit_skip_back_fn skip_back;
+    std_bit_op_fn op[STD_BIT_OP_MAX];
+    std_bit_any_fn any[STD_BIT_OP_MAX];
+    std_bit_popcount_fn popcount;
+} std_bit_impl_t;
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static size_t std_bit_skip_fwd_avx2(const uint8_t *array, size_t ix, size_t mx,
+        uint8_t skip) {
+    __m256i pattern = _mm256_set1_epi8((char)skip);
+
+    for ( ; ix + 32 <= mx ; ix += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(array+ix));
+        uint32_t same = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v,pattern));
+        if (same!=0xffffffff) return ix + __builtin_ctz(~same);
+    }
+    return std_bit_skip_fwd_word(array,ix,mx,skip);
+}
+
+__attribute__((target("avx2")))
+static size_t std_bit_skip_back_avx2(const uint8_t *array, size_t mx, uint8_t skip) {
+    __m256i pattern = _mm256_set1_epi8((char)skip);
+
+    for ( ; mx >= 32 ; mx -= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(array + mx - 32));
+        uint32_t same = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v,pattern));
+        if (same!=0xffffffff) return mx - __builtin_clz(~same);
+    }
+    return std_bit_skip_back_word(array,mx,skip);
+}
+
+static size_t std_bit_skip_fwd_sse2(const uint8_t *array, size_t ix, size_t mx,
+        uint8_t skip) {
+    __m128i pattern = _mm_set1_epi8((char)skip);
+
+    for ( ; ix + 16 <= mx ; ix += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(array+ix));
+        uint32_t same = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v,pattern));
+        if (same!=0xffff) return ix + __builtin_ctz(~same);
+    }
+    return std_bit_skip_fwd_word(array,ix,mx,skip);
+}
+
+static size_t std_bit_skip_back_sse2(const uint8_t *array, size_t mx, uint8_t skip) {
+    __m128i pattern = _mm_set1_epi8((char)skip);
+
+    for ( ; mx >= 16 ; mx -= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(array + mx - 16));
+        uint32_t same = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v,pattern));
+        if (same!=0xffff) return mx - (__builtin_clz((~same) & 0xffff) - 16);
+    }
+    return std_bit_skip_back_word(array,mx,skip);
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i std_bit_op256(std_bit_op_t op, __m256i a, __m256i b) {
+    switch (op) {
+    case STD_BIT_OP_AND: return _mm256_and_si256(a,b);
+    case STD_BIT_OP_OR: return _mm256_or_si256(a,b);
+    case STD_BIT_OP_XOR: return _mm256_xor_si256(a,b);
+    default: return _mm256_andnot_si256(b,a);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void std_bit_op_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+        size_t bytes, std_bit_op_t op) {
+    size_t ix = 0;
+
+    for ( ; ix + 32 <= bytes ; ix += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a+ix));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b+ix));
+        _mm256_storeu_si256((__m256i *)(dst+ix),std_bit_op256(op,va,vb));
+    }
+    std_bit_op_word(dst+ix,a+ix,b+ix,bytes-ix,op);
+}
+
+__attribute__((target("avx2")))
+static inline bool std_bit_any_avx2(const uint8_t *a, const uint8_t *b, size_t bytes,
+        std_bit_op_t op) {
+    size_t ix = 0;
+
+    for ( ; ix + 32 <= bytes ; ix += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a+ix));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b+ix));
+        __m256i r = std_bit_op256(op,va,vb);
+        if (!_mm256_testz_si256(r,r)) return true;
+    }
+    return std_bit_any_word(a+ix,b+ix,bytes-ix,op);
+}
+
+/* nibble lookup popcount - the byte counts are summed with sad every vector */
+__attribute__((target("avx2")))
+static size_t std_bit_popcount_avx2(const uint8_t *array, size_t bytes) {
+    const __m256i lookup = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                            0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    size_t ix = 0;
+
+    for ( ; ix + 32 <= bytes ; ix += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(array+ix));
+        __m256i lo = _mm256_shuffle_epi8(lookup,_mm256_and_si256(v,low));
+        __m256i hi = _mm256_shuffle_epi8(lookup,_mm256_and_si256(_mm256_srli_epi16(v,4),low));
+        acc = _mm256_add_epi64(acc,_mm256_sad_epu8(_mm256_add_epi8(lo,hi),
+                _mm256_setzero_si256()));
+    }
+    return (size_t)_mm256_extract_epi64(acc,0) + (size_t)_mm256_extract_epi64(acc,1) +
+           (size_t)_mm256_extract_epi64(acc,2) + (size_t)_mm256_extract_epi64(acc,3) +
+           std_bit_popcount_word(array+ix,bytes-ix);
+}
+
+#define STD_BIT_KERNELS_AVX2(op_name, op) \
+__attribute__((target("avx2"))) \
+static void std_bit_##op_name##_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b, \
+        size_t bytes) { \
+    std_bit_op_avx2(dst,a,b,bytes,op); \
+} \
+__attribute__((target("avx2"))) \
+static bool std_bit_any_##op_name##_avx2(const uint8_t *a, const uint8_t *b, \
+        size_t bytes) { \
+    return std_bit_any_avx2(a,b,bytes,op); \
+}
+
+STD_BIT_KERNELS_AVX2(and, STD_BIT_OP_AND)
+STD_BIT_KERNELS_AVX2(or, STD_BIT_OP_OR)
+STD_BIT_KERNELS_AVX2(xor, STD_BIT_OP_XOR)
+STD_BIT_KERNELS_AVX2(andnot, STD_BIT_OP_ANDNOT)
+
+static std_bit_impl_t std_bit_impl = {
+    std_bit_skip_fwd_sse2, std_bit_skip_back_sse2,
+    { std_bit_and_word, std_bit_or_word, std_bit_xor_word, std_bit_andnot_word },
+    { std_bit_any_and_word, std_bit_any_or_word, std_bit_any_xor_word, std_bit_any_andnot_word },
+    std_bit_popcount_word
+};
+
+__attribute__((constructor))
+static void std_bit_masks_select_impl(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        std_bit_impl_t avx2 = {
+            std_bit_skip_fwd_avx2, std_bit_skip_back_avx2,
+            { std_bit_and_avx2, std_bit_or_avx2, std_bit_xor_avx2, std_bit_andnot_avx2 },
+            { std_bit_any_and_avx2, std_bit_any_or_avx2, std_bit_any_xor_avx2,
+              std_bit_any_andnot_avx2 },
+            std_bit_popcount_avx2
+        };
+        std_bit_impl = avx2;
+    }
+}
+#else
+static std_bit_impl_t std_bit_impl = {
+    std_bit_skip_fwd_word, std_bit_skip_back_word,
+    { std_bit_and_word, std_bit_or_word, std_bit_xor_word, std_bit_andnot_word },
+    { std_bit_any_and_word, std_bit_any_or_word, std_bit_any_xor_word, std_bit_any_andnot_word },
+    std_bit_popcount_word
+};
+#endif
+
+/*
+ * Bits past len in the last byte are searched too - callers have always
+ * relied on the byte granularity so it is kept
+ */
 int std_find_first_bit(void *varray, size_t len, size_t from) {
-    register uint8_t *array = (uint8_t *)varray;
+    const uint8_t *array = (const uint8_t *)varray;
     if (from >= len) return -1;
 
     size_t ix = from/8;
-    size_t mx = (len /8) + ((len%8)!=0 ? 1 : 0);
+    size_t mx = bittobytelen(len);
 
-    size_t bit = from % 8;
-    if (bit) {
-        size_t pos = std_find_first_bit8(array[ix],bit);
-        if(pos!=0) { return pos-1+(ix*8); }
-        ++ix;
-    }
+    unsigned int b = array[ix] & (0xffu << (from % 8));
+    if (b!=0) return (ix*8) + __builtin_ctz(b);
 
-    for (; ix < mx ; ++ix ) {
-        if (array[ix]==0) { continue; }
-        return std_find_first_bit8(array[ix],0) -1 + (ix*8);
-    }
-    return -1;
+    ix = std_bit_impl.skip_fwd(array,ix+1,mx,0);
+    if (ix==mx) return -1;
+    return (ix*8) + __builtin_ctz(array[ix]);
 }
 
+/*
+ * Searches whole bytes back from the byte holding bit (len - from - 1)
+ */
 int std_find_last_bit(void *varray, size_t len, size_t from) {
-    register uint8_t *array = (uint8_t *)varray;
+    const uint8_t *array = (const uint8_t *)varray;
     if (from >= len) return -1;
 
-    from = len - from;
-    register int mx = (from/8) + (from%8!=0 ? 1 : 0);
-    if (mx==0) { return -1; }
+    size_t mx = std_bit_impl.skip_back(array,bittobytelen(len - from),0);
+    if (mx==0) return -1;
+    return ((mx-1)*8) + 31 - __builtin_clz(array[mx-1]);
+}
+
+int std_find_first_zero_bit(void *varray, size_t len, size_t from) {
+    const uint8_t *array = (const uint8_t *)varray;
+    if (from >= len) return -1;
 
-    --mx;
+    size_t ix = from/8;
+    size_t mx = bittobytelen(len);
+    size_t pos;
 
-    size_t bit = from % 8;
-    if (bit) {
-        size_t pos = std_find_last_bit8(array[mx],bit); //one based
-        if(pos!=0) { return (pos-1)+(mx*8);}
-        if (mx==0) {return -1;}
-        --mx;
+    unsigned int b = (uint8_t)~array[ix] & (0xffu << (from % 8));
+    if (b!=0) {
+        pos = (ix*8) + __builtin_ctz(b);
+    } else {
+        ix = std_bit_impl.skip_fwd(array,ix+1,mx,0xff);
+        if (ix==mx) return -1;
+        pos = (ix*8) + __builtin_ctz((uint8_t)~array[ix]);
     }
+    return (pos < len) ? (int)pos : -1;
+}
+
+int std_find_next_set_bit(void *varray, size_t len, int prev) {
+    int pos = std_find_first_bit(varray,len,(size_t)(prev+1));
+    return (pos >= 0 && (size_t)pos < len) ? pos : -1;
+}
+
+/* mask of the bits of the last byte that are below len */
+static inline uint8_t std_bit_tail_mask(size_t len) {
+    return (uint8_t)((1u << (len % 8)) - 1);
+}
+
+static void std_bitmap_op(void *dst, const void *a, const void *b, size_t len,
+        std_bit_op_t op) {
+    std_bit_impl.op[op]((uint8_t *)dst,(const uint8_t *)a,(const uint8_t *)b,
+            bittobytelen(len));
+}
+
+void std_bitmap_and(void *dst, const void *a, const void *b, size_t len) {
+    std_bitmap_op(dst,a,b,len,STD_BIT_OP_AND);
+}
+
+void std_bitmap_or(void *dst, const void *a, const void *b, size_t len) {
+    std_bitmap_op(dst,a,b,len,STD_BIT_OP_OR);
+}
+
+void std_bitmap_xor(void *dst, const void *a, const void *b, size_t len) {
+    std_bitmap_op(dst,a,b,len,STD_BIT_OP_XOR);
+}
+
+void std_bitmap_andnot(void *dst, const void *a, const void *b, size_t len) {
+    std_bitmap_op(dst,a,b,len,STD_BIT_OP_ANDNOT);
+}
+
+/* any bit below len set in a op b - the bits past len are ignored */
+static bool std_bitmap_any(const void *va, const void *vb, size_t len, std_bit_op_t op) {
+    const uint8_t *a = (const uint8_t *)va;
+    const uint8_t *b = (const uint8_t *)vb;
+    size_t full = len / 8;
+
+    if (std_bit_impl.any[op](a,b,full)) return true;
+    if (len % 8 == 0) return false;
+    return (std_bit_op64(op,a[full],b[full]) & std_bit_tail_mask(len)) != 0;
+}
+
+bool std_bitmap_intersects(const void *a, const void *b, size_t len) {
+    return std_bitmap_any(a,b,len,STD_BIT_OP_AND);
+}
+
+bool std_bitmap_is_subset(const void *a, const void *b, size_t len) {
+    return !std_bitmap_any(a,b,len,STD_BIT_OP_ANDNOT);
+}
+
+bool std_bitmap_equal(const void *a, const void *b, size_t len) {
+    return !std_bitmap_any(a,b,len,STD_BIT_OP_XOR);
+}
+
+size_t std_bitmap_popcount(const void *varray, size_t len) {
+    const uint8_t *array = (const uint8_t *)varray;
+    size_t full = len / 8;
+    size_t count = std_bit_impl.popcount(array,full);
+
+    if (len % 8 != 0) count += std_bit_popcount64(array[full] & std_bit_tail_mask(len));
+    return count;
+}
+
+size_t std_bitmap_get_set_bits(const void *varray, size_t len, size_t *from,
+        uint32_t *positions, size_t max) {
+    const uint8_t *array = (const uint8_t *)varray;
+    size_t bytes = bittobytelen(len);
+    size_t pos = *from;
+    size_t count = 0;
+
+    while (pos < len && count < max) {
+        size_t ix = pos / 8;
+        size_t n = (bytes - ix < sizeof(uint64_t)) ? bytes - ix : sizeof(uint64_t);
+        uint64_t w = 0;
+        size_t end;
+
+        memcpy(&w,array+ix,n);
+        w = le64toh(w) >> (pos % 8);
+        end = ix * 8 + n * 8;
+        if (end > len) {
+            /* drop the bits past len */
+            size_t keep = len - pos;
+            if (keep < 64) w &= (1ULL << keep) - 1;
+            end = len;
+        }
+
+        if (w == 0) {
+            /* end is on a byte boundary unless it is len - jump the empty bytes */
+            pos = (end < len) ? std_bit_impl.skip_fwd(array,end/8,bytes,0) * 8 : end;
+            continue;
+        }
+        while (w != 0) {
+            unsigned int b = __builtin_ctzll(w);
+            positions[count++] = (uint32_t)(pos + b);
+            w &= w - 1;
+            if (count == max) {
+                *from = pos + b + 1;
+                return count;
+            }
+        }
+        pos = end;
+    }
+    *from = (pos < len) ? pos : len;
+    return count;
+}
+
+void * std_bitmap_create_atomic_array(unsigned long len) {
+    return calloc(STD_BIT_ARRAY_ATOMIC_WORDS(len),sizeof(uint64_t));
+}
+
+int std_bit_atomic_find_and_set_first_clear(void *array, size_t len, size_t from,
+        int order) {
+    uint64_t *words = (uint64_t*)array;
+    size_t ix;
+
+    for (ix = from/64; ix*64 < len ; ++ix) {
+        uint64_t w = __atomic_load_n(&words[ix],__ATOMIC_RELAXED);
+        /* the clear bits that can be handed out, in bit array order */
+        uint64_t avail_mask = ~0ULL;
+        if (ix == from/64) avail_mask &= ~0ULL << (from%64);
+        if (len - ix*64 < 64) avail_mask &= (1ULL << (len - ix*64)) - 1;
 
-    for ( ; mx >=0 ; --mx) {
-        if (array[mx]!=0) {
-            return std_find_last_bit8(array[mx],0)-1 + (mx*8) ;
+        for ( ;; ) {
+            uint64_t avail = ~le64toh(w) & avail_mask;
+            uint64_t mask;
+            if (avail == 0) break;
+            mask = htole64(avail & -avail);
+            /* on failure w is reloaded and the search of this word starts over */
+            if (__atomic_compare_exchange_n(&words[ix],&w,w | mask,true,order,
+                    __ATOMIC_RELAXED)) {
+                return (int)(ix*64 + __builtin_ctzll(avail));
+            }
         }
     }
     return -1;
@@ -0,0 +1,910 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_cbitmap.c
+ */
+
+/*!
+ * \file   std_cbitmap.c
+ * \brief  Compressed bitmap of 32 bit values (Roaring style)
+ */
+
+#include "std_cbitmap.h"
+
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CB_ARRAY_MAX        4096        /* most values in an array container */
+#define CB_CHUNK_BITS       65536
+#define CB_BITSET_WORDS     (CB_CHUNK_BITS / 64)
+#define CB_BITSET_BYTES     (CB_BITSET_WORDS * sizeof(uint64_t))
+#define CB_MAGIC            0x314d4243  /* "CBM1" */
+
+enum {
+    CB_ARRAY,
+    CB_BITSET,
+    CB_RUN,
+};
+
+/* the values start .. start+len */
+typedef struct {
+    uint16_t start;
+    uint16_t len;
+} cb_run_t;
+
+typedef struct {
+    uint16_t key;       //! upper 16 bits of the values
+    uint8_t type;
+    uint32_t card;      //! number of values - never 0
+    uint32_t n;         //! entries used in array or runs
+    uint32_t cap;       //! entries allocated in array or runs
+    union {
+        uint16_t *array;
+        uint64_t *bits;
+        cb_run_t *runs;
+    } u;
+} cb_container_t;
+
+struct std_cbitmap_s {
+    cb_container_t *c;  //! sorted by key
+    size_t count;
+    size_t cap;
+};
+
+static inline size_t cb_popcount(uint64_t w) {
+    return __builtin_popcountll(w);
+}
+
+static void cb_container_free(cb_container_t *c) {
+    free(c->u.array);
+    c->u.array = NULL;
+}
+
+/* index of the first array entry >= v */
+static uint32_t cb_array_lower(const uint16_t *a, uint32_t n, uint16_t v) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (a[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* index of the last run starting at or before v or -1 */
+static int cb_run_find(const cb_run_t *r, uint32_t n, uint16_t v) {
+    int lo = 0, hi = (int)n - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (r[mid].start <= v) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+static inline uint32_t cb_run_end(const cb_run_t *r) {
+    return (uint32_t)r->start + r->len;
+}
+
+/* index of the first container with a key >= key */
+static size_t cb_find(const std_cbitmap_t *bm, uint16_t key) {
+    size_t lo = 0, hi = bm->count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (bm->c[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static cb_container_t * cb_get(const std_cbitmap_t *bm, uint16_t key) {
+    size_t ix = cb_find(bm, key);
+    if (ix < bm->count && bm->c[ix].key == key) return &bm->c[ix];
+    return NULL;
+}
+
+/* add an empty array container for key at position ix */
+static cb_container_t * cb_insert(std_cbitmap_t *bm, size_t ix, uint16_t key) {
+    if (bm->count == bm->cap) {
+        size_t cap = bm->cap ? bm->cap * 2 : 4;
+        cb_container_t *c = (cb_container_t *)realloc(bm->c, cap * sizeof(*c));
+        if (c == NULL) return NULL;
+        bm->c = c;
+        bm->cap = cap;
+    }
+    memmove(&bm->c[ix + 1], &bm->c[ix], (bm->count - ix) * sizeof(*bm->c));
+    bm->count++;
+    memset(&bm->c[ix], 0, sizeof(bm->c[ix]));
+    bm->c[ix].key = key;
+    bm->c[ix].type = CB_ARRAY;
+    return &bm->c[ix];
+}
+
+static void cb_remove(std_cbitmap_t *bm, size_t ix) {
+    cb_container_free(&bm->c[ix]);
+    memmove(&bm->c[ix], &bm->c[ix + 1], (bm->count - ix - 1) * sizeof(*bm->c));
+    bm->count--;
+}
+
+/* make room for need entries of size elem in an array or run container */
+static bool cb_reserve(cb_container_t *c, uint32_t need, size_t elem) {
+    uint32_t cap;
+    void *p;
+
+    if (need <= c->cap) return true;
+    cap = c->cap ? c->cap * 2 : 4;
+    if (cap < need) cap = need;
+    p = realloc(c->u.array, cap * elem);
+    if (p == NULL) return false;
+    c->u.array = (uint16_t *)p;
+    c->cap = cap;
+    return true;
+}
+
+static bool cb_container_contains(const cb_container_t *c, uint16_t v) {
+    switch (c->type) {
+    case CB_ARRAY: {
+        uint32_t ix = cb_array_lower(c->u.array, c->n, v);
+        return ix < c->n && c->u.array[ix] == v;
+    }
+    case CB_BITSET:
+        return (c->u.bits[v / 64] >> (v % 64)) & 1;
+    default: {
+        int ix = cb_run_find(c->u.runs, c->n, v);
+        return ix >= 0 && v <= cb_run_end(&c->u.runs[ix]);
+    }
+    }
+}
+
+static inline void cb_words_set_range(uint64_t *w, uint32_t first, uint32_t last) {
+    while (first <= last) {
+        uint32_t b = first % 64;
+        uint32_t n = last - first + 1;
+        if (n > 64 - b) n = 64 - b;
+        w[first / 64] |= ((n == 64) ? ~0ULL : ((1ULL << n) - 1)) << b;
+        first += n;
+    }
+}
+
+/* or the values of a container into words */
+static void cb_container_or_words(const cb_container_t *c, uint64_t *w) {
+    uint32_t ix;
+    switch (c->type) {
+    case CB_ARRAY:
+        for (ix = 0; ix < c->n; ++ix)
+            w[c->u.array[ix] / 64] |= 1ULL << (c->u.array[ix] % 64);
+        break;
+    case CB_BITSET:
+        for (ix = 0; ix < CB_BITSET_WORDS; ++ix) w[ix] |= c->u.bits[ix];
+        break;
+    default:
+        for (ix = 0; ix < c->n; ++ix)
+            cb_words_set_range(w, c->u.runs[ix].start, cb_run_end(&c->u.runs[ix]));
+        break;
+    }
+}
+
+/* the next position from pos with the bit equal to 'set' or CB_CHUNK_BITS */
+static uint32_t cb_words_next(const uint64_t *w, uint32_t pos, bool set) {
+    while (pos < CB_CHUNK_BITS) {
+        uint64_t v = set ? w[pos / 64] : ~w[pos / 64];
+        v &= ~0ULL << (pos % 64);
+        if (v != 0) return (pos & ~63u) + __builtin_ctzll(v);
+        pos = (pos & ~63u) + 64;
+    }
+    return CB_CHUNK_BITS;
+}
+
+static uint32_t cb_words_runs(const uint64_t *w) {
+    uint32_t runs = 0;
+    uint64_t carry = 0;
+    uint32_t ix;
+    /* a run starts at each set bit whose lower neighbour is clear */
+    for (ix = 0; ix < CB_BITSET_WORDS; ++ix) {
+        runs += cb_popcount(w[ix] & ~((w[ix] << 1) | carry));
+        carry = w[ix] >> 63;
+    }
+    return runs;
+}
+
+/*
+ * Replace the contents of c with the values in words (which c takes).  Picks
+ * array or bitset by cardinality, or runs if allow_runs and they are smaller.
+ * Returns false if out of memory - c is left as it was and words is freed
+ */
+static bool cb_container_from_words(cb_container_t *c, uint64_t *words, bool allow_runs) {
+    uint32_t card = 0, runs = 0, ix;
+    size_t best;
+    cb_container_t n;
+
+    for (ix = 0; ix < CB_BITSET_WORDS; ++ix) card += cb_popcount(words[ix]);
+
+    memset(&n, 0, sizeof(n));
+    n.key = c->key;
+    n.card = card;
+    n.type = (card <= CB_ARRAY_MAX) ? CB_ARRAY : CB_BITSET;
+    best = (card <= CB_ARRAY_MAX) ? card * sizeof(uint16_t) : CB_BITSET_BYTES;
+    if (allow_runs) {
+        runs = cb_words_runs(words);
+        if (runs * sizeof(cb_run_t) < best) n.type = CB_RUN;
+    }
+
+    if (n.type == CB_BITSET) {
+        n.u.bits = words;
+    } else if (n.type == CB_ARRAY) {
+        uint32_t pos = 0;
+        if (!cb_reserve(&n, card ? card : 1, sizeof(uint16_t))) {
+            free(words);
+            return false;
+        }
+        while ((pos = cb_words_next(words, pos, true)) < CB_CHUNK_BITS)
+            n.u.array[n.n++] = (uint16_t)pos++;
+        free(words);
+    } else {
+        uint32_t pos = 0, end;
+        if (!cb_reserve(&n, runs, sizeof(cb_run_t))) {
+            free(words);
+            return false;
+        }
+        while ((pos = cb_words_next(words, pos, true)) < CB_CHUNK_BITS) {
+            end = cb_words_next(words, pos, false);
+            n.u.runs[n.n].start = (uint16_t)pos;
+            n.u.runs[n.n].len = (uint16_t)(end - 1 - pos);
+            n.n++;
+            pos = end;
+        }
+        free(words);
+    }
+    cb_container_free(c);
+    *c = n;
+    return true;
+}
+
+static uint64_t * cb_container_to_words(const cb_container_t *c) {
+    uint64_t *w = (uint64_t *)calloc(CB_BITSET_WORDS, sizeof(uint64_t));
+    if (w != NULL) cb_container_or_words(c, w);
+    return w;
+}
+
+static bool cb_container_clone(cb_container_t *dst, const cb_container_t *src) {
+    size_t bytes;
+
+    *dst = *src;
+    switch (src->type) {
+    case CB_ARRAY: bytes = src->n * sizeof(uint16_t); break;
+    case CB_BITSET: bytes = CB_BITSET_BYTES; break;
+    default: bytes = src->n * sizeof(cb_run_t); break;
+    }
+    dst->cap = src->n;
+    dst->u.array = (uint16_t *)malloc(bytes ? bytes : 1);
+    if (dst->u.array == NULL) return false;
+    memcpy(dst->u.array, src->u.array, bytes);
+    return true;
+}
+
+static bool cb_array_add(cb_container_t *c, uint16_t v) {
+    uint32_t ix = cb_array_lower(c->u.array, c->n, v);
+
+    if (ix < c->n && c->u.array[ix] == v) return true;
+    if (c->n == CB_ARRAY_MAX) {
+        uint64_t *w = cb_container_to_words(c);
+        if (w == NULL) return false;
+        w[v / 64] |= 1ULL << (v % 64);
+        cb_container_free(c);
+        c->type = CB_BITSET;
+        c->u.bits = w;
+        c->n = c->cap = 0;
+        c->card++;
+        return true;
+    }
+    if (!cb_reserve(c, c->n + 1, sizeof(uint16_t))) return false;
+    memmove(&c->u.array[ix + 1], &c->u.array[ix], (c->n - ix) * sizeof(uint16_t));
+    c->u.array[ix] = v;
+    c->n++;
+    c->card++;
+    return true;
+}
+
+static bool cb_run_add(cb_container_t *c, uint16_t v) {
+    int ix = cb_run_find(c->u.runs, c->n, v);
+    cb_run_t *r = c->u.runs;
+    uint32_t next = (uint32_t)(ix + 1);
+
+    if (ix >= 0 && v <= cb_run_end(&r[ix])) return true;
+
+    if (ix >= 0 && v == cb_run_end(&r[ix]) + 1) {
+        r[ix].len++;
+        /* join up with the next run */
+        if (next < c->n && r[next].start == (uint32_t)v + 1) {
+            r[ix].len += r[next].len + 1;
+            memmove(&r[next], &r[next + 1], (c->n - next - 1) * sizeof(cb_run_t));
+            c->n--;
+        }
+    } else if (next < c->n && r[next].start == (uint32_t)v + 1) {
+        r[next].start--;
+        r[next].len++;
+    } else {
+        if (!cb_reserve(c, c->n + 1, sizeof(cb_run_t))) return false;
+        r = c->u.runs;
+        memmove(&r[next + 1], &r[next], (c->n - next) * sizeof(cb_run_t));
+        r[next].start = v;
+        r[next].len = 0;
+        c->n++;
+    }
+    c->card++;
+    return true;
+}
+
+t_std_error std_cbitmap_add(std_cbitmap_t *bm, uint32_t value) {
+    uint16_t key = value >> 16, v = value & 0xffff;
+    size_t ix = cb_find(bm, key);
+    cb_container_t *c;
+    bool ok = true;
+
+    if (ix < bm->count && bm->c[ix].key == key) {
+        c = &bm->c[ix];
+    } else {
+        c = cb_insert(bm, ix, key);
+        if (c == NULL) return STD_ERR(COM, NOMEM, 0);
+    }
+
+    switch (c->type) {
+    case CB_ARRAY:
+        ok = cb_array_add(c, v);
+        break;
+    case CB_BITSET:
+        if (!((c->u.bits[v / 64] >> (v % 64)) & 1)) {
+            c->u.bits[v / 64] |= 1ULL << (v % 64);
+            c->card++;
+        }
+        break;
+    default:
+        ok = cb_run_add(c, v);
+        break;
+    }
+
+    if (c->card == 0) cb_remove(bm, ix);
+    return ok ? STD_ERR_OK : STD_ERR(COM, NOMEM, 0);
+}
+
+t_std_error std_cbitmap_add_range(std_cbitmap_t *bm, uint32_t first, uint32_t last) {
+    uint32_t key;
+
+    if (last < first) return STD_ERR(COM, PARAM, 0);
+
+    for (key = first >> 16; key <= (last >> 16); ++key) {
+        uint32_t lo = (key == (first >> 16)) ? (first & 0xffff) : 0;
+        uint32_t hi = (key == (last >> 16)) ? (last & 0xffff) : 0xffff;
+        size_t ix = cb_find(bm, key);
+        cb_container_t *c;
+        uint64_t *w;
+
+        if (ix < bm->count && bm->c[ix].key == key) {
+            c = &bm->c[ix];
+        } else {
+            /* new chunk - a single run */
+            c = cb_insert(bm, ix, key);
+            if (c == NULL || !cb_reserve(c, 1, sizeof(cb_run_t))) {
+                if (c != NULL) cb_remove(bm, ix);
+                return STD_ERR(COM, NOMEM, 0);
+            }
+            c->type = CB_RUN;
+            c->u.runs[0].start = lo;
+            c->u.runs[0].len = hi - lo;
+            c->n = 1;
+            c->card = hi - lo + 1;
+            continue;
+        }
+
+        w = cb_container_to_words(c);
+        if (w == NULL) return STD_ERR(COM, NOMEM, 0);
+        cb_words_set_range(w, lo, hi);
+        if (!cb_container_from_words(c, w, true)) return STD_ERR(COM, NOMEM, 0);
+    }
+    return STD_ERR_OK;
+}
+
+t_std_error std_cbitmap_remove(std_cbitmap_t *bm, uint32_t value) {
+    uint16_t key = value >> 16, v = value & 0xffff;
+    size_t cix = cb_find(bm, key);
+    cb_container_t *c;
+
+    if (cix >= bm->count || bm->c[cix].key != key) return STD_ERR_OK;
+    c = &bm->c[cix];
+
+    switch (c->type) {
+    case CB_ARRAY: {
+        uint32_t ix = cb_array_lower(c->u.array, c->n, v);
+        if (ix == c->n || c->u.array[ix] != v) return STD_ERR_OK;
+        memmove(&c->u.array[ix], &c->u.array[ix + 1], (c->n - ix - 1) * sizeof(uint16_t));
+        c->n--;
+        c->card--;
+        break;
+    }
+    case CB_BITSET: {
+        uint64_t *w = c->u.bits;
+        if (!((w[v / 64] >> (v % 64)) & 1)) return STD_ERR_OK;
+        w[v / 64] &= ~(1ULL << (v % 64));
+        c->card--;
+        if (c->card <= CB_ARRAY_MAX && c->card > 0) {
+            /* if the copy fails it just stays a bitset */
+            uint64_t *copy = (uint64_t *)malloc(CB_BITSET_BYTES);
+            if (copy != NULL) {
+                memcpy(copy, w, CB_BITSET_BYTES);
+                cb_container_from_words(c, copy, false);
+            }
+        }
+        break;
+    }
+    default: {
+        int ix = cb_run_find(c->u.runs, c->n, v);
+        cb_run_t *r;
+        if (ix < 0 || v > cb_run_end(&c->u.runs[ix])) return STD_ERR_OK;
+        r = &c->u.runs[ix];
+        if (r->len == 0) {
+            memmove(r, r + 1, (c->n - ix - 1) * sizeof(cb_run_t));
+            c->n--;
+        } else if (v == r->start) {
+            r->start++;
+            r->len--;
+        } else if (v == cb_run_end(r)) {
+            r->len--;
+        } else {
+            uint32_t end = cb_run_end(r);
+            if (!cb_reserve(c, c->n + 1, sizeof(cb_run_t))) return STD_ERR(COM, NOMEM, 0);
+            r = &c->u.runs[ix];
+            memmove(r + 2, r + 1, (c->n - ix - 1) * sizeof(cb_run_t));
+            r->len = v - 1 - r->start;
+            r[1].start = v + 1;
+            r[1].len = end - (v + 1);
+            c->n++;
+        }
+        c->card--;
+        break;
+    }
+    }
+
+    if (c->card == 0) cb_remove(bm, cix);
+    return STD_ERR_OK;
+}
+
+bool std_cbitmap_contains(const std_cbitmap_t *bm, uint32_t value) {
+    const cb_container_t *c = cb_get(bm, value >> 16);
+    return c != NULL && cb_container_contains(c, value & 0xffff);
+}
+
+uint64_t std_cbitmap_cardinality(const std_cbitmap_t *bm) {
+    uint64_t card = 0;
+    size_t ix;
+    for (ix = 0; ix < bm->count; ++ix) card += bm->c[ix].card;
+    return card;
+}
+
+size_t std_cbitmap_memory_usage(const std_cbitmap_t *bm) {
+    size_t bytes = sizeof(*bm) + bm->cap * sizeof(cb_container_t);
+    size_t ix;
+    for (ix = 0; ix < bm->count; ++ix) {
+        const cb_container_t *c = &bm->c[ix];
+        switch (c->type) {
+        case CB_ARRAY: bytes += c->cap * sizeof(uint16_t); break;
+        case CB_BITSET: bytes += CB_BITSET_BYTES; break;
+        default: bytes += c->cap * sizeof(cb_run_t); break;
+        }
+    }
+    return bytes;
+}
+
+void std_cbitmap_optimize(std_cbitmap_t *bm) {
+    size_t ix;
+    /* a container that can't be converted for lack of memory stays as it is */
+    for (ix = 0; ix < bm->count; ++ix) {
+        uint64_t *w = cb_container_to_words(&bm->c[ix]);
+        if (w != NULL) cb_container_from_words(&bm->c[ix], w, true);
+    }
+}
+
+std_cbitmap_t * std_cbitmap_create(void) {
+    return (std_cbitmap_t *)calloc(1, sizeof(std_cbitmap_t));
+}
+
+void std_cbitmap_free(std_cbitmap_t *bm) {
+    size_t ix;
+    if (bm == NULL) return;
+    for (ix = 0; ix < bm->count; ++ix) cb_container_free(&bm->c[ix]);
+    free(bm->c);
+    free(bm);
+}
+
+/* add a finished container to the end of a bitmap being built */
+static bool cb_append(std_cbitmap_t *bm, cb_container_t *c) {
+    cb_container_t *slot;
+
+    if (c->card == 0) {
+        cb_container_free(c);
+        return true;
+    }
+    slot = cb_insert(bm, bm->count, c->key);
+    if (slot == NULL) {
+        cb_container_free(c);
+        return false;
+    }
+    *slot = *c;
+    return true;
+}
+
+static bool cb_and_container(cb_container_t *out, const cb_container_t *a,
+        const cb_container_t *b) {
+    uint64_t *wa, *wb;
+    uint32_t ix;
+
+    memset(out, 0, sizeof(*out));
+    out->key = a->key;
+    out->type = CB_ARRAY;
+
+    if (b->type == CB_ARRAY && a->type != CB_ARRAY) {
+        const cb_container_t *t = a;
+        a = b;
+        b = t;
+    }
+    if (a->type == CB_ARRAY) {
+        /* the result is never bigger than the array */
+        if (!cb_reserve(out, a->n, sizeof(uint16_t))) return false;
+        if (b->type == CB_ARRAY) {
+            uint32_t i = 0, j = 0;
+            while (i < a->n && j < b->n) {
+                if (a->u.array[i] < b->u.array[j]) ++i;
+                else if (a->u.array[i] > b->u.array[j]) ++j;
+                else {
+                    out->u.array[out->n++] = a->u.array[i];
+                    ++i;
+                    ++j;
+                }
+            }
+        } else {
+            for (ix = 0; ix < a->n; ++ix) {
+                if (cb_container_contains(b, a->u.array[ix]))
+                    out->u.array[out->n++] = a->u.array[ix];
+            }
+        }
+        out->card = out->n;
+        return true;
+    }
+
+    wa = cb_container_to_words(a);
+    wb = (b->type == CB_BITSET) ? b->u.bits : cb_container_to_words(b);
+    if (wa == NULL || wb == NULL) {
+        free(wa);
+        if (wb != b->u.bits) free(wb);
+        return false;
+    }
+    for (ix = 0; ix < CB_BITSET_WORDS; ++ix) wa[ix] &= wb[ix];
+    if (wb != b->u.bits) free(wb);
+    return cb_container_from_words(out, wa, a->type == CB_RUN && b->type == CB_RUN);
+}
+
+static bool cb_or_container(cb_container_t *out, const cb_container_t *a,
+        const cb_container_t *b) {
+    uint64_t *w;
+
+    memset(out, 0, sizeof(*out));
+    out->key = a->key;
+    out->type = CB_ARRAY;
+
+    if (a->type == CB_ARRAY && b->type == CB_ARRAY && a->n + b->n <= CB_ARRAY_MAX) {
+        uint32_t i = 0, j = 0;
+        if (!cb_reserve(out, a->n + b->n, sizeof(uint16_t))) return false;
+        while (i < a->n || j < b->n) {
+            uint16_t v;
+            if (j == b->n || (i < a->n && a->u.array[i] < b->u.array[j])) v = a->u.array[i++];
+            else if (i == a->n || b->u.array[j] < a->u.array[i]) v = b->u.array[j++];
+            else {
+                v = a->u.array[i++];
+                ++j;
+            }
+            out->u.array[out->n++] = v;
+        }
+        out->card = out->n;
+        return true;
+    }
+
+    w = cb_container_to_words(a);
+    if (w == NULL) return false;
+    cb_container_or_words(b, w);
+    return cb_container_from_words(out, w, a->type == CB_RUN && b->type == CB_RUN);
+}
+
+std_cbitmap_t * std_cbitmap_and(const std_cbitmap_t *a, const std_cbitmap_t *b) {
+    std_cbitmap_t *r = std_cbitmap_create();
+    size_t i = 0, j = 0;
+
+    if (r == NULL) return NULL;
+    while (i < a->count && j < b->count) {
+        cb_container_t c;
+        if (a->c[i].key < b->c[j].key) {
+            ++i;
+            continue;
+        }
+        if (a->c[i].key > b->c[j].key) {
+            ++j;
+            continue;
+        }
+        if (!cb_and_container(&c, &a->c[i], &b->c[j]) || !cb_append(r, &c)) {
+            std_cbitmap_free(r);
+            return NULL;
+        }
+        ++i;
+        ++j;
+    }
+    return r;
+}
+
+std_cbitmap_t * std_cbitmap_or(const std_cbitmap_t *a, const std_cbitmap_t *b) {
+    std_cbitmap_t *r = std_cbitmap_create();
+    size_t i = 0, j = 0;
+
+    if (r == NULL) return NULL;
+    while (i < a->count || j < b->count) {
+        cb_container_t c;
+        bool ok;
+        if (j == b->count || (i < a->count && a->c[i].key < b->c[j].key)) {
+            ok = cb_container_clone(&c, &a->c[i++]);
+        } else if (i == a->count || b->c[j].key < a->c[i].key) {
+            ok = cb_container_clone(&c, &b->c[j++]);
+        } else {
+            ok = cb_or_container(&c, &a->c[i++], &b->c[j++]);
+        }
+        if (!ok || !cb_append(r, &c)) {
+            std_cbitmap_free(r);
+            return NULL;
+        }
+    }
+    return r;
+}
+
+/* copy the values of c from low on - *low is set to where to carry on */
+static size_t cb_container_emit(const cb_container_t *c, uint32_t *low, uint32_t *out,
+        size_t max) {
+    uint32_t base = (uint32_t)c->key << 16;
+    uint32_t pos = *low;
+    size_t count = 0;
+
+    switch (c->type) {
+    case CB_ARRAY: {
+        uint32_t ix = cb_array_lower(c->u.array, c->n, (uint16_t)pos);
+        for ( ; ix < c->n && count < max; ++ix) out[count++] = base | c->u.array[ix];
+        pos = (ix < c->n) ? c->u.array[ix] : CB_CHUNK_BITS;
+        break;
+    }
+    case CB_BITSET:
+        while (count < max && (pos = cb_words_next(c->u.bits, pos, true)) < CB_CHUNK_BITS)
+            out[count++] = base | pos++;
+        break;
+    default: {
+        int ix = cb_run_find(c->u.runs, c->n, (uint16_t)pos);
+        uint32_t r = (ix < 0) ? 0 : (uint32_t)ix;
+        pos = CB_CHUNK_BITS;
+        for ( ; r < c->n; ++r) {
+            uint32_t v = c->u.runs[r].start;
+            uint32_t end = cb_run_end(&c->u.runs[r]);
+            if (v < *low) v = *low;
+            for ( ; v <= end && count < max; ++v) out[count++] = base | v;
+            if (v <= end) {
+                pos = v;
+                break;
+            }
+        }
+        break;
+    }
+    }
+    *low = pos;
+    return count;
+}
+
+size_t std_cbitmap_get_values(const std_cbitmap_t *bm, uint64_t *from, uint32_t *values,
+        size_t max) {
+    size_t count = 0;
+
+    while (count < max && *from <= UINT32_MAX) {
+        size_t ix = cb_find(bm, (uint16_t)(*from >> 16));
+        uint32_t low;
+
+        if (ix == bm->count) {
+            *from = (uint64_t)UINT32_MAX + 1;
+            break;
+        }
+        if (bm->c[ix].key != (*from >> 16)) *from = (uint64_t)bm->c[ix].key << 16;
+
+        low = *from & 0xffff;
+        count += cb_container_emit(&bm->c[ix], &low, values + count, max - count);
+        *from = ((uint64_t)bm->c[ix].key << 16) + low;
+    }
+    return count;
+}
+
+/*
+ * Serialized form - all little endian
+ *  uint32 magic, uint32 number of containers
+ *  per container: uint16 key, uint8 type, uint8 0, uint32 card, uint32 n, data
+ *  where data is n uint16 values, 1024 uint64 words or n (uint16 start, uint16 len)
+ */
+#define CB_HDR_BYTES        8
+#define CB_CONTAINER_BYTES  12
+
+static size_t cb_data_bytes(uint8_t type, uint32_t n) {
+    switch (type) {
+    case CB_ARRAY: return n * sizeof(uint16_t);
+    case CB_BITSET: return CB_BITSET_BYTES;
+    default: return n * sizeof(cb_run_t);
+    }
+}
+
+static inline uint8_t * cb_put16(uint8_t *p, uint16_t v) {
+    v = htole16(v);
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static inline uint8_t * cb_put32(uint8_t *p, uint32_t v) {
+    v = htole32(v);
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static inline uint16_t cb_get16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return le16toh(v);
+}
+
+static inline uint32_t cb_get32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return le32toh(v);
+}
+
+size_t std_cbitmap_serialized_size(const std_cbitmap_t *bm) {
+    size_t bytes = CB_HDR_BYTES;
+    size_t ix;
+    for (ix = 0; ix < bm->count; ++ix)
+        bytes += CB_CONTAINER_BYTES + cb_data_bytes(bm->c[ix].type, bm->c[ix].n);
+    return bytes;
+}
+
+size_t std_cbitmap_serialize(const std_cbitmap_t *bm, void *buf) {
+    uint8_t *p = (uint8_t *)buf;
+    size_t ix;
+    uint32_t j;
+
+    p = cb_put32(p, CB_MAGIC);
+    p = cb_put32(p, (uint32_t)bm->count);
+    for (ix = 0; ix < bm->count; ++ix) {
+        const cb_container_t *c = &bm->c[ix];
+        p = cb_put16(p, c->key);
+        *p++ = c->type;
+        *p++ = 0;
+        p = cb_put32(p, c->card);
+        p = cb_put32(p, c->n);
+        switch (c->type) {
+        case CB_ARRAY:
+            for (j = 0; j < c->n; ++j) p = cb_put16(p, c->u.array[j]);
+            break;
+        case CB_BITSET:
+            for (j = 0; j < CB_BITSET_WORDS; ++j) {
+                uint64_t w = htole64(c->u.bits[j]);
+                memcpy(p, &w, sizeof(w));
+                p += sizeof(w);
+            }
+            break;
+        default:
+            for (j = 0; j < c->n; ++j) {
+                p = cb_put16(p, c->u.runs[j].start);
+                p = cb_put16(p, c->u.runs[j].len);
+            }
+            break;
+        }
+    }
+    return p - (uint8_t *)buf;
+}
+
+/* read one container's data and check that it is consistent */
+static bool cb_load_container(cb_container_t *c, const uint8_t *p) {
+    uint32_t j, card = 0;
+
+    switch (c->type) {
+    case CB_ARRAY:
+        if (c->n == 0 || c->n > CB_ARRAY_MAX || c->card != c->n) return false;
+        if (!cb_reserve(c, c->n, sizeof(uint16_t))) return false;
+        for (j = 0; j < c->n; ++j) {
+            c->u.array[j] = cb_get16(p + j * 2);
+            if (j > 0 && c->u.array[j] <= c->u.array[j - 1]) return false;
+        }
+        return true;
+    case CB_BITSET:
+        if (c->n != 0) return false;
+        c->u.bits = (uint64_t *)malloc(CB_BITSET_BYTES);
+        if (c->u.bits == NULL) return false;
+        for (j = 0; j < CB_BITSET_WORDS; ++j) {
+            uint64_t w;
+            memcpy(&w, p + j * 8, sizeof(w));
+            c->u.bits[j] = le64toh(w);
+            card += cb_popcount(c->u.bits[j]);
+        }
+        return card == c->card && card > CB_ARRAY_MAX;
+    case CB_RUN:
+        if (c->n == 0 || c->n > CB_CHUNK_BITS / 2) return false;
+        if (!cb_reserve(c, c->n, sizeof(cb_run_t))) return false;
+        for (j = 0; j < c->n; ++j) {
+            c->u.runs[j].start = cb_get16(p + j * 4);
+            c->u.runs[j].len = cb_get16(p + j * 4 + 2);
+            if (cb_run_end(&c->u.runs[j]) >= CB_CHUNK_BITS) return false;
+            if (j > 0 && c->u.runs[j].start <= cb_run_end(&c->u.runs[j - 1]) + 1) return false;
+            card += c->u.runs[j].len + 1;
+        }
+        return card == c->card;
+    default:
+        return false;
+    }
+}
+
+std_cbitmap_t * std_cbitmap_deserialize(const void *buf, size_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    const uint8_t *end = p + len;
+    std_cbitmap_t *bm;
+    uint32_t count, ix;
+
+    if (len < CB_HDR_BYTES || cb_get32(p) != CB_MAGIC) return NULL;
+    count = cb_get32(p + 4);
+    p += CB_HDR_BYTES;
+    if (count > CB_CHUNK_BITS) return NULL;
+
+    bm = std_cbitmap_create();
+    if (bm == NULL) return NULL;
+
+    for (ix = 0; ix < count; ++ix) {
+        cb_container_t c;
+        size_t data;
+
+        if ((size_t)(end - p) < CB_CONTAINER_BYTES) break;
+        memset(&c, 0, sizeof(c));
+        c.key = cb_get16(p);
+        c.type = p[2];
+        c.card = cb_get32(p + 4);
+        c.n = cb_get32(p + 8);
+        p += CB_CONTAINER_BYTES;
+
+        if (c.n > CB_CHUNK_BITS) break;
+        data = cb_data_bytes(c.type, c.n);
+        if ((size_t)(end - p) < data) break;
+        if (bm->count > 0 && c.key <= bm->c[bm->count - 1].key) break;
+        if (!cb_load_container(&c, p) || !cb_append(bm, &c)) {
+            cb_container_free(&c);
+            break;
+        }
+        p += data;
+    }
+
+    if (ix != count) {
+        std_cbitmap_free(bm);
+        return NULL;
+    }
+    return bm;
+}
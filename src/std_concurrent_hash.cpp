@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * std_concurrent_hash.cpp
+ */
+
+#include "std_concurrent_hash.h"
+#include "std_hash.h"
+#include "std_rw_lock.h"
+#include "std_mutex_lock.h"
+#include "event_log.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+#include <vector>
+
+namespace {
+
+enum { DEFAULT_SHARDS = 64, CACHE_LINE = 64, RECLAIM_THRESHOLD = 64 };
+
+/**
+ * One lock stripe.  Padded so that the locks of neighbouring shards are not on
+ * the same cache line
+ */
+struct chash_shard_t {
+    std_rw_lock_t lock;
+    std_hash_handle table;
+    char pad[CACHE_LINE];
+};
+
+/**
+ * Per thread epoch record.  epoch is 0 while the thread is not in a read section.
+ * Records are never freed while the map exists - a thread exiting just releases
+ * its record for reuse
+ */
+struct chash_epoch_rec_t {
+    std::atomic<uint64_t> epoch;
+    std::atomic<bool> in_use;
+    size_t depth;
+    chash_epoch_rec_t *next;
+    char pad[CACHE_LINE];
+};
+
+struct chash_retired_t {
+    uint64_t epoch;
+    void *data;
+    std_chash_free_fn free_fn;
+};
+
+}
+
+struct std_chash_t {
+    int keyoffset;
+    int keylength;
+    size_t shard_mask;
+    std::vector<chash_shard_t> shards;
+
+    std::atomic<uint64_t> global_epoch;
+    std::atomic<chash_epoch_rec_t *> recs;
+    pthread_key_t rec_key;
+
+    std_mutex_type_t retired_lock;
+    std::vector<chash_retired_t> retired;
+
+    chash_shard_t & shard_for(const void *data) {
+        uint64_t hash = std_hash_bytes(((const char*)data)+keyoffset,keylength);
+        /* the top bits pick the shard - the std_hash table uses the low bits */
+        return shards[(hash >> 32) & shard_mask];
+    }
+
+    chash_epoch_rec_t *get_rec();
+    void try_reclaim();
+};
+
+static void chash_release_rec(void *param) {
+    chash_epoch_rec_t *rec = (chash_epoch_rec_t*)param;
+    rec->depth = 0;
+    rec->epoch.store(0);
+    rec->in_use.store(false);
+}
+
+chash_epoch_rec_t *std_chash_t::get_rec() {
+    chash_epoch_rec_t *rec = (chash_epoch_rec_t*)pthread_getspecific(rec_key);
+    if (rec!=NULL) return rec;
+
+    /* reuse the record of a thread that has exited if there is one */
+    for (rec = recs.load(); rec!=NULL ; rec = rec->next) {
+        bool expected = false;
+        if (rec->in_use.compare_exchange_strong(expected,true)) break;
+    }
+    if (rec==NULL) {
+        rec = new chash_epoch_rec_t;
+        rec->epoch.store(0);
+        rec->in_use.store(true);
+        rec->depth = 0;
+        rec->next = recs.load();
+        while (!recs.compare_exchange_weak(rec->next,rec)) ;
+    }
+    pthread_setspecific(rec_key,rec);
+    return rec;
+}
+
+void std_chash_t::try_reclaim() {
+    std::vector<chash_retired_t> ready;
+    {
+        std_mutex_simple_lock_guard g(&retired_lock);
+
+        /* the epoch can only move forward once every active reader has seen it */
+        uint64_t e = global_epoch.load();
+        bool advance = true;
+        for (chash_epoch_rec_t *rec = recs.load(); rec!=NULL ; rec = rec->next) {
+            uint64_t local = rec->epoch.load();
+            if (local!=0 && local!=e) {
+                advance = false;
+                break;
+            }
+        }
+        if (advance) global_epoch.compare_exchange_strong(e,e+1);
+
+        /* anything retired two epochs ago can no longer be seen by any reader */
+        uint64_t safe = global_epoch.load();
+        size_t ix = 0;
+        while (ix < retired.size()) {
+            if (retired[ix].epoch + 2 <= safe) {
+                ready.push_back(retired[ix]);
+                retired[ix] = retired.back();
+                retired.pop_back();
+                continue;
+            }
+            ++ix;
+        }
+    }
+    for (auto &it : ready) {
+        it.free_fn(it.data);
+    }
+}
+
+extern "C" {
+
+t_std_error std_chash_create(std_chash_handle_t *handle, const char *name,
+        int keyoffset, int keylength, size_t shards) {
+
+    if (keylength <= 0 || keyoffset < 0) return STD_ERR(COM,PARAM,0);
+
+    size_t count = 1;
+    if (shards==0) shards = DEFAULT_SHARDS;
+    while (count < shards) count <<= 1;
+
+    std_chash_t *p = new (std::nothrow) std_chash_t;
+    if (p==NULL) return STD_ERR(COM,NOMEM,0);
+
+    p->keyoffset = keyoffset;
+    p->keylength = keylength;
+    p->shard_mask = count - 1;
+    p->global_epoch.store(1);
+    p->recs.store(NULL);
+
+    try {
+        p->shards.resize(count);
+    } catch (...) {
+        delete p;
+        return STD_ERR(COM,NOMEM,0);
+    }
+
+    size_t ix = 0;
+    bool valid = true;
+    for ( ; ix < count ; ++ix ) {
+        p->shards[ix].table = std_hash_create_simple(name,keyoffset,keylength);
+        if (p->shards[ix].table==NULL) {
+            valid = false;
+            break;
+        }
+        std_rw_lock_create_default(&p->shards[ix].lock);
+    }
+    if (valid && pthread_key_create(&p->rec_key,chash_release_rec)!=0) {
+        valid = false;
+    }
+    if (!valid) {
+        EV_LOG(ERR,COM,0,"COM-CHASH","Failed to create concurrent hash %s",name);
+        while (ix-- > 0) {
+            std_hash_destroy(p->shards[ix].table);
+            std_rw_lock_delete(&p->shards[ix].lock);
+        }
+        delete p;
+        return STD_ERR(COM,NOMEM,0);
+    }
+
+    std_mutex_lock_init_non_recursive(&p->retired_lock);
+    *handle = p;
+    return STD_ERR_OK;
+}
+
+t_std_error std_chash_destroy(std_chash_handle_t handle) {
+    std_chash_t *p = (std_chash_t*)handle;
+
+    /* no more thread exit callbacks once the key is gone */
+    pthread_key_delete(p->rec_key);
+
+    for (auto &it : p->retired) {
+        it.free_fn(it.data);
+    }
+    for (auto &it : p->shards) {
+        std_hash_destroy(it.table);
+        std_rw_lock_delete(&it.lock);
+    }
+    chash_epoch_rec_t *rec = p->recs.load();
+    while (rec!=NULL) {
+        chash_epoch_rec_t *next = rec->next;
+        delete rec;
+        rec = next;
+    }
+    std_mutex_destroy(&p->retired_lock);
+    delete p;
+    return STD_ERR_OK;
+}
+
+t_std_error std_chash_insert(std_chash_handle_t handle, void *data) {
+    std_chash_t *p = (std_chash_t*)handle;
+    chash_shard_t &s = p->shard_for(data);
+    std_rw_lock_write_guard g(&s.lock);
+    return std_hash_insert(s.table,data);
+}
+
+void * std_chash_find(std_chash_handle_t handle, const void *data) {
+    std_chash_t *p = (std_chash_t*)handle;
+    chash_shard_t &s = p->shard_for(data);
+    std_rw_lock_read_guard g(&s.lock);
+    return std_hash_getexact(s.table,data);
+}
+
+void * std_chash_remove(std_chash_handle_t handle, const void *data) {
+    std_chash_t *p = (std_chash_t*)handle;
+    chash_shard_t &s = p->shard_for(data);
+    std_rw_lock_write_guard g(&s.lock);
+    return std_hash_remove(s.table,data);
+}
+
+size_t std_chash_count(std_chash_handle_t handle) {
+    std_chash_t *p = (std_chash_t*)handle;
+    size_t count = 0;
+    for (auto &it : p->shards) {
+        std_rw_lock_read_guard g(&it.lock);
+        count += std_hash_count(it.table);
+    }
+    return count;
+}
+
+void std_chash_read_enter(std_chash_handle_t handle) {
+    std_chash_t *p = (std_chash_t*)handle;
+    chash_epoch_rec_t *rec = p->get_rec();
+    if (rec->depth++ > 0) return;
+
+    /*
+     * Publish the epoch and make sure it is still current - otherwise the
+     * epoch could have moved on twice between the load and the store and
+     * nodes retired in it could already be freed
+     */
+    uint64_t e;
+    do {
+        e = p->global_epoch.load();
+        rec->epoch.store(e);
+    } while (p->global_epoch.load()!=e);
+}
+
+void std_chash_read_exit(std_chash_handle_t handle) {
+    std_chash_t *p = (std_chash_t*)handle;
+    chash_epoch_rec_t *rec = p->get_rec();
+    if (rec->depth==0 || --rec->depth > 0) return;
+    rec->epoch.store(0,std::memory_order_release);
+}
+
+t_std_error std_chash_retire(std_chash_handle_t handle, void *data, std_chash_free_fn free_fn) {
+    std_chash_t *p = (std_chash_t*)handle;
+    size_t pending = 0;
+    {
+        std_mutex_simple_lock_guard g(&p->retired_lock);
+        try {
+            p->retired.push_back({p->global_epoch.load(),data,free_fn});
+        } catch (...) {
+            return STD_ERR(COM,NOMEM,0);
+        }
+        pending = p->retired.size();
+    }
+    if (pending >= RECLAIM_THRESHOLD) p->try_reclaim();
+    return STD_ERR_OK;
+}
+
+void std_chash_reclaim(std_chash_handle_t handle) {
+    std_chash_t *p = (std_chash_t*)handle;
+    p->try_reclaim();
+}
+
+}
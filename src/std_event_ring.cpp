@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_event_ring.cpp
+ */
+
+#include "private/std_event_ring.h"
+#include "event_log.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define STD_EVENT_RING_MAGIC    (0x52564553)    /* "SEVR" */
+#define STD_EVENT_RING_VERSION  (1)
+#define STD_EVENT_RING_PAD      (0xffffffffU)   /* skip to the start of the ring */
+#define STD_EVENT_RING_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+/* time to sleep between checks when a producer is waiting for space (us) */
+#define STD_EVENT_RING_FULL_WAIT (100)
+
+/* producer and consumer positions are on their own cache lines */
+struct std_event_ring_hdr_t {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    uint8_t pad0[48];
+    uint64_t head;          /* written by the producer */
+    uint8_t pad1[56];
+    uint64_t tail;          /* written by the consumer */
+    uint32_t waiting;       /* the consumer is about to sleep on the doorbell */
+    uint8_t pad2[52];
+};
+
+static size_t ring_round_size(size_t size) {
+    size_t sz = STD_EVENT_RING_MIN_SIZE;
+    while (sz < size && sz < STD_EVENT_RING_MAX_SIZE) sz <<= 1;
+    return sz;
+}
+
+static t_std_error ring_map(std_event_ring_t *r, size_t map_len, bool create) {
+    void *p = mmap(NULL,map_len,PROT_READ|PROT_WRITE,MAP_SHARED,r->mem_fd,0);
+    if (p==MAP_FAILED) return STD_ERR(COM,NOMEM,errno);
+
+    r->map_len = map_len;
+    r->hdr = (std_event_ring_hdr_t*)p;
+    r->data = ((uint8_t*)p) + sizeof(std_event_ring_hdr_t);
+    if (create) {
+        r->hdr->magic = STD_EVENT_RING_MAGIC;
+        r->hdr->version = STD_EVENT_RING_VERSION;
+        r->hdr->size = r->size;
+    }
+    return STD_ERR_OK;
+}
+
+static std_event_ring_t *ring_alloc(void) {
+    std_event_ring_t *r = (std_event_ring_t*)calloc(1,sizeof(*r));
+    if (r==NULL) return NULL;
+    if (std_mutex_lock_init_non_recursive(&r->lock)!=STD_ERR_OK) {
+        free(r);
+        return NULL;
+    }
+    r->mem_fd = -1;
+    r->bell_fd = -1;
+    return r;
+}
+
+t_std_error std_event_ring_create(size_t size, std_event_ring_t **ring) {
+    std_event_ring_t *r = ring_alloc();
+    if (r==NULL) return STD_ERR(COM,NOMEM,0);
+
+    t_std_error rc = STD_ERR(COM,FAIL,0);
+    do {
+        r->size = ring_round_size(size);
+        r->mem_fd = syscall(SYS_memfd_create,"std_event_ring",MFD_CLOEXEC);
+        if (r->mem_fd<0) {
+            rc = STD_ERR(COM,FAIL,errno);
+            break;
+        }
+        size_t map_len = sizeof(std_event_ring_hdr_t) + r->size;
+        if (ftruncate(r->mem_fd,map_len)!=0) {
+            rc = STD_ERR(COM,NOMEM,errno);
+            break;
+        }
+        r->bell_fd = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+        if (r->bell_fd<0) {
+            rc = STD_ERR(COM,FAIL,errno);
+            break;
+        }
+        if ((rc=ring_map(r,map_len,true))!=STD_ERR_OK) break;
+        *ring = r;
+        return STD_ERR_OK;
+    } while (0);
+
+    EV_LOG(ERR,COM,0,"COM-EVENT-RING","Failed to create the event ring");
+    std_event_ring_free(r);
+    return rc;
+}
+
+t_std_error std_event_ring_attach(int mem_fd, int bell_fd, std_event_ring_t **ring) {
+    std_event_ring_t *r = ring_alloc();
+    if (r==NULL) {
+        close(mem_fd);
+        close(bell_fd);
+        return STD_ERR(COM,NOMEM,0);
+    }
+    r->mem_fd = mem_fd;
+    r->bell_fd = bell_fd;
+
+    t_std_error rc = STD_ERR(COM,PARAM,0);
+    do {
+        struct stat st;
+        if (fstat(mem_fd,&st)!=0) break;
+        if ((size_t)st.st_size < sizeof(std_event_ring_hdr_t)+STD_EVENT_RING_MIN_SIZE) break;
+        if ((size_t)st.st_size > sizeof(std_event_ring_hdr_t)+STD_EVENT_RING_MAX_SIZE) break;
+        if ((rc=ring_map(r,st.st_size,false))!=STD_ERR_OK) break;
+
+        rc = STD_ERR(COM,PARAM,0);
+        r->size = r->hdr->size;
+        if (r->hdr->magic!=STD_EVENT_RING_MAGIC ||
+                r->hdr->version!=STD_EVENT_RING_VERSION) break;
+        if (r->size==0 || (r->size & (r->size-1))!=0 ||
+                sizeof(std_event_ring_hdr_t)+r->size > r->map_len) break;
+        *ring = r;
+        return STD_ERR_OK;
+    } while (0);
+
+    std_event_ring_free(r);
+    return rc;
+}
+
+void std_event_ring_free(std_event_ring_t *ring) {
+    if (ring==NULL) return;
+    if (ring->hdr!=NULL) munmap(ring->hdr,ring->map_len);
+    if (ring->mem_fd!=-1) close(ring->mem_fd);
+    if (ring->bell_fd!=-1) close(ring->bell_fd);
+    std_mutex_destroy(&ring->lock);
+    free(ring);
+}
+
+t_std_error std_event_ring_write(std_event_ring_t *ring, const struct iovec *iov,
+        size_t iov_len, size_t timeout) {
+    size_t len = 0;
+    for (size_t ix = 0; ix < iov_len ; ++ix) len += iov[ix].iov_len;
+
+    size_t need = STD_EVENT_RING_ALIGN(sizeof(uint32_t) + len);
+    if (need > ring->size/2) return STD_ERR(COM,TOOBIG,0);
+
+    std_mutex_simple_lock_guard l(&ring->lock);
+
+    std_event_ring_hdr_t *hdr = ring->hdr;
+    uint64_t head = hdr->head;
+    size_t off = head & (ring->size-1);
+    size_t pad = (off + need > ring->size) ? ring->size - off : 0;
+
+    size_t waited = 0;
+    while (head + pad + need - __atomic_load_n(&hdr->tail,__ATOMIC_ACQUIRE) > ring->size) {
+        if (waited >= timeout*1000) return STD_ERR(COM,FAIL,0);
+        usleep(STD_EVENT_RING_FULL_WAIT);
+        waited += STD_EVENT_RING_FULL_WAIT;
+    }
+
+    if (pad!=0) {
+        *(uint32_t*)(ring->data + off) = STD_EVENT_RING_PAD;
+        off = 0;
+    }
+    *(uint32_t*)(ring->data + off) = (uint32_t)len;
+    uint8_t *p = ring->data + off + sizeof(uint32_t);
+    for (size_t ix = 0; ix < iov_len ; ++ix) {
+        memcpy(p,iov[ix].iov_base,iov[ix].iov_len);
+        p += iov[ix].iov_len;
+    }
+    __atomic_store_n(&hdr->head,head + pad + need,__ATOMIC_RELEASE);
+
+    /* pairs with the fence in std_event_ring_wait - either the consumer sees
+     * the new head or this sees that it is waiting */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&hdr->waiting,__ATOMIC_RELAXED)) {
+        __atomic_store_n(&hdr->waiting,0,__ATOMIC_RELAXED);
+        uint64_t one = 1;
+        if (write(ring->bell_fd,&one,sizeof(one))!=sizeof(one)) {
+            /* the counter can only be full if the consumer is not reading it */
+        }
+    }
+    return STD_ERR_OK;
+}
+
+t_std_error std_event_ring_take(std_event_ring_t *ring, std::vector<uint8_t> &buff,
+        size_t offset, bool allow_resize, size_t *len) {
+    std_event_ring_hdr_t *hdr = ring->hdr;
+
+    for ( ;; ) {
+        uint64_t tail = hdr->tail;
+        uint64_t head = __atomic_load_n(&hdr->head,__ATOMIC_ACQUIRE);
+        if (head==tail) return STD_ERR(COM,NEXIST,0);
+
+        size_t off = tail & (ring->size-1);
+        if (head - tail > ring->size || off + sizeof(uint32_t) > ring->size) {
+            return STD_ERR(COM,FAIL,0);
+        }
+        uint32_t rec_len = *(uint32_t*)(ring->data + off);
+        if (rec_len==STD_EVENT_RING_PAD) {
+            __atomic_store_n(&hdr->tail,tail + (ring->size - off),__ATOMIC_RELEASE);
+            continue;
+        }
+        size_t need = STD_EVENT_RING_ALIGN(sizeof(uint32_t) + rec_len);
+        if (need > ring->size/2 || off + need > ring->size || need > head - tail) {
+            EV_LOG(ERR,COM,0,"COM-EVENT-RING","Corrupt event ring record");
+            return STD_ERR(COM,FAIL,0);
+        }
+
+        t_std_error rc = STD_ERR_OK;
+        if (offset + rec_len > buff.size() && !allow_resize) {
+            rc = STD_ERR(COM,TOOBIG,0);
+        } else {
+            /* like the socket receive the buffer only grows */
+            try {
+                if (offset + rec_len > buff.size()) buff.resize(offset + rec_len);
+                if (rec_len>0) memcpy(&buff[offset],ring->data + off + sizeof(uint32_t),rec_len);
+                *len = rec_len;
+            } catch (...) {
+                rc = STD_ERR(COM,NOMEM,0);
+            }
+        }
+        __atomic_store_n(&hdr->tail,tail + need,__ATOMIC_RELEASE);
+        return rc;
+    }
+}
+
+t_std_error std_event_ring_wait(std_event_ring_t *ring, int sock, bool *sock_ready) {
+    std_event_ring_hdr_t *hdr = ring->hdr;
+    uint64_t tail = hdr->tail;
+    *sock_ready = false;
+
+    for ( ;; ) {
+        /* going to sleep - tell the producer, then check again in case it
+         * added a record before it could see the flag */
+        __atomic_store_n(&hdr->waiting,1,__ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&hdr->head,__ATOMIC_ACQUIRE)!=tail) return STD_ERR_OK;
+
+        struct pollfd fds[2];
+        fds[0].fd = ring->bell_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = sock;
+        fds[1].events = POLLIN;
+        int rc = poll(fds,2,-1);
+        if (rc<0 && errno!=EINTR) return STD_ERR(COM,FAIL,errno);
+        if (rc<=0) continue;
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            if (read(ring->bell_fd,&count,sizeof(count))<0) {
+                /* already cleared */
+            }
+        }
+        if ((fds[1].revents & (POLLIN|POLLHUP|POLLERR)) &&
+                __atomic_load_n(&hdr->head,__ATOMIC_ACQUIRE)==tail) {
+            __atomic_store_n(&hdr->waiting,0,__ATOMIC_RELAXED);
+            *sock_ready = true;
+            return STD_ERR_OK;
+        }
+    }
+}
+
+t_std_error std_event_ring_read(std_event_ring_t *ring, int sock,
+        std::vector<uint8_t> &buff, bool allow_resize, bool *sock_ready) {
+    *sock_ready = false;
+    for ( ;; ) {
+        size_t len;
+        t_std_error rc = std_event_ring_take(ring,buff,0,allow_resize,&len);
+        if (rc==STD_ERR_OK || STD_ERR_EXT_ERRID(rc)!=e_std_err_code_NEXIST) return rc;
+
+        rc = std_event_ring_wait(ring,sock,sock_ready);
+        if (rc!=STD_ERR_OK || *sock_ready) return rc;
+    }
+}
+
+t_std_error std_event_ring_send_fds(int sock, std_event_ring_t *ring,
+        const void *data, size_t len) {
+    union {
+        struct cmsghdr hdr;
+        char buff[CMSG_SPACE(2*sizeof(int))];
+    } ctl;
+    memset(&ctl,0,sizeof(ctl));
+
+    struct iovec iov;
+    iov.iov_base = (void*)data;
+    iov.iov_len = len;
+
+    struct msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (ring!=NULL) {
+        msg.msg_control = ctl.buff;
+        msg.msg_controllen = sizeof(ctl.buff);
+        struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(2*sizeof(int));
+        int fds[2] = { ring->mem_fd, ring->bell_fd };
+        memcpy(CMSG_DATA(c),fds,sizeof(fds));
+    }
+
+    ssize_t by;
+    do {
+        by = sendmsg(sock,&msg,MSG_NOSIGNAL);
+    } while (by<0 && errno==EINTR);
+    /* the message is a few bytes so a short write means the socket is unusable */
+    return by==(ssize_t)len ? STD_ERR_OK : STD_ERR(COM,FAIL,errno);
+}
+
+t_std_error std_event_ring_recv_fds(int sock, void *data, size_t len,
+        int *mem_fd, int *bell_fd, size_t timeout) {
+    union {
+        struct cmsghdr hdr;
+        char buff[CMSG_SPACE(2*sizeof(int))];
+    } ctl;
+
+    *mem_fd = -1;
+    *bell_fd = -1;
+
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    int rc;
+    do {
+        rc = poll(&pfd,1,timeout);
+    } while (rc<0 && errno==EINTR);
+    if (rc<=0) return STD_ERR(COM,FAIL,0);
+
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = len;
+
+    struct msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buff;
+    msg.msg_controllen = sizeof(ctl.buff);
+
+    ssize_t by;
+    do {
+        by = recvmsg(sock,&msg,MSG_WAITALL|MSG_CMSG_CLOEXEC);
+    } while (by<0 && errno==EINTR);
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c!=NULL; c = CMSG_NXTHDR(&msg,c)) {
+        if (c->cmsg_level!=SOL_SOCKET || c->cmsg_type!=SCM_RIGHTS) continue;
+        size_t n = (c->cmsg_len - CMSG_LEN(0))/sizeof(int);
+        int fds[2];
+        if (n!=2) {
+            /* not ours - don't leak them */
+            for (size_t ix = 0; ix < n ; ++ix) {
+                int fd;
+                memcpy(&fd,CMSG_DATA(c)+ix*sizeof(int),sizeof(fd));
+                close(fd);
+            }
+            continue;
+        }
+        memcpy(fds,CMSG_DATA(c),sizeof(fds));
+        if (*mem_fd!=-1) {
+            close(fds[0]);
+            close(fds[1]);
+            continue;
+        }
+        *mem_fd = fds[0];
+        *bell_fd = fds[1];
+    }
+
+    if (by!=(ssize_t)len || (msg.msg_flags & MSG_CTRUNC)) {
+        if (*mem_fd!=-1) {
+            close(*mem_fd);
+            close(*bell_fd);
+            *mem_fd = -1;
+            *bell_fd = -1;
+        }
+        return STD_ERR(COM,FAIL,0);
+    }
+    return STD_ERR_OK;
+}
@@ -30,6 +30,7 @@
 
 #include "std_event_service.h"
 #include "private/std_event_utils.h"
+#include "private/std_event_ring.h"
 
 #include "std_socket_tools.h"
 
@@ -42,9 +43,12 @@
 
 #include "event_log.h"
 #include "std_time_tools.h"
+#include "std_hash.h"
 
 
 #include <stdio.h>
+#include <stddef.h>
+#include <algorithm>
 #include <list>
 #include <map>
 #include <memory>
@@ -54,7 +58,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <set>
 
 #define DEF_LISTENERS (10)
 #define COM_EVT_SERV_NAME "EVENT_SERVICE"
@@ -70,20 +73,83 @@
 #define EV_WRITE_TIMEOUT (100)
 #define EV_SEND_TIMEOUT (2000)
 
+/* a subscriber's queued events are written once they reach this size */
+#define EV_FLUSH_SIZE (64*1024)
+
 
 #define LE(strid,message,...) EV_LOG_ERR(ev_log_t_COM,0,strid,message,##__VA_ARGS__)
 #define LI(lvl,message,...) EV_LOG_ERR(ev_log_t_COM,lvl,"COM",message,##__VA_ARGS__)
 #define LT(lvl,message,...) EV_LOG_TRACE(ev_log_t_COM,lvl,"COM",message,##__VA_ARGS__)
 #define STD_ERR_RC(type,x) STD_ERR_MK(e_std_err_COM,e_std_err_code_##type,(x))
 
+struct event_service_client_data_t {
+    int fd;
+    /* bytes read from the client that haven't been processed yet */
+    std::vector<uint8_t> in;
+    size_t in_start;
+    size_t in_end;
+    size_t in_need;
+    /* the message being processed */
+    std::vector<uint8_t> buff;
+    /* events go through this instead of the socket when set */
+    std_event_ring_t *ring;
+    /* sent to the client but not used until the client says it has mapped it */
+    std_event_ring_t *ring_offered;
+
+    /* events waiting to be written to the socket */
+    std_mutex_type_t out_lock;
+    std::vector<uint8_t> out;
+    uint64_t out_since;     /* uptime (us) when the oldest event in out was added */
+    bool out_queued;        /* on a publisher's list of clients to flush */
+
+    event_service_client_data_t(int sock) : fd(sock), in_start(0), in_end(0),
+            in_need(0), ring(NULL), ring_offered(NULL), out_since(0), out_queued(false) {
+        std_mutex_lock_init_non_recursive(&out_lock);
+    }
+    ~event_service_client_data_t() {
+        std_event_ring_free(ring);
+        std_event_ring_free(ring_offered);
+        std_mutex_destroy(&out_lock);
+    }
+};
+
+/* the clients with queued events that the publishing thread has to flush */
+typedef std::vector<event_service_client_data_t*> event_service_pending_t;
+
+struct std_client_slot_t {
+    int fd;     /* -1 when the slot is free */
+    event_service_client_data_t *client;
+};
+
+/* the registered clients indexed by client slot */
+typedef std::vector<std_client_slot_t> std_client_slots_t;
+
+struct std_node_t;
+
+/* entry of the flat subscription index - the key is the node's path zero
+ * padded to the full key length */
+struct std_node_index_t {
+    std_event_key_t key;
+    std_node_t *node;
+};
+
 struct std_node_t {
     typedef std::map<uint32_t,struct std_node_t*> node_type_t;
     typedef node_type_t::iterator iterator;
 
-    std::vector<uint32_t> key;
+    std_node_index_t index;
+    std_node_t *parent;
     std::map<uint32_t,struct std_node_t*> m_nodes;
 
-    std::set<int> clients;
+    /* client slots registered at this level */
+    std::vector<size_t> clients;
+    /* client slots registered at this level or any level above it, each once */
+    std::vector<size_t> matched;
+
+    std_node_t() : parent(NULL) {
+        memset(&index,0,sizeof(index));
+        index.node = this;
+    }
 
     std_node_t::iterator end() { return m_nodes.end(); }
 
@@ -91,31 +157,44 @@ struct std_node_t {
         return m_nodes.find(id);
     }
 
-    bool create_node(uint32_t node) ;
-    bool insert(int fd) ;
-    void remove(int fd) ;
-    void publish(std_socket_server_handle_t handle, std_event_msg_t *msg, std::set<int> &fds) ;
-    void remove_from_tree(int fd);
+    bool create_node(uint32_t node, std_hash_handle idx) ;
+    bool insert(size_t slot) ;
+    void remove(size_t slot) ;
+    bool update_matched() ;
+    void publish(std_socket_server_handle_t handle, std_event_msg_t *msg,
+            const std_client_slots_t &slots, event_service_pending_t &pending) ;
+    void remove_from_tree(size_t slot);
 
     bool empty() {
         return m_nodes.size()==0 && clients.size()==0;
     }
-    void clean_empty_nodes();
+    void clean_empty_nodes(std_hash_handle idx);
 };
 
 class std_client_tree {
 private:
     std_node_t head;
+    std_client_slots_t m_slots;
+    std::map<int,size_t> m_fd_slots;
+    std::vector<size_t> m_free_slots;
+
+    /* every node of the tree by its full key path */
+    std_hash_handle m_index;
+    size_t m_depth;
+
     std_node_t * find(uint32_t *list, size_t len, bool create=false) ;
+    std_node_t * match(const std_event_key_t *key) ;
+    bool get_slot(int fd, event_service_client_data_t *client, size_t &slot, bool create) ;
 public:
-    bool reg_client(int fd, std_event_key_t *key) ;
+    std_client_tree() : m_index(NULL), m_depth(0) {}
+    ~std_client_tree() {
+        if (m_index!=NULL) std_hash_destroy(m_index);
+    }
+    bool reg_client(int fd, event_service_client_data_t *client, std_event_key_t *key) ;
     bool dereg_client(int fd, std_event_key_t *key) ;
     void remove_from_tree(int fd) ;
-    void publish(std_socket_server_handle_t handle, std_event_msg_t *msg);
-};
-
-struct event_service_client_data_t {
-    std::vector<uint8_t> buff;
+    void publish(std_socket_server_handle_t handle, std_event_msg_t *msg,
+            event_service_pending_t &pending);
 };
 
 typedef std::map<int,event_service_client_data_t *> event_service_clients_t;
@@ -132,11 +211,31 @@ struct  std_socket_event_server_t {
     bool new_client_connection(int fd);
     bool reg_message(int fd, std_event_key_t *key);
     bool dereg_message(int fd, std_event_key_t *key);
+    bool ring_message(int fd, uint64_t size);
+    bool ring_use_message(int fd);
+
+    /* how long (ms) queued events may wait for more to be written with them */
+    size_t m_flush_latency;
+    bool m_flusher_running;
+    bool m_flusher_stop;
+    std_thread_create_param_t m_flusher;
+
+    void flush_pending(event_service_pending_t &pending);
+    void flush_expired();
+    void flush_failed(event_service_client_data_t *c);
 
     std_socket_event_server_t() {
         m_sock_service = NULL;
+        m_flush_latency = 0;
+        m_flusher_running = false;
+        m_flusher_stop = false;
     }
     void cleanup() {
+        if (m_flusher_running) {
+            __atomic_store_n(&m_flusher_stop,true,__ATOMIC_RELAXED);
+            std_thread_join(&m_flusher);
+            m_flusher_running = false;
+        }
         if (m_sock_service!=NULL) {
             std_socket_service_destroy(m_sock_service);
         }
@@ -147,70 +246,154 @@ struct  std_socket_event_server_t {
         cleanup();
     }
 
-    void publish(std_event_msg_t *msg);
+    void publish(std_event_msg_t *msg, event_service_pending_t &pending);
 } ;
 
 
-bool std_node_t::create_node(uint32_t node) {
+bool std_node_t::create_node(uint32_t node, std_hash_handle idx) {
     std::unique_ptr<std_node_t> n (new std_node_t);
+    n->parent = this;
+    n->index.key = index.key;
+    n->index.key.event_key[n->index.key.len++] = node;
     try {
+        n->matched = matched;
+        if (std_hash_insert(idx,&n->index)!=STD_ERR_OK) return false;
         m_nodes[node] = n.get();
-        n.release();
     } catch(...) {
+        std_hash_remove(idx,&n->index);
         return false;
     }
+    n.release();
     return true;
 }
 
-bool std_node_t::insert(int fd) {
+bool std_node_t::insert(size_t slot) {
+    for (size_t ix = 0; ix < clients.size() ; ++ix) {
+        if (clients[ix]==slot) return true;
+    }
     try {
-        clients.insert(fd);
+        clients.push_back(slot);
     } catch (...){
         return false;
     }
     return true;
 }
 
-void std_node_t::remove(int fd) {
-    clients.erase(fd);
+void std_node_t::remove(size_t slot) {
+    for (size_t ix = 0; ix < clients.size() ; ++ix) {
+        if (clients[ix]!=slot) continue;
+        clients[ix] = clients.back();
+        clients.pop_back();
+        return;
+    }
 }
 
-void std_node_t::publish(std_socket_server_handle_t handle, std_event_msg_t *msg,
-        std::set<int> &fds) {
-    if (clients.size()==0) return;
+/*
+ * recalculate the matched list of this node and the nodes below it after the
+ * clients changed.  The head is not part of any match so its list stays empty
+ */
+bool std_node_t::update_matched() {
+    if (parent!=NULL) {
+        try {
+            matched = parent->matched;
+            for (size_t ix = 0; ix < clients.size() ; ++ix) {
+                if (std::find(matched.begin(),matched.end(),clients[ix])==matched.end()) {
+                    matched.push_back(clients[ix]);
+                }
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    bool rc = true;
+    iterator it = m_nodes.begin();
+    iterator end = m_nodes.end();
+    for ( ; it != end ; ++it ) {
+        if (!it->second->update_matched()) rc = false;
+    }
+    return rc;
+}
 
-    std::set<int>::iterator it = clients.begin();
-    std::set<int>::iterator end = clients.end();
+static t_std_error event_flush_locked(event_service_client_data_t *c) {
+    if (c->out.size()==0) return STD_ERR_OK;
+    t_std_error rc = std_event_util_write(c->fd,&c->out[0],c->out.size(),EV_WRITE_TIMEOUT);
+    c->out.clear();
+    return rc;
+}
+
+/*
+ * add the event to the client's outbound buffer.  The buffer is written when
+ * it is full, otherwise the client goes on the pending list for the
+ * publishing thread to flush once it has published everything it has read
+ */
+static t_std_error event_queue(event_service_client_data_t *c, event_serv_msg_t *m,
+        std_event_msg_descr_t *d, event_service_pending_t &pending) {
+    std_mutex_simple_lock_guard l(&c->out_lock);
+    if (c->out.size()==0) c->out_since = std_get_uptime(NULL);
+
+    t_std_error rc = std_event_util_event_frame(c->out,m,d,1);
+    if (rc!=STD_ERR_OK) return rc;
+    if (c->out.size() >= EV_FLUSH_SIZE) return event_flush_locked(c);
+
+    if (!c->out_queued) {
+        try {
+            pending.push_back(c);
+        } catch (...) {
+            return event_flush_locked(c);
+        }
+        c->out_queued = true;
+    }
+    return STD_ERR_OK;
+}
+
+void std_node_t::publish(std_socket_server_handle_t handle, std_event_msg_t *msg,
+        const std_client_slots_t &slots, event_service_pending_t &pending) {
     event_serv_msg_t m;
     m.op = event_serv_msg_t_PUBLISH;
     std_event_msg_descr_t d;
     d.data = msg;
     d.len = sizeof(*msg)+msg->data_len;
-    for ( ; it != end ; ++it ) {
-        if (fds.find(*it)!=fds.end()) continue;
-        if (std_event_util_event_send(*it,&m,&d,1,EV_WRITE_TIMEOUT)!=STD_ERR_OK) {
-            std_socket_service_client_close(handle,*it);
-            EV_LOG(ERR,COM,0,"COM-EVENT-SEND","Client not receiving messages.  Terminating (%d)",*it);
+    struct iovec iov[2];
+    iov[0].iov_base = &m;
+    iov[0].iov_len = sizeof(m);
+    iov[1].iov_base = d.data;
+    iov[1].iov_len = d.len;
+
+    for (size_t ix = 0; ix < matched.size() ; ++ix ) {
+        const std_client_slot_t &c = slots[matched[ix]];
+        t_std_error rc = STD_ERR_OK;
+        bool use_sock = (c.client->ring==NULL);
+        if (!use_sock) {
+            rc = std_event_ring_write(c.client->ring,iov,2,EV_WRITE_TIMEOUT);
+            /* too big for the ring - the client also reads the socket */
+            use_sock = (STD_ERR_EXT_ERRID(rc)==e_std_err_code_TOOBIG);
+        }
+        if (use_sock) {
+            rc = event_queue(c.client,&m,&d,pending);
+        }
+        if (rc!=STD_ERR_OK) {
+            std_socket_service_client_close(handle,c.fd);
+            EV_LOG(ERR,COM,0,"COM-EVENT-SEND","Client not receiving messages.  Terminating (%d)",c.fd);
         }
-        fds.insert(*it);
     }
 }
 
-void std_node_t::remove_from_tree(int fd) {
+void std_node_t::remove_from_tree(size_t slot) {
     iterator it = m_nodes.begin();
     iterator end = m_nodes.end();
     for ( ; it != end ; ++it ) {
-        (it->second)->remove_from_tree(fd);
+        (it->second)->remove_from_tree(slot);
     }
-    remove(fd);
+    remove(slot);
 }
 
-void std_node_t::clean_empty_nodes() {
+void std_node_t::clean_empty_nodes(std_hash_handle idx) {
     iterator it = m_nodes.begin();
     iterator end = m_nodes.end();
     for ( ; it != end ; ++it ) {
-        it->second->clean_empty_nodes();
+        it->second->clean_empty_nodes(idx);
         if (it->second->empty()) {
+            std_hash_remove(idx,&it->second->index);
             delete it->second;
             m_nodes.erase(it);
             it = m_nodes.begin();
@@ -226,7 +409,13 @@ std_node_t * std_client_tree::find(uint32_t *list, size_t len, bool create) {
         std_node_t::iterator it = cur->find(list[ix]);
         if (it==cur->end()) {
             if (!create) return NULL;
-            cur->create_node(list[ix]);
+            if (m_index==NULL) {
+                m_index = std_hash_create_simple("event-keys",
+                        offsetof(std_node_index_t,key),sizeof(std_event_key_t));
+                if (m_index==NULL) return NULL;
+            }
+            if (!cur->create_node(list[ix],m_index)) return NULL;
+            if (ix+1 > m_depth) m_depth = ix+1;
 
             it = cur->find(list[ix]);
             if (it==cur->end()) return NULL;
@@ -236,47 +425,194 @@ std_node_t * std_client_tree::find(uint32_t *list, size_t len, bool create) {
     return cur;
 }
 
-bool std_client_tree::reg_client(int fd, std_event_key_t *key) {
+bool std_client_tree::get_slot(int fd, event_service_client_data_t *client,
+        size_t &slot, bool create) {
+    std::map<int,size_t>::iterator it = m_fd_slots.find(fd);
+    if (it!=m_fd_slots.end()) {
+        slot = it->second;
+        return true;
+    }
+    if (!create) return false;
+
+    std_client_slot_t c = { fd, client };
+    try {
+        if (m_free_slots.size()>0) {
+            slot = m_free_slots.back();
+            m_fd_slots[fd] = slot;
+            m_free_slots.pop_back();
+            m_slots[slot] = c;
+        } else {
+            slot = m_slots.size();
+            m_slots.reserve(slot+1);
+            m_free_slots.reserve(slot+1);
+            m_fd_slots[fd] = slot;
+            m_slots.push_back(c);
+        }
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+bool std_client_tree::reg_client(int fd, event_service_client_data_t *client,
+        std_event_key_t *key) {
+    size_t slot;
+    if (key->len > STD_EVENT_KEY_MAX) return false;
     std_node_t * cur = find(key->event_key,key->len,true);
     if (cur==NULL) return false;
-    return cur->insert(fd);
+    if (!get_slot(fd,client,slot,true)) return false;
+    if (!cur->insert(slot)) return false;
+    if (!cur->update_matched()) {
+        cur->remove(slot);
+        cur->update_matched();
+        return false;
+    }
+    return true;
 }
 
 bool std_client_tree::dereg_client(int fd, std_event_key_t *key) {
+    size_t slot;
+    if (key->len > STD_EVENT_KEY_MAX) return true;
     std_node_t * cur = find(key->event_key,key->len,false);
     if (cur==NULL) return true;
-    cur->remove(fd);
+    if (!get_slot(fd,NULL,slot,false)) return true;
+    cur->remove(slot);
+    /* the lists only shrink so this can't run out of memory */
+    cur->update_matched();
     return true;
 }
 
 void std_client_tree::remove_from_tree(int fd) {
-    head.remove_from_tree(fd);
+    std::map<int,size_t>::iterator it = m_fd_slots.find(fd);
+    if (it==m_fd_slots.end()) return;
+
+    size_t slot = it->second;
+    head.remove_from_tree(slot);
+    head.update_matched();
+    m_fd_slots.erase(it);
+    m_slots[slot].fd = -1;
+    m_slots[slot].client = NULL;
+    /* get_slot has reserved room for every slot in the free list */
+    m_free_slots.push_back(slot);
 }
 
-void std_client_tree::publish(std_socket_server_handle_t handle, std_event_msg_t *msg) {
-    size_t ix = 0;
-    std_node_t * cur = &head;
-    size_t len = msg->key.len;
-    std::set<int> already_sent;
-    for ( ; ix < len; ++ix ) {
-        std_node_t::iterator it = cur->find(msg->key.event_key[ix]);
-        if (it==cur->end()) {
-            return;
+/*
+ * find the deepest node on the key's path.  A node exists for every prefix of
+ * a registered key, so the prefixes of the key that are in the index are
+ * always 1..n and n can be found with a binary search.  Most keys hit on the
+ * first lookup.
+ */
+std_node_t * std_client_tree::match(const std_event_key_t *key) {
+    if (m_index==NULL) return NULL;
+
+    size_t hi = key->len;
+    if (hi > m_depth) hi = m_depth;
+    if (hi > STD_EVENT_KEY_MAX) hi = STD_EVENT_KEY_MAX;
+    if (hi==0) return NULL;
+
+    std_node_index_t probe;
+    memset(&probe,0,sizeof(probe));
+    memcpy(probe.key.event_key,key->event_key,hi*sizeof(*key->event_key));
+    probe.key.len = hi;
+
+    std_node_index_t *found = (std_node_index_t*)std_hash_getexact(m_index,&probe);
+    if (found!=NULL) return found->node;
+
+    std_node_t *best = NULL;
+    size_t lo = 1;
+    --hi;
+    while (lo <= hi) {
+        size_t mid = (lo + hi) / 2;
+        memset(&probe.key,0,sizeof(probe.key));
+        memcpy(probe.key.event_key,key->event_key,mid*sizeof(*key->event_key));
+        probe.key.len = mid;
+        found = (std_node_index_t*)std_hash_getexact(m_index,&probe);
+        if (found!=NULL) {
+            best = found->node;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
         }
-        cur = it->second;
-        cur->publish(handle,msg,already_sent);
     }
+    return best;
+}
+
+void std_client_tree::publish(std_socket_server_handle_t handle, std_event_msg_t *msg,
+        event_service_pending_t &pending) {
+    std_node_t *cur = match(&msg->key);
+    if (cur==NULL) return;
+    cur->publish(handle,msg,m_slots,pending);
+}
+
+
+/* the caller holds the read lock */
+void std_socket_event_server_t::publish(std_event_msg_t *msg, event_service_pending_t &pending) {
+    m_reg_tree.publish(m_sock_service, msg, pending);
+}
+
+void std_socket_event_server_t::flush_failed(event_service_client_data_t *c) {
+    std_socket_service_client_close(m_sock_service,c->fd);
+    EV_LOG(ERR,COM,0,"COM-EVENT-SEND","Client not receiving messages.  Terminating (%d)",c->fd);
+}
+
+/*
+ * write the queued events of the clients a publishing thread added to.  With
+ * a flush latency the events that haven't waited that long yet are left for
+ * the flusher thread.  The caller holds the read lock
+ */
+void std_socket_event_server_t::flush_pending(event_service_pending_t &pending) {
+    size_t latency = m_flush_latency;
+    uint64_t now = (latency==0) ? 0 : std_get_uptime(NULL);
+
+    for (size_t ix = 0; ix < pending.size() ; ++ix) {
+        event_service_client_data_t *c = pending[ix];
+        t_std_error rc = STD_ERR_OK;
+        {
+            std_mutex_simple_lock_guard l(&c->out_lock);
+            c->out_queued = false;
+            if (latency==0 || now - c->out_since >= latency*1000) {
+                rc = event_flush_locked(c);
+            }
+        }
+        if (rc!=STD_ERR_OK) flush_failed(c);
+    }
+    pending.clear();
 }
 
+void std_socket_event_server_t::flush_expired() {
+    size_t latency = __atomic_load_n(&m_flush_latency,__ATOMIC_RELAXED);
+    uint64_t now = std_get_uptime(NULL);
 
-void std_socket_event_server_t::publish(std_event_msg_t *msg) {
     std_rw_lock_read_guard l(&m_tree_lock);
-    m_reg_tree.publish(m_sock_service, msg);
+    event_service_clients_t::iterator it = m_event_clients.begin();
+    event_service_clients_t::iterator end = m_event_clients.end();
+    for ( ; it != end ; ++it ) {
+        event_service_client_data_t *c = it->second;
+        t_std_error rc = STD_ERR_OK;
+        {
+            std_mutex_simple_lock_guard cl(&c->out_lock);
+            if (c->out.size()>0 && now - c->out_since >= latency*1000) {
+                rc = event_flush_locked(c);
+            }
+        }
+        if (rc!=STD_ERR_OK) flush_failed(c);
+    }
+}
+
+static void * event_flusher(void *param) {
+    std_socket_event_server_t *p = (std_socket_event_server_t*)param;
+    while (!__atomic_load_n(&p->m_flusher_stop,__ATOMIC_RELAXED)) {
+        /* check a few times per latency period so nothing waits much longer */
+        size_t latency = __atomic_load_n(&p->m_flush_latency,__ATOMIC_RELAXED);
+        std_usleep(latency==0 ? 100000 : latency*1000/4 + 1);
+        if (latency!=0) p->flush_expired();
+    }
+    return NULL;
 }
 
 bool std_socket_event_server_t::new_client_connection(int fd) {
     try {
-        m_event_clients[fd] = new event_service_client_data_t;
+        m_event_clients[fd] = new event_service_client_data_t(fd);
     } catch (...) {
         return false;
     }
@@ -295,7 +631,9 @@ void std_socket_event_server_t::close_client_connection(int fd) {
 
 bool std_socket_event_server_t::reg_message(int fd, std_event_key_t *key) {
     std_rw_lock_write_guard l(&m_tree_lock);
-    return m_reg_tree.reg_client(fd, key);
+    event_service_clients_t::iterator it = m_event_clients.find(fd);
+    if (it==m_event_clients.end()) return false;
+    return m_reg_tree.reg_client(fd, it->second, key);
 }
 
 bool std_socket_event_server_t::dereg_message(int fd, std_event_key_t *key) {
@@ -304,6 +642,55 @@ bool std_socket_event_server_t::dereg_message(int fd, std_event_key_t *key) {
     return true;
 }
 
+/*
+ * the client asked for its events through a shared memory ring.  The reply is
+ * an SHM_RING message with the ring size (0 if it couldn't be created) and the
+ * ring's fds attached.  The events keep going to the socket until the client
+ * confirms with SHM_RING_USE - a client that gave up waiting for the reply
+ * never does, and skips the reply when it shows up among its events
+ */
+bool std_socket_event_server_t::ring_message(int fd, uint64_t size) {
+    std_event_ring_t *ring = NULL;
+    uint64_t reply = 0;
+    event_service_client_data_t *c;
+
+    if (std_event_ring_create(size,&ring)!=STD_ERR_OK) ring = NULL;
+    {
+        std_rw_lock_write_guard l(&m_tree_lock);
+        event_service_clients_t::iterator it = m_event_clients.find(fd);
+        if (it==m_event_clients.end() || it->second->ring!=NULL ||
+                it->second->ring_offered!=NULL) {
+            std_event_ring_free(ring);
+            return false;
+        }
+        c = it->second;
+        c->ring_offered = ring;
+        if (ring!=NULL) reply = ring->size;
+    }
+
+    event_serv_msg_t m;
+    m.op = event_serv_msg_t_SHM_RING;
+    std_event_msg_descr_t d;
+    d.data = &reply;
+    d.len = sizeof(reply);
+    std::vector<uint8_t> frame;
+    if (std_event_util_event_frame(frame,&m,&d,1)!=STD_ERR_OK) return false;
+
+    /* write out the queued events first so that the reply isn't sent in the middle of one */
+    std_mutex_simple_lock_guard l(&c->out_lock);
+    if (event_flush_locked(c)!=STD_ERR_OK) return false;
+    return std_event_ring_send_fds(fd,ring,&frame[0],frame.size())==STD_ERR_OK;
+}
+
+/* the client has mapped the ring - send its events through it from now on */
+bool std_socket_event_server_t::ring_use_message(int fd) {
+    std_rw_lock_write_guard l(&m_tree_lock);
+    event_service_clients_t::iterator it = m_event_clients.find(fd);
+    if (it==m_event_clients.end() || it->second->ring_offered==NULL) return false;
+    it->second->ring = it->second->ring_offered;
+    it->second->ring_offered = NULL;
+    return true;
+}
 
 inline std_socket_event_server_t * to_context(std_event_server_handle_t h) {
     return (std_socket_event_server_t*)h;
@@ -317,18 +704,7 @@ static void setup_address(std_socket_address_t *address, const char * event_chan
     address->addr_type = e_std_socket_a_t_STRING;
 }
 
-static bool event_some_data ( void *context, int fd ) {
-    std_socket_event_server_t *p = (std_socket_event_server_t*)context;
-
-    event_service_clients_t::iterator it = p->m_event_clients.find(fd);
-    if (it==p->m_event_clients.end()) {
-        return false;
-    }
-    std::vector<uint8_t> &buff =(*it).second->buff;
-    if (std_event_util_event_recv(fd,buff,true)!=STD_ERR_OK) {
-        return false;
-    }
-
+static bool event_dispatch(std_socket_event_server_t *p, int fd, std::vector<uint8_t> &buff) {
     if (buff.size()< sizeof(event_serv_msg_t)) return false;
 
     event_serv_msg_t *serv_msg = (event_serv_msg_t*) &(buff[0]);
@@ -341,10 +717,14 @@ static bool event_some_data ( void *context, int fd ) {
         std_event_key_t *key = (std_event_key_t *)data;
         p->dereg_message(fd,key);
     }
-    if (serv_msg->op == event_serv_msg_t_PUBLISH) {
-        std_event_msg_t *msg = (std_event_msg_t *)data;
-        if (buff.size()< (sizeof(event_serv_msg_t)+ sizeof(std_event_msg_t)+msg->data_len)) return false;
-        p->publish(msg);
+    if (serv_msg->op == event_serv_msg_t_SHM_RING) {
+        uint64_t size;
+        if (buff.size() < sizeof(event_serv_msg_t)+sizeof(size)) return false;
+        memcpy(&size,data,sizeof(size));
+        return p->ring_message(fd,size);
+    }
+    if (serv_msg->op == event_serv_msg_t_SHM_RING_USE) {
+        return p->ring_use_message(fd);
     }
     if (serv_msg->op == event_serv_msg_t_BUFFER) {
         size_t buff_len = *(size_t*)data;
@@ -360,6 +740,82 @@ static bool event_some_data ( void *context, int fd ) {
     return true;
 }
 
+/*
+ * Everything the client has sent is read at once and processed in order.  A
+ * run of published events is handled under one read lock and the events
+ * queued for each subscriber are written together at the end of the run.
+ */
+static bool event_some_data ( void *context, int fd ) {
+    std_socket_event_server_t *p = (std_socket_event_server_t*)context;
+    static thread_local event_service_pending_t pending;
+
+    event_service_clients_t::iterator it = p->m_event_clients.find(fd);
+    if (it==p->m_event_clients.end()) {
+        return false;
+    }
+    event_service_client_data_t *c = it->second;
+    if (std_event_util_event_fill(fd,c->in,c->in_start,c->in_end,c->in_need)!=STD_ERR_OK) {
+        return false;
+    }
+
+    bool rc = true;
+    bool locked = false;
+    for ( ;; ) {
+        uint8_t *payload;
+        size_t len;
+        t_std_error err = std_event_util_event_next(c->in,c->in_start,c->in_end,
+                &payload,&len,&c->in_need);
+        if (err!=STD_ERR_OK) {
+            /* the rest of the message hasn't arrived yet */
+            if (STD_ERR_EXT_ERRID(err)!=e_std_err_code_NEXIST) rc = false;
+            break;
+        }
+        /* copy the message out so that it's aligned */
+        try {
+            c->buff.assign(payload,payload+len);
+        } catch (...) {
+            rc = false;
+            break;
+        }
+        if (len < sizeof(event_serv_msg_t)) {
+            rc = false;
+            break;
+        }
+
+        event_serv_msg_t *serv_msg = (event_serv_msg_t*)vector_offset(c->buff,0);
+        if (serv_msg->op == event_serv_msg_t_PUBLISH) {
+            std_event_msg_t *msg = (std_event_msg_t *)vector_offset(c->buff,sizeof(event_serv_msg_t));
+            if (len < sizeof(event_serv_msg_t)+sizeof(std_event_msg_t) ||
+                    len < sizeof(event_serv_msg_t)+sizeof(std_event_msg_t)+msg->data_len) {
+                rc = false;
+                break;
+            }
+            if (!locked) {
+                std_rw_rlock(&p->m_tree_lock);
+                locked = true;
+            }
+            p->publish(msg,pending);
+            continue;
+        }
+
+        /* registrations etc take the write lock */
+        if (locked) {
+            p->flush_pending(pending);
+            std_rw_unlock(&p->m_tree_lock);
+            locked = false;
+        }
+        if (!event_dispatch(p,fd,c->buff)) {
+            rc = false;
+            break;
+        }
+    }
+    if (locked) {
+        p->flush_pending(pending);
+        std_rw_unlock(&p->m_tree_lock);
+    }
+    return rc;
+}
+
 //New client connection established
 static bool event_new_client(void *context,  int fd ) {
     std_socket_event_server_t *p = (std_socket_event_server_t*)context;
@@ -425,6 +881,28 @@ t_std_error std_event_server_init(std_event_server_handle_t *handle,
 }
 
 
+t_std_error std_event_server_set_flush_latency(std_event_server_handle_t handle,
+        size_t latency) {
+    std_socket_event_server_t *p = to_context(handle);
+    std_rw_lock_write_guard l(&p->m_tree_lock);
+
+    __atomic_store_n(&p->m_flush_latency,latency,__ATOMIC_RELAXED);
+    if (latency==0 || p->m_flusher_running) return STD_ERR_OK;
+
+    std_thread_init_struct(&p->m_flusher);
+    p->m_flusher.name = "Event flusher";
+    p->m_flusher.thread_function = event_flusher;
+    p->m_flusher.param = p;
+    if (std_thread_create(&p->m_flusher)!=STD_ERR_OK) {
+        EV_LOG(ERR,COM,0,"COM-EVENT-FLUSH","Failed to start the event flusher");
+        p->m_flush_latency = 0;
+        return STD_ERR(COM,FAIL,0);
+    }
+    p->m_flusher_running = true;
+    return STD_ERR_OK;
+}
+
+
 t_std_error std_server_client_connect(std_event_client_handle * handle, const char *event_channel_name) {
     std_socket_address_t addr;
     setup_address(&addr,event_channel_name);
@@ -441,8 +919,103 @@ t_std_error std_server_client_connect(std_event_client_handle * handle, const ch
     return STD_ERR_OK;
 }
 
+/* time to wait for the server to answer a ring request (ms) */
+#define EV_RING_REPLY_TIMEOUT (2000)
+
+/* the rings of the client connections that are using one, by handle */
+static std_mutex_lock_create_static_init_fast(client_rings_lock);
+static std::map<int,std_event_ring_t*> client_rings;
+static size_t client_ring_count = 0;
+
+static std_event_ring_t *client_ring(std_event_client_handle handle) {
+    if (__atomic_load_n(&client_ring_count,__ATOMIC_RELAXED)==0) return NULL;
+    std_mutex_simple_lock_guard l(&client_rings_lock);
+    std::map<int,std_event_ring_t*>::iterator it = client_rings.find(handle);
+    return it==client_rings.end() ? NULL : it->second;
+}
+
+t_std_error std_server_client_connect_shm(std_event_client_handle * handle,
+        const char *event_channel_name, size_t ring_size) {
+    t_std_error rc = std_server_client_connect(handle,event_channel_name);
+    if (rc!=STD_ERR_OK) return rc;
+
+    event_serv_msg_t m;
+    m.op = event_serv_msg_t_SHM_RING;
+    uint64_t size = ring_size;
+    std_event_msg_descr_t d;
+    d.data = &size;
+    d.len = sizeof(size);
+    if ((rc=std_event_util_event_send(*handle,&m,&d,1,EV_SEND_TIMEOUT))!=STD_ERR_OK) {
+        std_server_client_disconnect(*handle);
+        return rc;
+    }
+
+    /*
+     * a server without ring support doesn't answer so stay on the socket.  A
+     * server that answers after this gave up never uses the ring since it
+     * isn't told to, and its reply is skipped by the event receive functions
+     */
+    int mem_fd, bell_fd;
+    uint8_t reply[sizeof(std_event_ipc_data_t)+sizeof(event_serv_msg_t)+sizeof(uint64_t)];
+    if (std_event_ring_recv_fds(*handle,reply,sizeof(reply),&mem_fd,&bell_fd,
+            EV_RING_REPLY_TIMEOUT)!=STD_ERR_OK) {
+        EV_LOG(ERR,COM,0,"COM-EVENT-RING","Event ring not available, using the socket");
+        return STD_ERR_OK;
+    }
+
+    std_event_ipc_data_t hdr;
+    memcpy(&hdr,reply,sizeof(hdr));
+    memcpy(&m,reply+sizeof(hdr),sizeof(m));
+    if (hdr.size!=sizeof(m)+sizeof(uint64_t) || m.op!=event_serv_msg_t_SHM_RING) {
+        if (mem_fd!=-1) {
+            close(mem_fd);
+            close(bell_fd);
+        }
+        std_server_client_disconnect(*handle);
+        return STD_ERR(COM,FAIL,0);
+    }
+    if (mem_fd==-1) {
+        EV_LOG(ERR,COM,0,"COM-EVENT-RING","Server couldn't create an event ring, using the socket");
+        return STD_ERR_OK;
+    }
+
+    std_event_ring_t *ring = NULL;
+    if (std_event_ring_attach(mem_fd,bell_fd,&ring)!=STD_ERR_OK) {
+        EV_LOG(ERR,COM,0,"COM-EVENT-RING","Failed to map the event ring, using the socket");
+        return STD_ERR_OK;
+    }
+
+    m.op = event_serv_msg_t_SHM_RING_USE;
+    if ((rc=std_event_util_event_send(*handle,&m,NULL,0,EV_SEND_TIMEOUT))!=STD_ERR_OK) {
+        std_event_ring_free(ring);
+        std_server_client_disconnect(*handle);
+        return rc;
+    }
+
+    std_mutex_simple_lock_guard l(&client_rings_lock);
+    try {
+        client_rings[*handle] = ring;
+    } catch (...) {
+        std_event_ring_free(ring);
+        close(*handle);
+        return STD_ERR(COM,NOMEM,0);
+    }
+    __atomic_add_fetch(&client_ring_count,1,__ATOMIC_RELAXED);
+    return STD_ERR_OK;
+}
+
 t_std_error std_server_client_disconnect(std_event_client_handle handle) {
-    if (handle!=-1) close(handle);
+    if (handle==-1) return STD_ERR_OK;
+    if (client_ring(handle)!=NULL) {
+        std_mutex_simple_lock_guard l(&client_rings_lock);
+        std::map<int,std_event_ring_t*>::iterator it = client_rings.find(handle);
+        if (it!=client_rings.end()) {
+            std_event_ring_free(it->second);
+            client_rings.erase(it);
+            __atomic_sub_fetch(&client_ring_count,1,__ATOMIC_RELAXED);
+        }
+    }
+    close(handle);
     return STD_ERR_OK;
 }
 
@@ -502,8 +1075,16 @@ struct event_msg_buff_t {
     std::vector<uint8_t> buff;
     bool limit_max;
     size_t max_len;
+    /* bytes read from the socket by std_client_wait_for_events that haven't
+     * been returned yet */
+    std::vector<uint8_t> stream;
+    size_t start;
+    size_t end;
+    size_t need;
 };
 
+#define EV_MSG_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
 std_event_msg_buff_t std_client_allocate_msg_buff(unsigned int buffer_space, bool limit_max) {
     event_msg_buff_t *p = new event_msg_buff_t;
     if (p==NULL) return NULL;
@@ -516,6 +1097,9 @@ std_event_msg_buff_t std_client_allocate_msg_buff(unsigned int buffer_space, boo
     }
     p->limit_max = limit_max;
     p->max_len = buffer_space;
+    p->start = 0;
+    p->end = 0;
+    p->need = 0;
     return p;
 }
 
@@ -524,8 +1108,16 @@ std_event_msg_buff_t std_client_allocate_msg_buff(unsigned int buffer_space, boo
  * @param msg to free
  */
 void std_client_free_msg_buff(std_event_msg_buff_t *buff) {
-    event_msg_buff_t *p = (event_msg_buff_t*)buff;
+    event_msg_buff_t *p = (event_msg_buff_t*)*buff;
     delete p;
+    *buff = NULL;
+}
+
+/* a ring reply that arrived after std_server_client_connect_shm stopped waiting */
+static bool client_ring_reply(std::vector<uint8_t> &buff) {
+    if (buff.size()<sizeof(event_serv_msg_t)) return false;
+    event_serv_msg_t *m = (event_serv_msg_t*) vector_offset(buff,0);
+    return m->op == event_serv_msg_t_SHM_RING;
 }
 
 std_event_msg_t * std_event_msg_from_buff(std_event_msg_buff_t buff) {
@@ -538,14 +1130,48 @@ std_event_msg_t * std_event_msg_from_buff(std_event_msg_buff_t buff) {
 
 t_std_error std_client_wait_for_event_data(std_event_client_handle handle,
         std_event_msg_t *msg, void *buff, size_t len) {
-    return std_event_util_event_recv_msg(handle,msg,buff,len);
+    std_event_ring_t *ring = client_ring(handle);
+    if (ring==NULL) return std_event_util_event_recv_msg(handle,msg,buff,len);
+
+    static thread_local std::vector<uint8_t> rec;
+    bool sock_ready;
+    t_std_error rc = std_event_ring_read(ring,handle,rec,true,&sock_ready);
+    if (rc!=STD_ERR_OK) return rc;
+    if (sock_ready) return std_event_util_event_recv_msg(handle,msg,buff,len);
+
+    if (rec.size() < sizeof(event_serv_msg_t)+sizeof(*msg)) return STD_ERR(COM,FAIL,0);
+    event_serv_msg_t *m = (event_serv_msg_t*)vector_offset(rec,0);
+    if (m->op!=event_serv_msg_t_PUBLISH) return STD_ERR(COM,FAIL,0);
+    memcpy(msg,vector_offset(rec,sizeof(*m)),sizeof(*msg));
+    size_t data_len = msg->data_len;
+    if (data_len > rec.size() - sizeof(*m) - sizeof(*msg)) return STD_ERR(COM,FAIL,0);
+    if (data_len > len) return STD_ERR(COM,TOOBIG,0);
+    if (data_len > 0) memcpy(buff,vector_offset(rec,sizeof(*m)+sizeof(*msg)),data_len);
+    return STD_ERR_OK;
 }
 
 
 t_std_error std_client_wait_for_event(std_event_client_handle handle, std_event_msg_buff_t buff) {
     event_msg_buff_t *p = (event_msg_buff_t*)buff;
 
-    return std_event_util_event_recv(handle,p->buff, !p->limit_max);
+    /* the buffer has been used for a batch receive - finish what it read */
+    if (p->end > p->start) {
+        std_event_msg_t *msg;
+        size_t count;
+        return std_client_wait_for_events(handle,buff,&msg,1,&count);
+    }
+
+    std_event_ring_t *ring = client_ring(handle);
+    for ( ;; ) {
+        t_std_error rc;
+        if (ring!=NULL) {
+            bool sock_ready;
+            rc = std_event_ring_read(ring,handle,p->buff,!p->limit_max,&sock_ready);
+            if (rc!=STD_ERR_OK || !sock_ready) return rc;
+        }
+        rc = std_event_util_event_recv(handle,p->buff, !p->limit_max);
+        if (rc!=STD_ERR_OK || !client_ring_reply(p->buff)) return rc;
+    }
 }
 
 t_std_error std_client_set_receive_buffer(std_event_client_handle handle,
@@ -558,3 +1184,75 @@ t_std_error std_client_set_receive_buffer(std_event_client_handle handle,
     d[0].len = sizeof(len);
     return std_event_util_event_send(handle,&m,d,1,EV_SEND_TIMEOUT);
 }
+
+/* check the message copied to buff at off and add it to the list */
+static t_std_error client_batch_add(event_msg_buff_t *p, size_t &off, size_t len,
+        std_event_msg_t **msgs, size_t *count) {
+    if (len < sizeof(event_serv_msg_t)) return STD_ERR(COM,FAIL,0);
+    event_serv_msg_t *m = (event_serv_msg_t*)vector_offset(p->buff,off);
+    if (m->op != event_serv_msg_t_PUBLISH) return STD_ERR_OK;
+
+    std_event_msg_t *msg = (std_event_msg_t*)vector_offset(p->buff,off+sizeof(*m));
+    if (len < sizeof(*m)+sizeof(*msg) || msg->data_len > len-sizeof(*m)-sizeof(*msg)) {
+        return STD_ERR(COM,FAIL,0);
+    }
+    /* the buffer may still grow so keep the offset until the end */
+    msgs[(*count)++] = (std_event_msg_t*)(uintptr_t)(off+sizeof(*m));
+    off = EV_MSG_ALIGN(off+len);
+    return STD_ERR_OK;
+}
+
+t_std_error std_client_wait_for_events(std_event_client_handle handle, std_event_msg_buff_t buff,
+        std_event_msg_t **msgs, size_t max_msgs, size_t *count) {
+    event_msg_buff_t *p = (event_msg_buff_t*)buff;
+    std_event_ring_t *ring = client_ring(handle);
+    size_t off = 0;
+    t_std_error rc;
+
+    *count = 0;
+    if (max_msgs==0) return STD_ERR(COM,PARAM,0);
+
+    for ( ;; ) {
+        /* what was read from the socket already */
+        while (*count < max_msgs) {
+            uint8_t *payload;
+            size_t len;
+            rc = std_event_util_event_next(p->stream,p->start,p->end,&payload,&len,&p->need);
+            if (rc!=STD_ERR_OK) {
+                if (STD_ERR_EXT_ERRID(rc)==e_std_err_code_NEXIST) break;
+                return rc;
+            }
+            try {
+                if (off+len > p->buff.size()) p->buff.resize(off+len);
+            } catch (...) {
+                return STD_ERR(COM,NOMEM,0);
+            }
+            if (len > 0) memcpy(vector_offset(p->buff,off),payload,len);
+            if ((rc=client_batch_add(p,off,len,msgs,count))!=STD_ERR_OK) return rc;
+        }
+
+        while (ring!=NULL && *count < max_msgs) {
+            size_t len;
+            rc = std_event_ring_take(ring,p->buff,off,true,&len);
+            if (rc!=STD_ERR_OK) {
+                if (STD_ERR_EXT_ERRID(rc)==e_std_err_code_NEXIST) break;
+                return rc;
+            }
+            if ((rc=client_batch_add(p,off,len,msgs,count))!=STD_ERR_OK) return rc;
+        }
+        if (*count > 0) break;
+
+        if (ring!=NULL) {
+            bool sock_ready;
+            if ((rc=std_event_ring_wait(ring,handle,&sock_ready))!=STD_ERR_OK) return rc;
+            if (!sock_ready) continue;
+        }
+        rc = std_event_util_event_fill(handle,p->stream,p->start,p->end,p->need);
+        if (rc!=STD_ERR_OK) return rc;
+    }
+
+    for (size_t ix = 0; ix < *count ; ++ix) {
+        msgs[ix] = (std_event_msg_t*)vector_offset(p->buff,(uintptr_t)msgs[ix]);
+    }
+    return STD_ERR_OK;
+}
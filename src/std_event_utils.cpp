@@ -29,24 +29,21 @@
 #include "std_file_utils.h"
 #include "std_socket_tools.h"
 
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 #define STD_ERR_RC(type,x) STD_ERR_MK(e_std_err_COM,e_std_err_code_##type,(x))
 
 #define STD_CMN_IPC_VER 1
 
-struct std_event_ipc_hdr_t {
-    uint32_t size;
-    uint32_t version;
-};
-
-struct std_event_ipc_data_t {
-    std_event_ipc_hdr_t hdr;
-    uint32_t version;
-    uint32_t size;
-};
+/* smallest buffer std_event_util_event_fill reads into */
+#define STD_EVENT_STREAM_MIN (16*1024)
 
 t_std_error std_event_util_event_send(std_event_client_handle handle,
         event_serv_msg_t *msg, std_event_msg_descr_t *data, size_t len, size_t timeout) {
@@ -129,12 +126,23 @@ t_std_error std_event_util_event_recv_msg(std_event_client_handle handle,
     t_std_error rc = STD_ERR_OK;
     std_event_ipc_data_t hdr;
 
-    if (!read_header(handle,hdr)) return STD_ERR(COM,FAIL,0);
     event_serv_msg_t mtype;
-    if (hdr.size < (sizeof(event_serv_msg_t) + sizeof(*msg))) return STD_ERR(COM,FAIL,0);
+    int by;
+    for ( ;; ) {
+        if (!read_header(handle,hdr)) return STD_ERR(COM,FAIL,0);
+        if (hdr.size < sizeof(event_serv_msg_t)) return STD_ERR(COM,FAIL,0);
 
-    int by = std_read(handle,&mtype,sizeof(mtype),true,&rc);
-    if (by!=sizeof(mtype)) return STD_ERR_RC(CLOSED,handle);
+        by = std_read(handle,&mtype,sizeof(mtype),true,&rc);
+        if (by!=sizeof(mtype)) return STD_ERR_RC(CLOSED,handle);
+        if (mtype.op!=event_serv_msg_t_SHM_RING) break;
+
+        /* a ring reply the client stopped waiting for - skip it */
+        uint64_t size;
+        if (hdr.size!=sizeof(mtype)+sizeof(size)) return STD_ERR(COM,FAIL,0);
+        by = std_read(handle,&size,sizeof(size),true,&rc);
+        if (by!=sizeof(size)) return STD_ERR_RC(CLOSED,handle);
+    }
+    if (hdr.size < (sizeof(event_serv_msg_t) + sizeof(*msg))) return STD_ERR(COM,FAIL,0);
 
     if (mtype.op!=event_serv_msg_t_PUBLISH) return STD_ERR(COM,FAIL,0);
     hdr.size -= sizeof(mtype);
@@ -151,3 +159,108 @@ t_std_error std_event_util_event_recv_msg(std_event_client_handle handle,
 
     return STD_ERR_OK;
 }
+
+t_std_error std_event_util_event_frame(std::vector<uint8_t> &out,
+        event_serv_msg_t *msg, std_event_msg_descr_t *data, size_t len) {
+    std_event_ipc_data_t hdr;
+
+    hdr.hdr.version = STD_CMN_IPC_VER;
+    hdr.hdr.size = sizeof(std_event_ipc_data_t)-sizeof(std_event_ipc_hdr_t);
+    hdr.version = 0;
+    hdr.size = sizeof(*msg);
+    for (size_t ix = 0 ; ix < len ; ++ix ) {
+        hdr.size += data[ix].len;
+    }
+
+    size_t pos = out.size();
+    try {
+        out.resize(pos + sizeof(hdr) + hdr.size);
+    } catch (...) {
+        return STD_ERR(COM,NOMEM,0);
+    }
+    uint8_t *p = &out[pos];
+    memcpy(p,&hdr,sizeof(hdr));
+    p += sizeof(hdr);
+    memcpy(p,msg,sizeof(*msg));
+    p += sizeof(*msg);
+    for (size_t ix = 0 ; ix < len ; ++ix ) {
+        memcpy(p,data[ix].data,data[ix].len);
+        p += data[ix].len;
+    }
+    return STD_ERR_OK;
+}
+
+t_std_error std_event_util_write(std_event_client_handle handle, const void *data,
+        size_t len, size_t timeout) {
+    t_std_error rc = STD_ERR_OK;
+    struct iovec iov;
+    iov.iov_base = (void*)data;
+    iov.iov_len = len;
+
+    std_socket_msg_t _pkt;
+    memset(&_pkt,0,sizeof(_pkt));
+    _pkt.msg_iov = &iov;
+    _pkt.msg_iovlen = 1;
+
+    std_socket_op(std_socket_transit_o_WRITE,handle,&_pkt,
+            (std_socket_transit_flags_t)(std_socket_transit_f_NONBLOCK|
+                    std_socket_transit_f_ALL),timeout,&rc);
+    return rc;
+}
+
+t_std_error std_event_util_event_next(std::vector<uint8_t> &stream, size_t &start,
+        size_t end, uint8_t **payload, size_t *len, size_t *need) {
+    std_event_ipc_data_t hdr;
+    size_t avail = end - start;
+
+    *need = sizeof(hdr.hdr);
+    if (avail < sizeof(hdr.hdr)) return STD_ERR(COM,NEXIST,0);
+    memcpy(&hdr.hdr,&stream[start],sizeof(hdr.hdr));
+    if (hdr.hdr.size > (sizeof(std_event_ipc_data_t)-sizeof(hdr.hdr))) {
+        return STD_ERR(COM,FAIL,0);
+    }
+
+    size_t hdr_len = sizeof(hdr.hdr) + hdr.hdr.size;
+    *need = hdr_len;
+    if (avail < hdr_len) return STD_ERR(COM,NEXIST,0);
+    memcpy(&hdr,&stream[start],hdr_len);
+
+    *need = hdr_len + hdr.size;
+    if (avail < *need) return STD_ERR(COM,NEXIST,0);
+
+    *payload = &stream[start + hdr_len];
+    *len = hdr.size;
+    start += *need;
+    return STD_ERR_OK;
+}
+
+t_std_error std_event_util_event_fill(std_event_client_handle handle,
+        std::vector<uint8_t> &stream, size_t &start, size_t &end, size_t need) {
+    if (start > 0) {
+        memmove(&stream[0],&stream[start],end - start);
+        end -= start;
+        start = 0;
+    }
+    if (stream.size() < need || stream.size() == end) {
+        try {
+            stream.resize(std::max(need,std::max((size_t)STD_EVENT_STREAM_MIN,stream.size()*2)));
+        } catch (...) {
+            return STD_ERR_RC(TOOBIG,need);
+        }
+    }
+
+    struct pollfd pfd;
+    pfd.fd = handle;
+    pfd.events = POLLIN;
+    for ( ;; ) {
+        int rc = poll(&pfd,1,-1);
+        if (rc<0 && errno!=EINTR) return STD_ERR(COM,FAIL,errno);
+        if (rc<=0) continue;
+
+        ssize_t by = read(handle,&stream[end],stream.size() - end);
+        if (by<0 && (errno==EINTR || errno==EAGAIN)) continue;
+        if (by<=0) return STD_ERR_RC(CLOSED,handle);
+        end += by;
+        return STD_ERR_OK;
+    }
+}
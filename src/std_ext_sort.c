@@ -0,0 +1,561 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_ext_sort.c
+ */
+
+/*!
+ * \file   std_ext_sort.c
+ * \brief  Stable external merge sort of fixed size records within a memory budget
+ */
+
+#include "std_ext_sort.h"
+#include "std_file_utils.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+/* Preferred minimum read buffer per run while merging */
+#define STD_EXT_SORT_MIN_BUF        (64*1024)
+/* Records the in memory run starts with - it doubles up to the budget */
+#define STD_EXT_SORT_INITIAL_RECS   (1024)
+/* Largest single write - std_write takes an int length */
+#define STD_EXT_SORT_MAX_IO         (1<<30)
+
+#define STD_EXT_SORT_ERRNO STD_ERR_FROM_ERRNO(e_std_err_COM, e_std_err_code_FAIL)
+
+typedef struct {
+    off_t offset;       //! where the run starts in the run file
+    uint64_t count;     //! records in the run
+} std_ext_sort_run_t;
+
+typedef struct {
+    off_t next;         //! file offset of the first record not yet buffered
+    uint64_t left;      //! records of the run not yet buffered
+    uint8_t *buf;
+    size_t buf_len;     //! records in buf
+    size_t buf_pos;     //! index of the current record in buf
+} std_ext_sort_reader_t;
+
+struct std_ext_sort_s {
+    size_t rec_size;
+    size_t budget;
+    char tmp_dir[256];
+    void *context;
+    std_merge_sort_elem_cmp cmp;
+
+    uint8_t *mem;       //! records not yet spilled
+    size_t mem_count;
+    size_t mem_cap;
+    size_t mem_max;     //! most records held before a spill
+    size_t mem_pos;     //! next record to read when nothing was spilled
+
+    int fd;             //! file holding the runs or -1
+    off_t file_end;
+    std_ext_sort_run_t *runs;
+    size_t num_runs;
+    size_t runs_cap;
+    uint64_t total;
+    bool finished;
+
+    size_t buf_recs_min;    //! smallest read buffer per run in records
+    size_t fan_in;          //! most runs merged at once
+
+    /* merge state */
+    std_ext_sort_reader_t *readers;
+    size_t num_readers;
+    size_t *tree;           //! tree[0] is the winner, the rest are the losers
+    uint8_t *bufs;
+};
+
+static t_std_error std_ext_sort_open_file (std_ext_sort_handle_t h, int *fd)
+{
+    char path[sizeof (h->tmp_dir) + 32];
+
+    snprintf (path, sizeof (path), "%s/std_ext_sort.XXXXXX", h->tmp_dir);
+    *fd = mkstemp (path);
+    if (*fd < 0)
+        return STD_EXT_SORT_ERRNO;
+    /* nothing else needs the name and the space is freed on close */
+    unlink (path);
+    return STD_ERR_OK;
+}
+
+static t_std_error std_ext_sort_write (int fd, const uint8_t *data, size_t len)
+{
+    t_std_error err = STD_ERR_OK;
+
+    while (len > 0)
+    {
+        int chunk = (len > STD_EXT_SORT_MAX_IO) ? STD_EXT_SORT_MAX_IO : (int) len;
+        int rc = std_write (fd, (void *) data, chunk, true, &err);
+        if (rc != chunk)
+            return (err != STD_ERR_OK) ? err : STD_ERR (COM, FAIL, ENOSPC);
+        data += chunk;
+        len -= chunk;
+    }
+    return STD_ERR_OK;
+}
+
+static t_std_error std_ext_sort_pread (int fd, uint8_t *data, size_t len, off_t off)
+{
+    while (len > 0)
+    {
+        ssize_t rc = pread (fd, data, len, off);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0)
+            return STD_EXT_SORT_ERRNO;
+        if (rc == 0)
+            return STD_ERR (COM, FAIL, EIO);
+        data += rc;
+        len -= rc;
+        off += rc;
+    }
+    return STD_ERR_OK;
+}
+
+static t_std_error std_ext_sort_add_run (std_ext_sort_handle_t h, off_t offset,
+                            uint64_t count)
+{
+    if (h->num_runs == h->runs_cap)
+    {
+        size_t cap = (h->runs_cap == 0) ? 16 : h->runs_cap * 2;
+        std_ext_sort_run_t *runs = (std_ext_sort_run_t *)
+                realloc (h->runs, cap * sizeof (*runs));
+        if (runs == NULL)
+            return STD_ERR (COM, NOMEM, 0);
+        h->runs = runs;
+        h->runs_cap = cap;
+    }
+    h->runs[h->num_runs].offset = offset;
+    h->runs[h->num_runs].count = count;
+    h->num_runs++;
+    return STD_ERR_OK;
+}
+
+/*
+ * Sort the records held in memory.  The temp array is the other half of the
+ * budget
+ */
+static t_std_error std_ext_sort_sort_mem (std_ext_sort_handle_t h)
+{
+    void *tmp;
+
+    if (h->mem_count < 2)
+        return STD_ERR_OK;
+    tmp = malloc (h->mem_count * h->rec_size);
+    if (tmp == NULL)
+        return STD_ERR (COM, NOMEM, 0);
+    std_merge_sort_elem (h->context, h->mem, h->mem_count, h->rec_size, tmp, h->cmp);
+    free (tmp);
+    return STD_ERR_OK;
+}
+
+static t_std_error std_ext_sort_spill (std_ext_sort_handle_t h)
+{
+    t_std_error err;
+
+    if (h->mem_count == 0)
+        return STD_ERR_OK;
+    if (h->fd < 0 && (err = std_ext_sort_open_file (h, &h->fd)) != STD_ERR_OK)
+        return err;
+
+    if ((err = std_ext_sort_sort_mem (h)) != STD_ERR_OK ||
+        (err = std_ext_sort_write (h->fd, h->mem, h->mem_count * h->rec_size))
+                != STD_ERR_OK ||
+        (err = std_ext_sort_add_run (h, h->file_end, h->mem_count)) != STD_ERR_OK)
+        return err;
+
+    h->file_end += (off_t) (h->mem_count * h->rec_size);
+    h->mem_count = 0;
+    return STD_ERR_OK;
+}
+
+static inline bool std_ext_sort_exhausted (std_ext_sort_reader_t *r)
+{
+    return r->buf_pos == r->buf_len && r->left == 0;
+}
+
+static inline uint8_t * std_ext_sort_current (std_ext_sort_handle_t h,
+                            std_ext_sort_reader_t *r)
+{
+    return r->buf + r->buf_pos * h->rec_size;
+}
+
+/*
+ * Does run a come before run b.  Exhausted runs sort last and equal records
+ * go to the lower run - the runs were cut in input order so that keeps the
+ * sort stable
+ */
+static inline bool std_ext_sort_less (std_ext_sort_handle_t h, size_t a, size_t b)
+{
+    std_ext_sort_reader_t *ra = &h->readers[a];
+    std_ext_sort_reader_t *rb = &h->readers[b];
+    bool ea = std_ext_sort_exhausted (ra);
+    bool eb = std_ext_sort_exhausted (rb);
+    int rc;
+
+    if (ea || eb)
+        return (ea == eb) ? (a < b) : eb;
+    rc = h->cmp (h->context, std_ext_sort_current (h, ra), std_ext_sort_current (h, rb));
+    return (rc != 0) ? (rc < 0) : (a < b);
+}
+
+static t_std_error std_ext_sort_fill (std_ext_sort_handle_t h,
+                            std_ext_sort_reader_t *r, size_t buf_recs)
+{
+    size_t n = (r->left < buf_recs) ? (size_t) r->left : buf_recs;
+    t_std_error err = std_ext_sort_pread (h->fd, r->buf, n * h->rec_size, r->next);
+
+    if (err != STD_ERR_OK)
+        return err;
+    r->next += (off_t) (n * h->rec_size);
+    r->left -= n;
+    r->buf_len = n;
+    r->buf_pos = 0;
+    return STD_ERR_OK;
+}
+
+/*
+ * Build the loser tree over readers.  Leaves are at k..2k-1 and node n has
+ * children 2n and 2n+1, which works for any k.  Returns the winner of the
+ * subtree at node
+ */
+static size_t std_ext_sort_build (std_ext_sort_handle_t h, size_t node)
+{
+    size_t k = h->num_readers;
+    size_t left, right;
+
+    if (node >= k)
+        return node - k;
+    left = std_ext_sort_build (h, 2 * node);
+    right = std_ext_sort_build (h, 2 * node + 1);
+    if (std_ext_sort_less (h, left, right))
+    {
+        h->tree[node] = right;
+        return left;
+    }
+    h->tree[node] = left;
+    return right;
+}
+
+static void std_ext_sort_merge_close (std_ext_sort_handle_t h)
+{
+    free (h->readers);
+    free (h->tree);
+    free (h->bufs);
+    h->readers = NULL;
+    h->tree = NULL;
+    h->bufs = NULL;
+    h->num_readers = 0;
+}
+
+static t_std_error std_ext_sort_merge_open (std_ext_sort_handle_t h,
+                            std_ext_sort_run_t *runs, size_t k, size_t buf_recs)
+{
+    size_t ix;
+    t_std_error err;
+
+    h->readers = (std_ext_sort_reader_t *) calloc (k, sizeof (*h->readers));
+    h->tree = (size_t *) calloc (k, sizeof (*h->tree));
+    h->bufs = (uint8_t *) malloc (k * buf_recs * h->rec_size);
+    h->num_readers = k;
+    if (h->readers == NULL || h->tree == NULL || h->bufs == NULL)
+    {
+        std_ext_sort_merge_close (h);
+        return STD_ERR (COM, NOMEM, 0);
+    }
+
+    for (ix = 0; ix < k; ix++)
+    {
+        std_ext_sort_reader_t *r = &h->readers[ix];
+        r->next = runs[ix].offset;
+        r->left = runs[ix].count;
+        r->buf = h->bufs + ix * buf_recs * h->rec_size;
+        if ((err = std_ext_sort_fill (h, r, buf_recs)) != STD_ERR_OK)
+        {
+            std_ext_sort_merge_close (h);
+            return err;
+        }
+    }
+    h->tree[0] = std_ext_sort_build (h, 1);
+    return STD_ERR_OK;
+}
+
+/* Copy up to max records out of the merge in order */
+static t_std_error std_ext_sort_merge_pull (std_ext_sort_handle_t h, uint8_t *out,
+                            size_t max, size_t buf_recs, size_t *got)
+{
+    size_t k = h->num_readers;
+    size_t count = 0;
+    t_std_error err = STD_ERR_OK;
+
+    while (count < max)
+    {
+        size_t winner = h->tree[0];
+        std_ext_sort_reader_t *r = &h->readers[winner];
+        size_t node;
+
+        if (std_ext_sort_exhausted (r))
+            break;
+
+        memcpy (out + count * h->rec_size, std_ext_sort_current (h, r), h->rec_size);
+        count++;
+        if (++r->buf_pos == r->buf_len && r->left != 0 &&
+            (err = std_ext_sort_fill (h, r, buf_recs)) != STD_ERR_OK)
+            break;
+
+        /* replay the winner's path - only log2(k) compares */
+        for (node = (winner + k) / 2; node > 0; node /= 2)
+        {
+            if (std_ext_sort_less (h, h->tree[node], winner))
+            {
+                size_t loser = winner;
+                winner = h->tree[node];
+                h->tree[node] = loser;
+            }
+        }
+        h->tree[0] = winner;
+    }
+    *got = count;
+    return err;
+}
+
+/*
+ * Merge groups of fan_in runs into single runs in a new file until the rest
+ * can be merged in one go
+ */
+static t_std_error std_ext_sort_merge_pass (std_ext_sort_handle_t h)
+{
+    size_t buf_recs = (h->budget / h->rec_size) / (h->fan_in + 1);
+    uint8_t *out;
+    int fd;
+    off_t end = 0;
+    size_t ix, new_runs = 0;
+    t_std_error err;
+
+    if ((err = std_ext_sort_open_file (h, &fd)) != STD_ERR_OK)
+        return err;
+    out = (uint8_t *) malloc (buf_recs * h->rec_size);
+    if (out == NULL)
+    {
+        close (fd);
+        return STD_ERR (COM, NOMEM, 0);
+    }
+
+    for (ix = 0; ix < h->num_runs && err == STD_ERR_OK; ix += h->fan_in)
+    {
+        size_t k = h->num_runs - ix;
+        uint64_t count = 0;
+        size_t got;
+
+        if (k > h->fan_in)
+            k = h->fan_in;
+        if ((err = std_ext_sort_merge_open (h, &h->runs[ix], k, buf_recs)) != STD_ERR_OK)
+            break;
+        do {
+            err = std_ext_sort_merge_pull (h, out, buf_recs, buf_recs, &got);
+            if (err == STD_ERR_OK && got > 0)
+                err = std_ext_sort_write (fd, out, got * h->rec_size);
+            count += got;
+        } while (err == STD_ERR_OK && got > 0);
+        std_ext_sort_merge_close (h);
+
+        /* the merged runs are behind ix so the slot is free to reuse */
+        h->runs[new_runs].offset = end;
+        h->runs[new_runs].count = count;
+        new_runs++;
+        end += (off_t) (count * h->rec_size);
+    }
+    free (out);
+
+    if (err != STD_ERR_OK)
+    {
+        close (fd);
+        return err;
+    }
+    close (h->fd);
+    h->fd = fd;
+    h->file_end = end;
+    h->num_runs = new_runs;
+    return STD_ERR_OK;
+}
+
+t_std_error std_ext_sort_create (std_ext_sort_handle_t *handle, size_t recordSize,
+             size_t memBudget, const char *tmpDir, void *context,
+             std_merge_sort_elem_cmp cmp)
+{
+    std_ext_sort_handle_t h;
+    size_t budget_recs;
+
+    if (handle == NULL || recordSize == 0 || cmp == NULL ||
+        memBudget / recordSize < 4)
+        return STD_ERR (COM, PARAM, 0);
+
+    h = (std_ext_sort_handle_t) calloc (1, sizeof (*h));
+    if (h == NULL)
+        return STD_ERR (COM, NOMEM, 0);
+
+    if (tmpDir == NULL)
+        tmpDir = getenv ("TMPDIR");
+    if (tmpDir == NULL || *tmpDir == '\0')
+        tmpDir = "/tmp";
+    snprintf (h->tmp_dir, sizeof (h->tmp_dir), "%s", tmpDir);
+
+    h->rec_size = recordSize;
+    h->budget = memBudget;
+    h->context = context;
+    h->cmp = cmp;
+    h->fd = -1;
+
+    /* half for the run and half for the sort's temp array */
+    budget_recs = memBudget / recordSize;
+    h->mem_max = budget_recs / 2;
+
+    /*
+     * Merging needs a read buffer per run plus an output buffer.  Small
+     * buffers mean more seeks so cap the fan in to keep them at a reasonable
+     * size and do extra merge passes instead
+     */
+    h->buf_recs_min = STD_EXT_SORT_MIN_BUF / recordSize;
+    if (h->buf_recs_min * 3 > budget_recs)
+        h->buf_recs_min = budget_recs / 3;
+    if (h->buf_recs_min == 0)
+        h->buf_recs_min = 1;
+    h->fan_in = budget_recs / h->buf_recs_min - 1;
+    if (h->fan_in < 2)
+        h->fan_in = 2;
+
+    *handle = h;
+    return STD_ERR_OK;
+}
+
+t_std_error std_ext_sort_add (std_ext_sort_handle_t h, const void *records,
+             size_t numRecords)
+{
+    const uint8_t *src = (const uint8_t *) records;
+    t_std_error err;
+
+    if (h->finished)
+        return STD_ERR (COM, PARAM, 0);
+
+    while (numRecords > 0)
+    {
+        size_t n;
+
+        if (h->mem_count == h->mem_max &&
+            (err = std_ext_sort_spill (h)) != STD_ERR_OK)
+            return err;
+
+        if (h->mem_count == h->mem_cap)
+        {
+            size_t cap = (h->mem_cap == 0) ? STD_EXT_SORT_INITIAL_RECS : h->mem_cap * 2;
+            uint8_t *mem;
+            if (cap > h->mem_max)
+                cap = h->mem_max;
+            mem = (uint8_t *) realloc (h->mem, cap * h->rec_size);
+            if (mem == NULL)
+                return STD_ERR (COM, NOMEM, 0);
+            h->mem = mem;
+            h->mem_cap = cap;
+        }
+
+        n = h->mem_cap - h->mem_count;
+        if (n > numRecords)
+            n = numRecords;
+        memcpy (h->mem + h->mem_count * h->rec_size, src, n * h->rec_size);
+        h->mem_count += n;
+        h->total += n;
+        src += n * h->rec_size;
+        numRecords -= n;
+    }
+    return STD_ERR_OK;
+}
+
+t_std_error std_ext_sort_finish (std_ext_sort_handle_t h)
+{
+    t_std_error err;
+
+    if (h->finished)
+        return STD_ERR (COM, PARAM, 0);
+    h->finished = true;
+
+    if (h->num_runs == 0)
+        return std_ext_sort_sort_mem (h);
+
+    if ((err = std_ext_sort_spill (h)) != STD_ERR_OK)
+        return err;
+    free (h->mem);
+    h->mem = NULL;
+    h->mem_cap = 0;
+
+    while (h->num_runs > h->fan_in)
+    {
+        if ((err = std_ext_sort_merge_pass (h)) != STD_ERR_OK)
+            return err;
+    }
+    /* the caller's array is the output buffer so the runs get all the budget */
+    return std_ext_sort_merge_open (h, h->runs, h->num_runs,
+                                    (h->budget / h->rec_size) / h->num_runs);
+}
+
+t_std_error std_ext_sort_read (std_ext_sort_handle_t h, void *records,
+             size_t maxRecords, size_t *numRead)
+{
+    *numRead = 0;
+    if (!h->finished)
+        return STD_ERR (COM, PARAM, 0);
+
+    if (h->num_runs == 0)
+    {
+        size_t n = h->mem_count - h->mem_pos;
+        if (n > maxRecords)
+            n = maxRecords;
+        memcpy (records, h->mem + h->mem_pos * h->rec_size, n * h->rec_size);
+        h->mem_pos += n;
+        *numRead = n;
+        return STD_ERR_OK;
+    }
+    if (h->num_readers == 0)
+        return STD_ERR_OK;
+    return std_ext_sort_merge_pull (h, (uint8_t *) records, maxRecords,
+                                    (h->budget / h->rec_size) / h->num_runs, numRead);
+}
+
+size_t std_ext_sort_count (std_ext_sort_handle_t h)
+{
+    return h->total;
+}
+
+void std_ext_sort_destroy (std_ext_sort_handle_t h)
+{
+    if (h == NULL)
+        return;
+    std_ext_sort_merge_close (h);
+    if (h->fd >= 0)
+        close (h->fd);
+    free (h->mem);
+    free (h->runs);
+    free (h);
+}
@@ -0,0 +1,510 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_hash.c
+ */
+
+/*!
+ * \file   std_hash.c
+ * \brief  Open addressing (Swiss table style) hash index.
+ */
+
+
+/*---------------------------------------------------------------*\
+ *                    Includes.
+\*---------------------------------------------------------------*/
+
+#include "std_hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+/*---------------------------------------------------------------*\
+ *                    Defines and Macros.
+\*---------------------------------------------------------------*/
+
+#define HASH_MAGIC          0x4a5b6c7d
+#define HASH_ASSERT         assert
+
+/// Number of slots in a group - matches the width of an SSE2 register
+#define HASH_GROUP_WIDTH    16
+
+/// Number of groups of the old table moved to the new table per insert/remove
+#define HASH_MIGRATE_GROUPS 2
+
+/// Default number of entries a table is sized for
+#define HASH_DEFAULT_SIZE   64
+
+/// Control byte values. Full slots hold the low 7 bits of the hash
+#define HASH_CTRL_EMPTY     ((int8_t)-128)
+#define HASH_CTRL_DELETED   ((int8_t)-2)
+
+#define HASH_H1(hash)       ((hash) >> 7)
+#define HASH_H2(hash)       ((int8_t)((hash) & 0x7f))
+
+#define HASH_VALIDATE_HANDLE(h) \
+            HASH_ASSERT(h); \
+            HASH_ASSERT((h)->magic == HASH_MAGIC);
+
+
+/*---------------------------------------------------------------*\
+ *                    Data structures.
+\*---------------------------------------------------------------*/
+
+/**
+ * One set of control bytes and slots.  A table has one of these normally and
+ * two while it is being resized.
+ */
+typedef struct {
+    size_t ngroups;         //! number of groups - always a power of 2 (0 if unused)
+    size_t size;            //! number of user nodes in the array
+    size_t growth_left;     //! number of empty slots that can be used before growing
+    int8_t *ctrl;           //! ngroups * HASH_GROUP_WIDTH control bytes
+    void **slots;           //! ngroups * HASH_GROUP_WIDTH user node pointers
+} std_hash_array_t;
+
+struct _std_hash_table {
+    u_long magic;
+    char name[STD_HASH_NAME_MAX_LEN+1];
+
+    int keyoffset;
+    int keylength;
+
+    std_hash_array_t cur;   //! the table all inserts go into
+    std_hash_array_t old;   //! the table being drained during a resize
+    size_t migrate_pos;     //! next group of old to move into cur
+};
+
+
+/*---------------------------------------------------------------*\
+ *            Private methods
+\*---------------------------------------------------------------*/
+
+static inline uint64_t std_hash_fmix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline const void * std_hash_key(const std_hash_handle h, const void *data)
+{
+    return ((const char *)data) + h->keyoffset;
+}
+
+static inline uint64_t std_hash_node_hash(const std_hash_handle h, const void *data)
+{
+    return std_hash_bytes(std_hash_key(h, data), h->keylength);
+}
+
+static inline int std_hash_key_equal(const std_hash_handle h, const void *lhs,
+                                     const void *rhs)
+{
+    return memcmp(std_hash_key(h, lhs), std_hash_key(h, rhs), h->keylength) == 0;
+}
+
+/*
+ * Group matching - each returns a bit mask with bit i set if slot i of
+ * the group matches
+ */
+#if defined(__SSE2__)
+
+static inline uint32_t std_hash_group_match(const int8_t *ctrl, int8_t h2)
+{
+    __m128i g = _mm_load_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), g));
+}
+
+static inline uint32_t std_hash_group_match_empty(const int8_t *ctrl)
+{
+    return std_hash_group_match(ctrl, HASH_CTRL_EMPTY);
+}
+
+static inline uint32_t std_hash_group_match_free(const int8_t *ctrl)
+{
+    /* empty and deleted are the only control bytes with the sign bit set */
+    __m128i g = _mm_load_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(g);
+}
+
+#else
+
+static inline uint32_t std_hash_group_match(const int8_t *ctrl, int8_t h2)
+{
+    uint32_t mask = 0;
+    size_t ix = 0;
+    for ( ; ix < HASH_GROUP_WIDTH ; ++ix ) {
+        if (ctrl[ix] == h2) mask |= (1U << ix);
+    }
+    return mask;
+}
+
+static inline uint32_t std_hash_group_match_empty(const int8_t *ctrl)
+{
+    return std_hash_group_match(ctrl, HASH_CTRL_EMPTY);
+}
+
+static inline uint32_t std_hash_group_match_free(const int8_t *ctrl)
+{
+    uint32_t mask = 0;
+    size_t ix = 0;
+    for ( ; ix < HASH_GROUP_WIDTH ; ++ix ) {
+        if (ctrl[ix] < 0) mask |= (1U << ix);
+    }
+    return mask;
+}
+
+#endif
+
+static size_t std_hash_capacity_to_growth(size_t ngroups)
+{
+    /* keep the load at or under 7/8 */
+    size_t cap = ngroups * HASH_GROUP_WIDTH;
+    return cap - cap / 8;
+}
+
+static size_t std_hash_ngroups_for(size_t entries)
+{
+    size_t ngroups = 1;
+    while (std_hash_capacity_to_growth(ngroups) < entries)
+        ngroups <<= 1;
+    return ngroups;
+}
+
+static bool std_hash_array_alloc(std_hash_array_t *a, size_t ngroups)
+{
+    size_t nslots = ngroups * HASH_GROUP_WIDTH;
+    void *mem = NULL;
+
+    /* control bytes first followed by the slots - one allocation */
+    if (posix_memalign(&mem, HASH_GROUP_WIDTH, nslots + nslots * sizeof(void *)) != 0)
+        return false;
+
+    a->ngroups = ngroups;
+    a->size = 0;
+    a->growth_left = std_hash_capacity_to_growth(ngroups);
+    a->ctrl = (int8_t *)mem;
+    a->slots = (void **)(a->ctrl + nslots);
+    memset(a->ctrl, HASH_CTRL_EMPTY, nslots);
+    return true;
+}
+
+static void std_hash_array_free(std_hash_array_t *a)
+{
+    free(a->ctrl);
+    memset(a, 0, sizeof(*a));
+}
+
+/*
+ * Returns the slot index of the node matching data or -1 if not found
+ */
+static ssize_t std_hash_array_find(std_hash_handle h, const std_hash_array_t *a,
+                                   const void *data, uint64_t hash)
+{
+    size_t mask, group, step = 0;
+    int8_t h2 = HASH_H2(hash);
+
+    if (a->ngroups == 0)
+        return -1;
+
+    mask = a->ngroups - 1;
+    group = HASH_H1(hash) & mask;
+
+    while (true) {
+        const int8_t *ctrl = a->ctrl + group * HASH_GROUP_WIDTH;
+        uint32_t match = std_hash_group_match(ctrl, h2);
+
+        while (match != 0) {
+            size_t slot = group * HASH_GROUP_WIDTH + __builtin_ctz(match);
+            if (std_hash_key_equal(h, a->slots[slot], data))
+                return (ssize_t)slot;
+            match &= match - 1;
+        }
+        if (std_hash_group_match_empty(ctrl) != 0)
+            return -1;
+
+        /* triangular probing visits every group when ngroups is a power of 2 */
+        ++step;
+        group = (group + step) & mask;
+        if (step > mask)
+            return -1;
+    }
+}
+
+/*
+ * Insert a node that is known not to be in the array.  The caller has
+ * ensured that there is growth left
+ */
+static void std_hash_array_insert(std_hash_array_t *a, void *data, uint64_t hash)
+{
+    size_t mask = a->ngroups - 1;
+    size_t group = HASH_H1(hash) & mask;
+    size_t step = 0;
+
+    while (true) {
+        int8_t *ctrl = a->ctrl + group * HASH_GROUP_WIDTH;
+        uint32_t free_slots = std_hash_group_match_free(ctrl);
+
+        if (free_slots != 0) {
+            size_t ix = __builtin_ctz(free_slots);
+            if (ctrl[ix] == HASH_CTRL_EMPTY) {
+                HASH_ASSERT(a->growth_left > 0);
+                --a->growth_left;
+            }
+            ctrl[ix] = HASH_H2(hash);
+            a->slots[group * HASH_GROUP_WIDTH + ix] = data;
+            ++a->size;
+            return;
+        }
+        ++step;
+        group = (group + step) & mask;
+    }
+}
+
+static void std_hash_array_erase(std_hash_array_t *a, size_t slot)
+{
+    int8_t *group = a->ctrl + (slot & ~(size_t)(HASH_GROUP_WIDTH - 1));
+
+    /*
+     * If the group still has an empty slot no probe sequence has ever
+     * continued past it, so the slot can go straight back to empty
+     */
+    if (std_hash_group_match_empty(group) != 0) {
+        a->ctrl[slot] = HASH_CTRL_EMPTY;
+        ++a->growth_left;
+    } else {
+        a->ctrl[slot] = HASH_CTRL_DELETED;
+    }
+    --a->size;
+}
+
+/*
+ * Move up to count groups from the old array into the current array
+ */
+static void std_hash_migrate(std_hash_handle h, size_t count)
+{
+    std_hash_array_t *old = &h->old;
+
+    while (old->ngroups != 0 && count-- > 0) {
+        size_t base = h->migrate_pos * HASH_GROUP_WIDTH;
+        size_t ix = 0;
+        for ( ; ix < HASH_GROUP_WIDTH ; ++ix ) {
+            if (old->ctrl[base + ix] < 0) continue;
+            void *data = old->slots[base + ix];
+            std_hash_array_insert(&h->cur, data, std_hash_node_hash(h, data));
+            /* other keys may still probe through this group so leave a tombstone */
+            old->ctrl[base + ix] = HASH_CTRL_DELETED;
+            --old->size;
+        }
+        if (++h->migrate_pos == old->ngroups) {
+            std_hash_array_free(old);
+            h->migrate_pos = 0;
+        }
+    }
+}
+
+static bool std_hash_start_resize(std_hash_handle h)
+{
+    std_hash_array_t next;
+    size_t needed;
+
+    /* only one resize at a time - finish the previous one first */
+    if (h->old.ngroups != 0)
+        std_hash_migrate(h, h->old.ngroups);
+
+    /*
+     * Leave room for everything in the table plus the inserts that can happen
+     * before the old groups are fully migrated.  Sizing off the live count
+     * rather than the capacity means a table full of tombstones is rebuilt at
+     * the same (or smaller) size instead of growing
+     */
+    needed = h->cur.size * 2;
+    if (needed < h->cur.size + h->cur.ngroups)
+        needed = h->cur.size + h->cur.ngroups;
+    if (!std_hash_array_alloc(&next, std_hash_ngroups_for(needed + 1)))
+        return false;
+
+    h->old = h->cur;
+    h->cur = next;
+    h->migrate_pos = 0;
+    std_hash_migrate(h, HASH_MIGRATE_GROUPS);
+    return true;
+}
+
+
+/*---------------------------------------------------------------*\
+ *            Public methods
+\*---------------------------------------------------------------*/
+
+uint64_t std_hash_bytes(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (len * 0xc6a4a7935bd1e995ULL);
+    uint64_t v;
+
+    while (len >= sizeof(v)) {
+        memcpy(&v, p, sizeof(v));
+        h = (h ^ std_hash_fmix64(v)) * 0x9e3779b97f4a7c15ULL;
+        p += sizeof(v);
+        len -= sizeof(v);
+    }
+    if (len > 0) {
+        v = 0;
+        memcpy(&v, p, len);
+        h = (h ^ std_hash_fmix64(v)) * 0x9e3779b97f4a7c15ULL;
+    }
+    return std_hash_fmix64(h);
+}
+
+std_hash_handle std_hash_create(const char *name, int keyoffset, int keylength,
+                                size_t initial_size)
+{
+    std_hash_handle h;
+
+    HASH_ASSERT(name);
+    if (keylength <= 0 || keyoffset < 0)
+        return NULL;
+
+    if ((h = (std_hash_handle)calloc(1, sizeof(*h))) == NULL)
+        return NULL;
+
+    if (!std_hash_array_alloc(&h->cur, std_hash_ngroups_for(initial_size))) {
+        free(h);
+        return NULL;
+    }
+
+    h->magic = HASH_MAGIC;
+    strncpy(h->name, name, STD_HASH_NAME_MAX_LEN);
+    h->name[STD_HASH_NAME_MAX_LEN] = '\0';
+    h->keyoffset = keyoffset;
+    h->keylength = keylength;
+    return h;
+}
+
+std_hash_handle std_hash_create_simple(const char *name, int keyoffset, int keylength)
+{
+    return std_hash_create(name, keyoffset, keylength, HASH_DEFAULT_SIZE);
+}
+
+void std_hash_destroy(std_hash_handle h)
+{
+    HASH_VALIDATE_HANDLE(h);
+
+    std_hash_array_free(&h->cur);
+    std_hash_array_free(&h->old);
+    h->magic = 0;
+    free(h);
+}
+
+t_std_error std_hash_insert(std_hash_handle h, void *data)
+{
+    uint64_t hash;
+
+    HASH_VALIDATE_HANDLE(h);
+    HASH_ASSERT(data);
+
+    hash = std_hash_node_hash(h, data);
+    if (std_hash_array_find(h, &h->cur, data, hash) >= 0 ||
+        std_hash_array_find(h, &h->old, data, hash) >= 0)
+        return STD_ERR(COM, PARAM, 0);
+
+    if (h->cur.growth_left == 0) {
+        if (!std_hash_start_resize(h))
+            return STD_ERR(COM, NOMEM, 0);
+    } else {
+        std_hash_migrate(h, HASH_MIGRATE_GROUPS);
+    }
+
+    std_hash_array_insert(&h->cur, data, hash);
+    return STD_ERR_OK;
+}
+
+void * std_hash_getexact(std_hash_handle h, const void *data)
+{
+    uint64_t hash;
+    ssize_t slot;
+
+    HASH_VALIDATE_HANDLE(h);
+    HASH_ASSERT(data);
+
+    hash = std_hash_node_hash(h, data);
+    if ((slot = std_hash_array_find(h, &h->cur, data, hash)) >= 0)
+        return h->cur.slots[slot];
+    if ((slot = std_hash_array_find(h, &h->old, data, hash)) >= 0)
+        return h->old.slots[slot];
+    return NULL;
+}
+
+void * std_hash_remove(std_hash_handle h, const void *data)
+{
+    uint64_t hash;
+    ssize_t slot;
+    void *found = NULL;
+
+    HASH_VALIDATE_HANDLE(h);
+    HASH_ASSERT(data);
+
+    hash = std_hash_node_hash(h, data);
+    if ((slot = std_hash_array_find(h, &h->cur, data, hash)) >= 0) {
+        found = h->cur.slots[slot];
+        std_hash_array_erase(&h->cur, slot);
+    } else if ((slot = std_hash_array_find(h, &h->old, data, hash)) >= 0) {
+        found = h->old.slots[slot];
+        std_hash_array_erase(&h->old, slot);
+    }
+
+    std_hash_migrate(h, HASH_MIGRATE_GROUPS);
+    return found;
+}
+
+size_t std_hash_count(std_hash_handle h)
+{
+    HASH_VALIDATE_HANDLE(h);
+    return h->cur.size + h->old.size;
+}
+
+void * std_hash_walk(std_hash_handle h, std_hash_walk_cb cb, void *context)
+{
+    const std_hash_array_t *arrays[2];
+    size_t ix, slot;
+
+    HASH_VALIDATE_HANDLE(h);
+    HASH_ASSERT(cb);
+
+    arrays[0] = &h->cur;
+    arrays[1] = &h->old;
+    for (ix = 0; ix < 2; ++ix) {
+        const std_hash_array_t *a = arrays[ix];
+        size_t nslots = a->ngroups * HASH_GROUP_WIDTH;
+        for (slot = 0; slot < nslots; ++slot) {
+            if (a->ctrl[slot] < 0) continue;
+            if (cb(context, a->slots[slot]) != 0)
+                return a->slots[slot];
+        }
+    }
+    return NULL;
+}
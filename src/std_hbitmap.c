@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_hbitmap.c
+ */
+
+/*!
+ * \file   std_hbitmap.c
+ * \brief  Bitmap with summary levels for fast searches for set or clear bits
+ */
+
+#include "std_hbitmap.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STD_HBITMAP_WORD_BITS   64
+/* enough summary levels for INT_MAX bits */
+#define STD_HBITMAP_MAX_LEVELS  6
+
+/*
+ * Level 0 is the bits themselves.  Level l (1..levels) has a word per 64
+ * words of level l-1.  The bits past len and the summary bits for words that
+ * don't exist are always zero - a search that lands on them means there was
+ * nothing to find before the end
+ */
+struct std_hbitmap_s {
+    size_t len;
+    unsigned int levels;                            //! number of summary levels
+    size_t words[STD_HBITMAP_MAX_LEVELS+1];         //! words on each level
+    uint64_t *bits;
+    uint64_t *any_set[STD_HBITMAP_MAX_LEVELS+1];    //! [l] bit set if the word below has a 1
+    uint64_t *any_clr[STD_HBITMAP_MAX_LEVELS+1];    //! [l] bit set if the word below has a 0
+};
+
+static inline size_t std_hbitmap_words(size_t bits) {
+    return (bits + STD_HBITMAP_WORD_BITS - 1) / STD_HBITMAP_WORD_BITS;
+}
+
+static inline uint64_t std_hbitmap_bit(size_t ix) {
+    return 1ULL << (ix % STD_HBITMAP_WORD_BITS);
+}
+
+/* the value of the mask that has to be in a full word of level 0 */
+static inline uint64_t std_hbitmap_full(const std_hbitmap_t *bm, size_t word) {
+    size_t extra = bm->len % STD_HBITMAP_WORD_BITS;
+    if (word == bm->words[0] - 1 && extra != 0) return (1ULL << extra) - 1;
+    return ~0ULL;
+}
+
+std_hbitmap_t * std_hbitmap_create(size_t len, bool set) {
+    std_hbitmap_t *bm;
+    size_t total = 0;
+    size_t ix;
+    unsigned int l;
+    uint64_t *p;
+
+    if (len == 0 || len > INT_MAX) return NULL;
+
+    bm = (std_hbitmap_t *)calloc(1, sizeof(*bm));
+    if (bm == NULL) return NULL;
+    bm->len = len;
+
+    bm->words[0] = std_hbitmap_words(len);
+    total = bm->words[0];
+    for (l = 0; bm->words[l] > 1; ++l) {
+        bm->words[l+1] = std_hbitmap_words(bm->words[l]);
+        total += 2 * bm->words[l+1];
+    }
+    bm->levels = l;
+
+    p = (uint64_t *)calloc(total, sizeof(uint64_t));
+    if (p == NULL) {
+        free(bm);
+        return NULL;
+    }
+    bm->bits = p;
+    p += bm->words[0];
+    for (l = 1; l <= bm->levels; ++l) {
+        bm->any_set[l] = p;
+        p += bm->words[l];
+        bm->any_clr[l] = p;
+        p += bm->words[l];
+    }
+
+    for (ix = 0; ix < bm->words[0]; ++ix) {
+        if (set) bm->bits[ix] = std_hbitmap_full(bm, ix);
+    }
+    /* every word below exists and is either all set or all clear */
+    for (l = 1; l <= bm->levels; ++l) {
+        uint64_t *mark = set ? bm->any_set[l] : bm->any_clr[l];
+        for (ix = 0; ix < bm->words[l-1]; ++ix)
+            mark[ix / STD_HBITMAP_WORD_BITS] |= std_hbitmap_bit(ix);
+    }
+    return bm;
+}
+
+void std_hbitmap_free(std_hbitmap_t *bm) {
+    if (bm == NULL) return;
+    free(bm->bits);
+    free(bm);
+}
+
+size_t std_hbitmap_len(const std_hbitmap_t *bm) {
+    return bm->len;
+}
+
+/*
+ * Mark word ix of level l-1 in the level l summary sum and carry on up while
+ * the summary words go from empty to non empty
+ */
+static void std_hbitmap_mark(std_hbitmap_t *bm, uint64_t **sum, size_t ix) {
+    unsigned int l;
+    for (l = 1; l <= bm->levels; ++l) {
+        uint64_t *w = &sum[l][ix / STD_HBITMAP_WORD_BITS];
+        bool was_empty = (*w == 0);
+        *w |= std_hbitmap_bit(ix);
+        if (!was_empty) break;
+        ix /= STD_HBITMAP_WORD_BITS;
+    }
+}
+
+/* the reverse of std_hbitmap_mark - carry on up while summary words become empty */
+static void std_hbitmap_unmark(std_hbitmap_t *bm, uint64_t **sum, size_t ix) {
+    unsigned int l;
+    for (l = 1; l <= bm->levels; ++l) {
+        uint64_t *w = &sum[l][ix / STD_HBITMAP_WORD_BITS];
+        *w &= ~std_hbitmap_bit(ix);
+        if (*w != 0) break;
+        ix /= STD_HBITMAP_WORD_BITS;
+    }
+}
+
+void std_hbitmap_set(std_hbitmap_t *bm, size_t bit) {
+    size_t ix = bit / STD_HBITMAP_WORD_BITS;
+    uint64_t old = bm->bits[ix];
+    uint64_t now = old | std_hbitmap_bit(bit);
+
+    if (old == now) return;
+    bm->bits[ix] = now;
+    if (old == 0) std_hbitmap_mark(bm, bm->any_set, ix);
+    if (now == std_hbitmap_full(bm, ix)) std_hbitmap_unmark(bm, bm->any_clr, ix);
+}
+
+void std_hbitmap_clear(std_hbitmap_t *bm, size_t bit) {
+    size_t ix = bit / STD_HBITMAP_WORD_BITS;
+    uint64_t old = bm->bits[ix];
+    uint64_t now = old & ~std_hbitmap_bit(bit);
+
+    if (old == now) return;
+    bm->bits[ix] = now;
+    if (now == 0) std_hbitmap_unmark(bm, bm->any_set, ix);
+    if (old == std_hbitmap_full(bm, ix)) std_hbitmap_mark(bm, bm->any_clr, ix);
+}
+
+bool std_hbitmap_test(const std_hbitmap_t *bm, size_t bit) {
+    return (bm->bits[bit / STD_HBITMAP_WORD_BITS] & std_hbitmap_bit(bit)) != 0;
+}
+
+static inline uint64_t std_hbitmap_leaf(const std_hbitmap_t *bm, size_t ix, bool clr) {
+    return clr ? (~bm->bits[ix] & std_hbitmap_full(bm, ix)) : bm->bits[ix];
+}
+
+/*
+ * Look at the rest of the word that holds 'from' and if nothing is there
+ * climb the summary levels until one has a bit past our position, then
+ * follow the lowest bits back down
+ */
+static int std_hbitmap_find(const std_hbitmap_t *bm, size_t from, bool clr) {
+    uint64_t * const *sum = clr ? bm->any_clr : bm->any_set;
+    size_t ix = from / STD_HBITMAP_WORD_BITS;
+    uint64_t w;
+    unsigned int l;
+
+    if (from >= bm->len) return -1;
+
+    w = std_hbitmap_leaf(bm, ix, clr) & (~0ULL << (from % STD_HBITMAP_WORD_BITS));
+    if (w != 0) return (int)(ix * STD_HBITMAP_WORD_BITS + __builtin_ctzll(w));
+
+    /* ix is the next word of level l-1 to consider */
+    ++ix;
+    for (l = 1; l <= bm->levels; ++l) {
+        if (ix >= bm->words[l-1]) return -1;
+        w = sum[l][ix / STD_HBITMAP_WORD_BITS] & (~0ULL << (ix % STD_HBITMAP_WORD_BITS));
+        if (w != 0) break;
+        ix = ix / STD_HBITMAP_WORD_BITS + 1;
+    }
+    if (l > bm->levels) return -1;
+
+    ix = (ix / STD_HBITMAP_WORD_BITS) * STD_HBITMAP_WORD_BITS + __builtin_ctzll(w);
+    while (--l > 0)
+        ix = ix * STD_HBITMAP_WORD_BITS + __builtin_ctzll(sum[l][ix]);
+    return (int)(ix * STD_HBITMAP_WORD_BITS + __builtin_ctzll(std_hbitmap_leaf(bm, ix, clr)));
+}
+
+int std_hbitmap_find_first_set(const std_hbitmap_t *bm, size_t from) {
+    return std_hbitmap_find(bm, from, false);
+}
+
+int std_hbitmap_find_first_clear(const std_hbitmap_t *bm, size_t from) {
+    return std_hbitmap_find(bm, from, true);
+}
@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * std_id_allocator.cpp
+ */
+
+#include "std_id_allocator.h"
+#include "event_log.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+
+namespace {
+
+enum { WORD_BITS = 64, MAG_SIZE = 64, MAG_REFILL = 32, CACHE_LINE = 64 };
+
+struct idalloc_t;
+
+/**
+ * Per thread cache (magazine) of IDs.  The IDs in it are marked in both the
+ * used and cached bitmaps.  Whoever clears the cached bit owns the ID - the
+ * owning thread when it pops it or another thread in alloc_specific - so an
+ * entry whose cached bit is already clear has been taken and is skipped.
+ * Records are never freed while the allocator exists - a thread exiting
+ * drains its record and releases it for reuse
+ */
+struct idalloc_mag_t {
+    std::atomic<bool> in_use;
+    idalloc_t *owner;
+    size_t count;
+    uint64_t ids[MAG_SIZE];     //! bit indexes, not IDs
+    idalloc_mag_t *next;
+    char pad[CACHE_LINE];
+};
+
+struct idalloc_t {
+    uint64_t first;
+    uint64_t count;
+    size_t words;
+    std::atomic<uint64_t> *used;    //! bit set if the ID is allocated or cached
+    std::atomic<uint64_t> *cached;  //! bit set if the ID is sitting in a magazine
+    std::atomic<size_t> hint;       //! word the last refill came from
+    std::atomic<idalloc_mag_t *> mags;
+    pthread_key_t mag_key;
+
+    idalloc_mag_t *get_mag();
+};
+
+inline uint64_t bit_of(uint64_t ix) {
+    return 1ULL << (ix % WORD_BITS);
+}
+
+inline bool test_and_clear(std::atomic<uint64_t> *map, uint64_t ix) {
+    uint64_t b = bit_of(ix);
+    return (map[ix / WORD_BITS].fetch_and(~b) & b) != 0;
+}
+
+inline bool test_and_set(std::atomic<uint64_t> *map, uint64_t ix) {
+    uint64_t b = bit_of(ix);
+    return (map[ix / WORD_BITS].fetch_or(b) & b) != 0;
+}
+
+/* Give cached IDs back to the bitmap until only keep are left */
+void mag_drain(idalloc_mag_t *mag, size_t keep) {
+    idalloc_t *p = mag->owner;
+    while (mag->count > keep) {
+        uint64_t ix = mag->ids[--mag->count];
+        if (test_and_clear(p->cached,ix)) {
+            p->used[ix / WORD_BITS].fetch_and(~bit_of(ix));
+        }
+    }
+}
+
+void idalloc_release_mag(void *param) {
+    idalloc_mag_t *mag = (idalloc_mag_t*)param;
+    mag_drain(mag,0);
+    mag->in_use.store(false);
+}
+
+idalloc_mag_t *idalloc_t::get_mag() {
+    idalloc_mag_t *mag = (idalloc_mag_t*)pthread_getspecific(mag_key);
+    if (mag!=NULL) return mag;
+
+    /* reuse the record of a thread that has exited if there is one */
+    for (mag = mags.load(); mag!=NULL ; mag = mag->next) {
+        bool expected = false;
+        if (mag->in_use.compare_exchange_strong(expected,true)) break;
+    }
+    if (mag==NULL) {
+        mag = new (std::nothrow) idalloc_mag_t;
+        if (mag==NULL) return NULL;
+        mag->in_use.store(true);
+        mag->owner = this;
+        mag->count = 0;
+        mag->next = mags.load();
+        while (!mags.compare_exchange_weak(mag->next,mag)) ;
+    }
+    pthread_setspecific(mag_key,mag);
+    return mag;
+}
+
+/*
+ * Take up to want free bits from one bitmap word in a single CAS.  Returns the
+ * mask of the bits taken
+ */
+uint64_t grab_word(idalloc_t *p, size_t word, unsigned int want) {
+    uint64_t old = p->used[word].load(std::memory_order_relaxed);
+    uint64_t mask;
+
+    do {
+        uint64_t avail = ~old;
+        mask = 0;
+        for (unsigned int ix = 0; ix < want && avail!=0 ; ++ix) {
+            uint64_t low = avail & (~avail + 1);
+            mask |= low;
+            avail &= ~low;
+        }
+        if (mask==0) return 0;
+    } while (!p->used[word].compare_exchange_weak(old,old | mask));
+    return mask;
+}
+
+/* Fill the magazine from the bitmap - false if there are no free IDs */
+bool mag_refill(idalloc_t *p, idalloc_mag_t *mag) {
+    size_t start = p->hint.load(std::memory_order_relaxed);
+
+    for (size_t n = 0; n < p->words ; ++n) {
+        size_t word = (start + n) % p->words;
+        uint64_t mask = grab_word(p,word,MAG_REFILL - mag->count);
+        if (mask==0) continue;
+
+        /* the IDs have to be marked used before cached - see idalloc_mag_t */
+        p->cached[word].fetch_or(mask);
+        /* highest first so that the pops come out in ascending order */
+        while (mask!=0) {
+            unsigned int b = WORD_BITS - 1 - __builtin_clzll(mask);
+            mag->ids[mag->count++] = (uint64_t)word * WORD_BITS + b;
+            mask &= ~(1ULL << b);
+        }
+        p->hint.store(word,std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Take one ID out of another thread's magazine when the bitmap has none left.
+ * Clearing the cached bit makes it ours - the owner skips the entry when it
+ * gets to it
+ */
+bool steal_cached(idalloc_t *p, uint64_t *ix) {
+    for (size_t word = 0; word < p->words ; ++word) {
+        uint64_t c = p->cached[word].load(std::memory_order_relaxed);
+        while (c!=0) {
+            uint64_t b = __builtin_ctzll(c);
+            c &= c - 1;
+            if (test_and_clear(p->cached,(uint64_t)word * WORD_BITS + b)) {
+                *ix = (uint64_t)word * WORD_BITS + b;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Give every ID cached by any thread back to the bitmap - false if there were
+ * none.  Each cached bit cleared here is owned the same way as in steal_cached
+ */
+bool reclaim_cached(idalloc_t *p) {
+    bool found = false;
+    for (size_t word = 0; word < p->words ; ++word) {
+        if (p->cached[word].load(std::memory_order_relaxed)==0) continue;
+        uint64_t mine = p->cached[word].exchange(0);
+        if (mine==0) continue;
+        p->used[word].fetch_and(~mine);
+        found = true;
+    }
+    return found;
+}
+
+/* Find the first run of num bits that are clear in the used bitmap */
+bool find_clear_run(idalloc_t *p, size_t num, uint64_t *start) {
+    size_t run = 0;
+    for (size_t w = 0; w < p->words ; ++w) {
+        uint64_t v = p->used[w].load(std::memory_order_relaxed);
+        if (v==~0ULL) {
+            run = 0;
+            continue;
+        }
+        for (unsigned int b = 0; b < WORD_BITS ; ++b) {
+            if (v & (1ULL << b)) {
+                run = 0;
+                continue;
+            }
+            if (run++==0) *start = (uint64_t)w * WORD_BITS + b;
+            if (run==num) return true;
+        }
+    }
+    return false;
+}
+
+/* Clear the used bits of [ix, ix+num) a word at a time */
+void release_range(idalloc_t *p, uint64_t ix, uint64_t num) {
+    while (num > 0) {
+        unsigned int b = ix % WORD_BITS;
+        uint64_t n = (num < (uint64_t)(WORD_BITS - b)) ? num : WORD_BITS - b;
+        uint64_t mask = ((n==WORD_BITS) ? ~0ULL : ((1ULL << n) - 1)) << b;
+        p->used[ix / WORD_BITS].fetch_and(~mask);
+        ix += n;
+        num -= n;
+    }
+}
+
+/* Set the used bits of [ix, ix+num) if they are all clear */
+bool claim_range(idalloc_t *p, uint64_t ix, uint64_t num) {
+    uint64_t done = 0;
+    while (done < num) {
+        uint64_t pos = ix + done;
+        unsigned int b = pos % WORD_BITS;
+        uint64_t n = (num - done < (uint64_t)(WORD_BITS - b)) ? num - done : WORD_BITS - b;
+        uint64_t mask = ((n==WORD_BITS) ? ~0ULL : ((1ULL << n) - 1)) << b;
+        std::atomic<uint64_t> &w = p->used[pos / WORD_BITS];
+        uint64_t old = w.load(std::memory_order_relaxed);
+        do {
+            if (old & mask) {
+                release_range(p,ix,done);
+                return false;
+            }
+        } while (!w.compare_exchange_weak(old,old | mask));
+        done += n;
+    }
+    return true;
+}
+
+bool take_specific(idalloc_t *p, uint64_t ix) {
+    if (!test_and_set(p->used,ix)) return true;
+    /* it may only be sitting in a cache */
+    return test_and_clear(p->cached,ix);
+}
+
+bool is_allocated(idalloc_t *p, uint64_t ix) {
+    uint64_t b = bit_of(ix);
+    return (p->used[ix / WORD_BITS].load() & b)!=0 &&
+            (p->cached[ix / WORD_BITS].load() & b)==0;
+}
+
+}
+
+t_std_error std_id_allocator_create(std_id_allocator_handle_t *handle, uint64_t first,
+        uint64_t count) {
+    if (count==0 || first + count < first) return STD_ERR(COM,PARAM,0);
+
+    idalloc_t *p = new (std::nothrow) idalloc_t;
+    if (p==NULL) return STD_ERR(COM,NOMEM,0);
+
+    p->first = first;
+    p->count = count;
+    p->words = (count + WORD_BITS - 1) / WORD_BITS;
+    p->used = new (std::nothrow) std::atomic<uint64_t>[p->words];
+    p->cached = new (std::nothrow) std::atomic<uint64_t>[p->words];
+    p->hint.store(0);
+    p->mags.store(NULL);
+
+    if (p->used==NULL || p->cached==NULL || pthread_key_create(&p->mag_key,idalloc_release_mag)!=0) {
+        EV_LOG(ERR,COM,0,"COM-IDALLOC","Failed to create ID allocator for %llu IDs",
+                (unsigned long long)count);
+        delete [] p->used;
+        delete [] p->cached;
+        delete p;
+        return STD_ERR(COM,NOMEM,0);
+    }
+
+    for (size_t ix = 0; ix < p->words ; ++ix) {
+        p->used[ix].store(0);
+        p->cached[ix].store(0);
+    }
+    /* the bits past the end are permanently in use */
+    if (count % WORD_BITS) {
+        p->used[p->words-1].store(~0ULL << (count % WORD_BITS));
+    }
+    *handle = p;
+    return STD_ERR_OK;
+}
+
+void std_id_allocator_destroy(std_id_allocator_handle_t handle) {
+    idalloc_t *p = (idalloc_t*)handle;
+
+    /* no more thread exit callbacks once the key is gone */
+    pthread_key_delete(p->mag_key);
+
+    idalloc_mag_t *mag = p->mags.load();
+    while (mag!=NULL) {
+        idalloc_mag_t *next = mag->next;
+        delete mag;
+        mag = next;
+    }
+    delete [] p->used;
+    delete [] p->cached;
+    delete p;
+}
+
+t_std_error std_id_allocator_alloc(std_id_allocator_handle_t handle, uint64_t *id) {
+    idalloc_t *p = (idalloc_t*)handle;
+    idalloc_mag_t *mag = p->get_mag();
+    if (mag==NULL) return STD_ERR(COM,NOMEM,0);
+
+    do {
+        while (mag->count > 0) {
+            uint64_t ix = mag->ids[--mag->count];
+            if (test_and_clear(p->cached,ix)) {
+                *id = p->first + ix;
+                return STD_ERR_OK;
+            }
+        }
+    } while (mag_refill(p,mag));
+
+    /* the only free IDs left may be in the caches of other threads */
+    uint64_t ix;
+    if (steal_cached(p,&ix)) {
+        *id = p->first + ix;
+        return STD_ERR_OK;
+    }
+    return STD_ERR(COM,NORESOURCE,0);
+}
+
+t_std_error std_id_allocator_alloc_specific(std_id_allocator_handle_t handle, uint64_t id) {
+    idalloc_t *p = (idalloc_t*)handle;
+    if (id < p->first || id - p->first >= p->count) return STD_ERR(COM,PARAM,0);
+
+    if (!take_specific(p,id - p->first)) return STD_ERR(COM,FAIL,0);
+    return STD_ERR_OK;
+}
+
+t_std_error std_id_allocator_alloc_contiguous(std_id_allocator_handle_t handle, size_t num,
+        uint64_t *first) {
+    idalloc_t *p = (idalloc_t*)handle;
+    uint64_t start;
+
+    if (num==0 || num > p->count) return STD_ERR(COM,PARAM,0);
+
+    for (int attempt = 0; attempt < 3 ; ++attempt) {
+        /* another thread may take part of the run between the search and the claim */
+        while (find_clear_run(p,num,&start)) {
+            if (claim_range(p,start,num)) {
+                *first = p->first + start;
+                return STD_ERR_OK;
+            }
+        }
+        /* cached IDs may be what is in the way - first our own then everyone's */
+        if (attempt==0) {
+            idalloc_mag_t *mag = p->get_mag();
+            if (mag!=NULL) mag_drain(mag,0);
+        } else if (attempt==1 && !reclaim_cached(p)) {
+            break;
+        }
+    }
+    return STD_ERR(COM,NORESOURCE,0);
+}
+
+t_std_error std_id_allocator_free(std_id_allocator_handle_t handle, uint64_t id) {
+    idalloc_t *p = (idalloc_t*)handle;
+    if (id < p->first || id - p->first >= p->count) return STD_ERR(COM,PARAM,0);
+
+    uint64_t ix = id - p->first;
+    if (!is_allocated(p,ix)) return STD_ERR(COM,PARAM,0);
+
+    idalloc_mag_t *mag = p->get_mag();
+    if (mag==NULL) {
+        p->used[ix / WORD_BITS].fetch_and(~bit_of(ix));
+        return STD_ERR_OK;
+    }
+    if (mag->count==MAG_SIZE) mag_drain(mag,MAG_SIZE/2);
+
+    test_and_set(p->cached,ix);
+    mag->ids[mag->count++] = ix;
+    return STD_ERR_OK;
+}
+
+t_std_error std_id_allocator_free_range(std_id_allocator_handle_t handle, uint64_t first,
+        size_t num) {
+    idalloc_t *p = (idalloc_t*)handle;
+    if (first < p->first || first - p->first >= p->count ||
+            num > p->count - (first - p->first)) return STD_ERR(COM,PARAM,0);
+
+    uint64_t start = first - p->first;
+    for (uint64_t ix = start; ix < start + num ; ++ix) {
+        if (!is_allocated(p,ix)) return STD_ERR(COM,PARAM,0);
+    }
+    release_range(p,start,num);
+    return STD_ERR_OK;
+}
+
+t_std_error std_id_allocator_reserve(std_id_allocator_handle_t handle, uint64_t first,
+        size_t num) {
+    idalloc_t *p = (idalloc_t*)handle;
+    if (first < p->first || first - p->first >= p->count ||
+            num > p->count - (first - p->first)) return STD_ERR(COM,PARAM,0);
+
+    uint64_t start = first - p->first;
+    if (claim_range(p,start,num)) return STD_ERR_OK;
+
+    /* slow path - some of the IDs are in use or sitting in caches */
+    for (uint64_t ix = start; ix < start + num ; ++ix) {
+        if (!take_specific(p,ix)) {
+            release_range(p,start,ix - start);
+            return STD_ERR(COM,FAIL,0);
+        }
+    }
+    return STD_ERR_OK;
+}
@@ -226,6 +226,142 @@ std_dll_remove(std_dll_head *head, std_dll *item)
     item->dll_next = (std_dll *)0;
 }
 
+void
+std_dll_splice(std_dll_head *dst, std_dll *after, std_dll_head *src,
+               std_dll *first, std_dll *last)
+{
+    DLL_VALIDATE(dst);
+    DLL_VALIDATE(src);
+    assert(first && last);
+
+    if (after == (std_dll *)0)
+        after = &dst->head;
+
+    /* unlink the range from src */
+    first->dll_back->dll_next = last->dll_next;
+    last->dll_next->dll_back = first->dll_back;
+
+    /* and link it in after 'after' */
+    first->dll_back = after;
+    last->dll_next = after->dll_next;
+    after->dll_next->dll_back = last;
+    after->dll_next = first;
+}
+
+void
+std_dll_splice_list(std_dll_head *dst, std_dll_head *src)
+{
+    std_dll *first = std_dll_getfirst(src);
+
+    if (first != (std_dll *)0)
+        std_dll_splice(dst, std_dll_getlast(dst), src, first, std_dll_getlast(src));
+}
+
+/*
+ * Merge two NULL terminated chains (linked through dll_next only).  Elements
+ * of a are taken first on equal keys so a must hold the earlier elements
+ */
+static std_dll *
+std_dll_merge_chains(std_dll_head *head, std_dll *a, std_dll *b)
+{
+    std_dll start;
+    std_dll *tail = &start;
+
+    while (a && b) {
+        if (head->compare(offset(b,head->offset),offset(a,head->offset),head->len) < 0) {
+            tail->dll_next = b;
+            b = b->dll_next;
+        } else {
+            tail->dll_next = a;
+            a = a->dll_next;
+        }
+        tail = tail->dll_next;
+    }
+    tail->dll_next = a ? a : b;
+    return start.dll_next;
+}
+
+/*
+ * Detach all the elements of a list as a NULL terminated chain
+ */
+static std_dll *
+std_dll_detach_chain(std_dll_head *head)
+{
+    std_dll *first = std_dll_getfirst(head);
+
+    if (first != (std_dll *)0)
+        head->tail.dll_back->dll_next = (std_dll *)0;
+    head->head.dll_next = &head->tail;
+    head->tail.dll_back = &head->head;
+    return first;
+}
+
+/*
+ * Put a NULL terminated chain back on an empty list, fixing up the back links
+ */
+static void
+std_dll_attach_chain(std_dll_head *head, std_dll *chain)
+{
+    std_dll *prev = &head->head;
+
+    for ( ; chain != (std_dll *)0 ; chain = chain->dll_next) {
+        chain->dll_back = prev;
+        prev->dll_next = chain;
+        prev = chain;
+    }
+    prev->dll_next = &head->tail;
+    head->tail.dll_back = prev;
+}
+
+void
+std_dll_merge(std_dll_head *dst, std_dll_head *src)
+{
+    std_dll *a, *b;
+
+    DLL_VALIDATE(dst);
+    DLL_VALIDATE(src);
+    assert(dst->compare);
+
+    a = std_dll_detach_chain(dst);
+    b = std_dll_detach_chain(src);
+    std_dll_attach_chain(dst, std_dll_merge_chains(dst, a, b));
+}
+
+#define DLL_SORT_BINS   (sizeof(size_t) * 8)
+
+void
+std_dll_sort(std_dll_head *head)
+{
+    /* bins[i] holds a sorted run of 2^i elements (bottom up merge sort) */
+    std_dll *bins[DLL_SORT_BINS];
+    std_dll *walk, *carry, *result = (std_dll *)0;
+    size_t ix;
+
+    DLL_VALIDATE(head);
+    assert(head->compare);
+
+    memset(bins, 0, sizeof(bins));
+    walk = std_dll_detach_chain(head);
+    while (walk != (std_dll *)0) {
+        carry = walk;
+        walk = walk->dll_next;
+        carry->dll_next = (std_dll *)0;
+
+        /* runs in the higher bins were formed first so they go in front */
+        for (ix = 0; bins[ix] != (std_dll *)0; ++ix) {
+            carry = std_dll_merge_chains(head, bins[ix], carry);
+            bins[ix] = (std_dll *)0;
+        }
+        bins[ix] = carry;
+    }
+
+    for (ix = 0; ix < DLL_SORT_BINS; ++ix) {
+        if (bins[ix] != (std_dll *)0)
+            result = std_dll_merge_chains(head, bins[ix], result);
+    }
+    std_dll_attach_chain(head, result);
+}
+
 /*----------------------------------------------------------------*\
                     First In First Out
 \*----------------------------------------------------------------*/
@@ -30,7 +30,11 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include "std_mergesort.h"
+#include "std_mutex_lock.h"
+#include "std_condition_variable.h"
 
 /*******************************************************************************
  * NAME          : std_merge_sort_merge_arrays
@@ -219,3 +223,487 @@ void std_merge_sort(void *context, void *array, int num_elements,
     std_merge_sort_divide_n_sort (context,
                       array, 0, num_elements-1, tmp_array, cmp_func, copy_func);
 }
+
+/* Runs shorter than this are insertion sorted before merging */
+#define STD_MERGE_SORT_RUN  16
+
+/*******************************************************************************
+ * NAME          : std_merge_sort_elem_copy
+ *
+ * DESCRIPTION   : Copy one or more elements.  The common element sizes are
+ *                 handled with fixed size copies that the compiler turns into
+ *                 plain loads and stores.
+ ***************************************************************************/
+static inline void std_merge_sort_elem_copy (void *dst, const void *src,
+                            size_t elem_size)
+{
+    switch (elem_size)
+    {
+        case 2:  memcpy (dst, src, 2); break;
+        case 4:  memcpy (dst, src, 4); break;
+        case 8:  memcpy (dst, src, 8); break;
+        case 12: memcpy (dst, src, 12); break;
+        case 16: memcpy (dst, src, 16); break;
+        case 24: memcpy (dst, src, 24); break;
+        case 32: memcpy (dst, src, 32); break;
+        default: memcpy (dst, src, elem_size); break;
+    }
+}
+
+/*******************************************************************************
+ * NAME          : std_merge_sort_elem_insertion
+ *
+ * DESCRIPTION   : Stable insertion sort of num_elements elements in place.
+ *                 'scratch' must have room for one element.
+ ***************************************************************************/
+static void std_merge_sort_elem_insertion (void *context, uint8_t *base,
+                            size_t num_elements, size_t elem_size,
+                            uint8_t *scratch, std_merge_sort_elem_cmp cmp_func)
+{
+    size_t index;
+    size_t pos;
+
+    for (index = 1; index < num_elements; index++)
+    {
+        uint8_t *curr = base + index * elem_size;
+
+        if (cmp_func (context, curr - elem_size, curr) <= 0)
+            continue;
+
+        std_merge_sort_elem_copy (scratch, curr, elem_size);
+        pos = index;
+        while ((pos > 0) &&
+               (cmp_func (context, base + (pos - 1) * elem_size, scratch) > 0))
+        {
+            pos--;
+        }
+        memmove (base + (pos + 1) * elem_size, base + pos * elem_size,
+                 (index - pos) * elem_size);
+        std_merge_sort_elem_copy (base + pos * elem_size, scratch, elem_size);
+    }
+}
+
+/*******************************************************************************
+ * NAME          : std_merge_sort_elem_merge
+ *
+ * DESCRIPTION   : Merge the sorted runs src[left..mid) and src[mid..right)
+ *                 into dst[left..right).  Elements of the left run are taken
+ *                 first on equal keys so the merge is stable.
+ ***************************************************************************/
+static void std_merge_sort_elem_merge (void *context, const uint8_t *src,
+                            uint8_t *dst, size_t left, size_t mid, size_t right,
+                            size_t elem_size, std_merge_sort_elem_cmp cmp_func)
+{
+    const uint8_t *l = src + left * elem_size;
+    const uint8_t *l_end = src + mid * elem_size;
+    const uint8_t *r = l_end;
+    const uint8_t *r_end = src + right * elem_size;
+    uint8_t *out = dst + left * elem_size;
+
+    /* the runs are already in order - nothing to merge */
+    if ((r == r_end) || (cmp_func (context, r - elem_size, r) <= 0))
+    {
+        memcpy (out, l, r_end - l);
+        return;
+    }
+
+    while ((l < l_end) && (r < r_end))
+    {
+        if (cmp_func (context, r, l) < 0)
+        {
+            std_merge_sort_elem_copy (out, r, elem_size);
+            r += elem_size;
+        }
+        else
+        {
+            std_merge_sort_elem_copy (out, l, elem_size);
+            l += elem_size;
+        }
+        out += elem_size;
+    }
+
+    /* whatever is left in either run is already in place order */
+    memcpy (out, l, l_end - l);
+    out += l_end - l;
+    memcpy (out, r, r_end - r);
+}
+
+/*******************************************************************************
+ * NAME          : std_merge_sort_elem
+ *
+ * DESCRIPTION   : Bottom up stable merge sort of fixed size elements.
+ *
+ *                 Runs of STD_MERGE_SORT_RUN (or twice that) elements are
+ *                 insertion sorted in place and then merged pairwise,
+ *                 alternating between array and tmp_array on each pass.
+ *                 The run length is chosen so that there is an even number
+ *                 of passes and the result finishes in array.
+ *
+ * ARGUMENTS     : context      - Context provided by the application. It is
+ *                                passed to the compare function.
+ *
+ *                 array        - The input array that needs to be sorted.
+ *
+ *                 num_elements - Number of elements in the array.
+ *
+ *                 elem_size    - Size of each element in bytes.
+ *
+ *                 tmp_array    - A temporary array with room for
+ *                                num_elements elements.
+ *
+ *                 cmp_func     - The User defined comparison function.
+ *                                Takes pointers to the 2 elements.
+ *
+ * RETURN VALUES : None
+ ******************************************************************************/
+void std_merge_sort_elem (void *context, void *array, size_t num_elements,
+             size_t elem_size, void *tmp_array, std_merge_sort_elem_cmp cmp_func)
+{
+    uint8_t *src = (uint8_t *) array;
+    uint8_t *dst = (uint8_t *) tmp_array;
+    uint8_t *swap;
+    size_t run = STD_MERGE_SORT_RUN;
+    size_t passes = 0;
+    size_t width;
+    size_t left;
+
+    if (num_elements < 2)
+        return;
+
+    for (width = run; width < num_elements; width *= 2)
+        passes++;
+    if (passes & 1)
+        run *= 2;
+
+    /* tmp_array is not in use yet so its first element is the scratch space */
+    for (left = 0; left < num_elements; left += run)
+    {
+        size_t count = num_elements - left;
+        if (count > run)
+            count = run;
+        std_merge_sort_elem_insertion (context, src + left * elem_size, count,
+                                       elem_size, dst, cmp_func);
+    }
+
+    for (width = run; width < num_elements; width *= 2)
+    {
+        for (left = 0; left < num_elements; left += 2 * width)
+        {
+            size_t mid = left + width;
+            size_t right = left + 2 * width;
+            if (mid > num_elements)
+                mid = num_elements;
+            if (right > num_elements)
+                right = num_elements;
+            std_merge_sort_elem_merge (context, src, dst, left, mid, right,
+                                       elem_size, cmp_func);
+        }
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+}
+
+/* Arrays smaller than this are not worth handing to the thread pool */
+#define STD_MERGE_SORT_PARALLEL_MIN  8192
+
+typedef enum {
+    STD_MERGE_SORT_TASK_SORT,
+    STD_MERGE_SORT_TASK_MERGE,
+    STD_MERGE_SORT_TASK_COPY,
+} std_merge_sort_task_type_t;
+
+/*
+ * State shared by all of the tasks of one parallel sort
+ */
+typedef struct {
+    void                  *context;
+    std_merge_sort_cmp     cmp_func;
+    std_merge_sort_copyfn  copy_func;
+    std_mutex_type_t       lock;
+    std_condition_var_t    cond;
+    size_t                 pending;
+} std_merge_sort_batch_t;
+
+/*
+ * One unit of work.  SORT sorts [left,right) of src (using dst as the
+ * temporary array).  MERGE merges src[a_lo,a_hi) and src[b_lo,b_hi) into dst
+ * starting at out.  COPY copies src[left,right) to dst.
+ */
+typedef struct {
+    std_merge_sort_batch_t     *batch;
+    std_merge_sort_task_type_t  type;
+    void                       *src;
+    void                       *dst;
+    int                         left;
+    int                         right;
+    int                         a_lo, a_hi;
+    int                         b_lo, b_hi;
+    int                         out;
+} std_merge_sort_task_t;
+
+/*******************************************************************************
+ * NAME          : std_merge_sort_split
+ *
+ * DESCRIPTION   : Merge path partition.  Returns how many elements of run A
+ *                 are among the first 'diag' elements of the stable merge of
+ *                 runs A = src[a_lo,a_hi) and B = src[b_lo,b_hi).
+ ***************************************************************************/
+static int std_merge_sort_split (std_merge_sort_batch_t *batch, void *src,
+                            int a_lo, int a_hi, int b_lo, int b_hi, int diag)
+{
+    int lo = diag - (b_hi - b_lo);
+    int hi = diag;
+    int mid;
+
+    if (lo < 0)
+        lo = 0;
+    if (hi > a_hi - a_lo)
+        hi = a_hi - a_lo;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        /* ties go to A, so A[mid] is output first if it is <= B[diag-mid-1] */
+        if (batch->cmp_func (batch->context, src, a_lo + mid,
+                             src, b_lo + diag - mid - 1) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void std_merge_sort_run_task (void *param)
+{
+    std_merge_sort_task_t *task = (std_merge_sort_task_t *) param;
+    std_merge_sort_batch_t *batch = task->batch;
+    void *ctx = batch->context;
+    int a, b, out;
+
+    switch (task->type)
+    {
+        case STD_MERGE_SORT_TASK_SORT:
+            std_merge_sort_divide_n_sort (ctx, task->src, task->left,
+                                          task->right - 1, task->dst,
+                                          batch->cmp_func, batch->copy_func);
+            break;
+
+        case STD_MERGE_SORT_TASK_MERGE:
+            a = task->a_lo;
+            b = task->b_lo;
+            out = task->out;
+            while ((a < task->a_hi) && (b < task->b_hi))
+            {
+                if (batch->cmp_func (ctx, task->src, a, task->src, b) <= 0)
+                    batch->copy_func (ctx, task->dst, out++, task->src, a++);
+                else
+                    batch->copy_func (ctx, task->dst, out++, task->src, b++);
+            }
+            while (a < task->a_hi)
+                batch->copy_func (ctx, task->dst, out++, task->src, a++);
+            while (b < task->b_hi)
+                batch->copy_func (ctx, task->dst, out++, task->src, b++);
+            break;
+
+        case STD_MERGE_SORT_TASK_COPY:
+            for (a = task->left; a < task->right; a++)
+                batch->copy_func (ctx, task->dst, a, task->src, a);
+            break;
+    }
+
+    std_mutex_lock (&batch->lock);
+    if (--batch->pending == 0)
+        std_condition_var_signal (&batch->cond);
+    std_mutex_unlock (&batch->lock);
+}
+
+/*******************************************************************************
+ * NAME          : std_merge_sort_run_tasks
+ *
+ * DESCRIPTION   : Run a set of tasks on the thread pool and wait for all of
+ *                 them to finish.  Any task the pool doesn't accept is run on
+ *                 the calling thread.
+ ***************************************************************************/
+static void std_merge_sort_run_tasks (std_thread_pool_handle_t pool,
+                            std_merge_sort_batch_t *batch,
+                            std_merge_sort_task_t *tasks, size_t count)
+{
+    std_thread_pool_job_t job;
+    size_t index;
+
+    batch->pending = count;
+    for (index = 0; index < count; index++)
+    {
+        job.context = &tasks[index];
+        job.funct = std_merge_sort_run_task;
+        job.free_job_func = NULL;
+        if (std_thread_pool_job_add (pool, &job) != STD_ERR_OK)
+            std_merge_sort_run_task (&tasks[index]);
+    }
+
+    std_mutex_lock (&batch->lock);
+    while (batch->pending > 0)
+        std_condition_var_wait (&batch->cond, &batch->lock);
+    std_mutex_unlock (&batch->lock);
+}
+
+/*******************************************************************************
+ * NAME          : std_merge_sort_parallel
+ *
+ * DESCRIPTION   : Parallel version of std_merge_sort.
+ *
+ *                 The array is cut into 'threads' chunks that are each sorted
+ *                 with std_merge_sort_divide_n_sort.  The sorted runs are then
+ *                 merged pairwise, alternating between array and tmp_array,
+ *                 until one run is left.  Every merge round is split into
+ *                 about 'threads' equal pieces of output - the point in each
+ *                 input run where a piece starts is found with a binary search
+ *                 along the merge path, so the pieces can be merged
+ *                 independently.
+ *
+ * ARGUMENTS     : pool         - Thread pool to run the tasks on.
+ *
+ *                 threads      - Number of tasks to split each step into.
+ *
+ *                 Remaining arguments as for std_merge_sort.
+ *
+ * RETURN VALUES : None
+ ******************************************************************************/
+void std_merge_sort_parallel (std_thread_pool_handle_t pool, size_t threads,
+             void *context, void *array, int num_elements,
+             void *tmp_array, std_merge_sort_cmp cmp_func,
+             std_merge_sort_copyfn copy_func)
+{
+    std_merge_sort_batch_t batch;
+    std_merge_sort_task_t *tasks;
+    int *bounds;
+    size_t nruns, nextruns, ntasks, index, pair, piece, pieces;
+    void *src, *dst, *swap;
+
+    if ((pool == NULL) || (threads < 2) || (num_elements < STD_MERGE_SORT_PARALLEL_MIN))
+    {
+        std_merge_sort (context, array, num_elements, tmp_array, cmp_func, copy_func);
+        return;
+    }
+
+    if (threads > (size_t) num_elements / (STD_MERGE_SORT_PARALLEL_MIN / 8))
+        threads = (size_t) num_elements / (STD_MERGE_SORT_PARALLEL_MIN / 8);
+
+    /* bounds[i] .. bounds[i+1] is run i.  A round never needs more tasks than
+     * 'threads' pieces plus one per pair */
+    tasks = (std_merge_sort_task_t *) calloc (2 * threads + 1, sizeof (*tasks));
+    bounds = (int *) calloc (threads + 1, sizeof (*bounds));
+    if ((tasks == NULL) || (bounds == NULL))
+    {
+        free (tasks);
+        free (bounds);
+        std_merge_sort (context, array, num_elements, tmp_array, cmp_func, copy_func);
+        return;
+    }
+
+    batch.context = context;
+    batch.cmp_func = cmp_func;
+    batch.copy_func = copy_func;
+    std_mutex_lock_init_non_recursive (&batch.lock);
+    std_condition_var_init (&batch.cond);
+
+    /* sort the chunks */
+    nruns = threads;
+    for (index = 0; index <= nruns; index++)
+        bounds[index] = (int) (((uint64_t) num_elements * index) / nruns);
+    for (index = 0; index < nruns; index++)
+    {
+        tasks[index].batch = &batch;
+        tasks[index].type = STD_MERGE_SORT_TASK_SORT;
+        tasks[index].src = array;
+        tasks[index].dst = tmp_array;
+        tasks[index].left = bounds[index];
+        tasks[index].right = bounds[index + 1];
+    }
+    std_merge_sort_run_tasks (pool, &batch, tasks, nruns);
+
+    /* merge pairs of runs until there is one left */
+    src = array;
+    dst = tmp_array;
+    while (nruns > 1)
+    {
+        ntasks = 0;
+        pieces = threads / (nruns / 2);
+        if (pieces == 0)
+            pieces = 1;
+
+        for (pair = 0; pair + 1 < nruns; pair += 2)
+        {
+            int a_lo = bounds[pair];
+            int a_hi = bounds[pair + 1];
+            int b_lo = a_hi;
+            int b_hi = bounds[pair + 2];
+            int total = b_hi - a_lo;
+            int prev_diag = 0;
+            int prev_a = 0;
+
+            for (piece = 1; piece <= pieces; piece++)
+            {
+                int diag = (int) (((uint64_t) total * piece) / pieces);
+                int a_split = std_merge_sort_split (&batch, src, a_lo, a_hi,
+                                                    b_lo, b_hi, diag);
+                std_merge_sort_task_t *task = &tasks[ntasks++];
+
+                task->batch = &batch;
+                task->type = STD_MERGE_SORT_TASK_MERGE;
+                task->src = src;
+                task->dst = dst;
+                task->a_lo = a_lo + prev_a;
+                task->a_hi = a_lo + a_split;
+                task->b_lo = b_lo + (prev_diag - prev_a);
+                task->b_hi = b_lo + (diag - a_split);
+                task->out = a_lo + prev_diag;
+
+                prev_diag = diag;
+                prev_a = a_split;
+            }
+        }
+        if (nruns & 1)
+        {
+            /* the odd run out still has to move to the other array */
+            std_merge_sort_task_t *task = &tasks[ntasks++];
+            task->batch = &batch;
+            task->type = STD_MERGE_SORT_TASK_COPY;
+            task->src = src;
+            task->dst = dst;
+            task->left = bounds[nruns - 1];
+            task->right = bounds[nruns];
+        }
+        std_merge_sort_run_tasks (pool, &batch, tasks, ntasks);
+
+        nextruns = 0;
+        for (index = 0; index < nruns; index += 2)
+            bounds[nextruns++] = bounds[index];
+        bounds[nextruns] = num_elements;
+        nruns = nextruns;
+
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != array)
+    {
+        for (index = 0; index < threads; index++)
+        {
+            tasks[index].batch = &batch;
+            tasks[index].type = STD_MERGE_SORT_TASK_COPY;
+            tasks[index].src = src;
+            tasks[index].dst = array;
+            tasks[index].left = (int) (((uint64_t) num_elements * index) / threads);
+            tasks[index].right = (int) (((uint64_t) num_elements * (index + 1)) / threads);
+        }
+        std_merge_sort_run_tasks (pool, &batch, tasks, threads);
+    }
+
+    std_condition_var_destroy (&batch.cond);
+    std_mutex_destroy (&batch.lock);
+    free (tasks);
+    free (bounds);
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_mpsc_queue.c
+ */
+
+/*!
+ * \file   std_mpsc_queue.c
+ * \brief  Lock free intrusive multi producer single consumer queue.
+ *
+ * This is the Vyukov intrusive MPSC queue.  Producers swap themselves into
+ * head and then link the previous head to themselves, the consumer follows
+ * the next links from tail.  A stub node keeps the list from ever being
+ * empty so that the producers never have to touch tail.
+ */
+
+#include "std_mpsc_queue.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+static inline void std_mpsc_link(std_mpsc_queue_t *q, std_mpsc_node *node)
+{
+    std_mpsc_node *prev;
+
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n(&q->head, node, __ATOMIC_SEQ_CST);
+    /* the consumer can't get past prev until this store is visible */
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+t_std_error std_mpsc_queue_init(std_mpsc_queue_t *q, bool use_wakeup)
+{
+    memset(q, 0, sizeof(*q));
+    q->head = &q->stub;
+    q->tail = &q->stub;
+    q->wake_fd = -1;
+
+    if (use_wakeup) {
+        q->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (q->wake_fd < 0)
+            return STD_ERR(COM, FAIL, errno);
+    }
+    return STD_ERR_OK;
+}
+
+void std_mpsc_queue_destroy(std_mpsc_queue_t *q)
+{
+    if (q->wake_fd >= 0)
+        close(q->wake_fd);
+    q->wake_fd = -1;
+}
+
+void std_mpsc_queue_push(std_mpsc_queue_t *q, std_mpsc_node *node)
+{
+    std_mpsc_link(q, node);
+
+    /*
+     * Only pay for the syscall when the consumer said it is going to sleep.
+     * The exchange makes sure only one producer writes
+     */
+    if (q->wake_fd >= 0 && __atomic_load_n(&q->sleeping, __ATOMIC_SEQ_CST) &&
+        __atomic_exchange_n(&q->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+        ssize_t rc = write(q->wake_fd, &one, sizeof(one));
+        (void)rc;
+    }
+}
+
+std_mpsc_node * std_mpsc_queue_pop(std_mpsc_queue_t *q)
+{
+    std_mpsc_node *tail = q->tail;
+    std_mpsc_node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    std_mpsc_node *head;
+
+    if (tail == &q->stub) {
+        if (next == NULL)
+            return NULL;
+        q->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        q->tail = next;
+        return tail;
+    }
+
+    /* tail is the last node - unless a producer is half way through a push */
+    head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (tail != head)
+        return NULL;
+
+    /* put the stub back behind tail so that tail can be handed out */
+    std_mpsc_link(q, &q->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+bool std_mpsc_queue_empty(std_mpsc_queue_t *q)
+{
+    return q->tail == &q->stub &&
+           __atomic_load_n(&q->head, __ATOMIC_SEQ_CST) == &q->stub;
+}
+
+int std_mpsc_queue_wake_fd(std_mpsc_queue_t *q)
+{
+    return q->wake_fd;
+}
+
+bool std_mpsc_queue_prepare_wait(std_mpsc_queue_t *q)
+{
+    uint64_t count;
+
+    /* clear out any wakeup left over from the last wait */
+    while (read(q->wake_fd, &count, sizeof(count)) > 0) ;
+
+    /*
+     * The store to sleeping and the producer's exchange of head are both
+     * sequentially consistent - either the producer sees sleeping set and
+     * writes the fd or we see the new head here
+     */
+    __atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+    if (!std_mpsc_queue_empty(q)) {
+        __atomic_store_n(&q->sleeping, 0, __ATOMIC_SEQ_CST);
+        return false;
+    }
+    return true;
+}
+
+std_mpsc_node * std_mpsc_queue_pop_wait(std_mpsc_queue_t *q, int timeout_ms)
+{
+    std_mpsc_node *node;
+    struct pollfd pfd;
+
+    while ((node = std_mpsc_queue_pop(q)) == NULL) {
+        if (!std_mpsc_queue_prepare_wait(q)) {
+            /* a producer is in the middle of a push - it will be done shortly */
+            sched_yield();
+            continue;
+        }
+
+        pfd.fd = q->wake_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int rc = poll(&pfd, 1, timeout_ms);
+        __atomic_store_n(&q->sleeping, 0, __ATOMIC_SEQ_CST);
+
+        if (rc == 0)
+            return std_mpsc_queue_pop(q);
+        if (rc < 0 && errno != EINTR)
+            return NULL;
+    }
+    return node;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_radix_sort.c
+ */
+
+
+/**
+ *      @file  std_radix_sort.c
+ *      @brief  LSD radix sort of record arrays
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include "std_radix_sort.h"
+#include "std_mergesort.h"
+
+/* Arrays smaller than this are sorted with std_merge_sort_elem */
+#define STD_RADIX_SORT_MIN      64
+
+/* Max key bytes whose histograms are all gathered in one pass */
+#define STD_RADIX_SORT_MAX_HIST 16
+
+#define STD_RADIX_SORT_BUCKETS  256
+
+typedef enum {
+    STD_RADIX_KEY_U32,
+    STD_RADIX_KEY_U64,
+    STD_RADIX_KEY_BYTES,
+} std_radix_key_type_t;
+
+typedef struct {
+    std_radix_key_type_t type;
+    size_t key_offset;
+    size_t key_len;
+} std_radix_key_t;
+
+/*******************************************************************************
+ * NAME          : std_radix_sort_key_cmp
+ *
+ * DESCRIPTION   : Compare function used for the small array fallback.
+ ***************************************************************************/
+static int std_radix_sort_key_cmp (void *context, const void *elem_a,
+                            const void *elem_b)
+{
+    std_radix_key_t *key = (std_radix_key_t *) context;
+    const uint8_t *a = (const uint8_t *) elem_a + key->key_offset;
+    const uint8_t *b = (const uint8_t *) elem_b + key->key_offset;
+    uint32_t a32, b32;
+    uint64_t a64, b64;
+
+    switch (key->type)
+    {
+        case STD_RADIX_KEY_U32:
+            memcpy (&a32, a, sizeof (a32));
+            memcpy (&b32, b, sizeof (b32));
+            return (a32 < b32) ? -1 : (a32 > b32);
+        case STD_RADIX_KEY_U64:
+            memcpy (&a64, a, sizeof (a64));
+            memcpy (&b64, b, sizeof (b64));
+            return (a64 < b64) ? -1 : (a64 > b64);
+        default:
+            return memcmp (a, b, key->key_len);
+    }
+}
+
+static inline void std_radix_sort_copy (uint8_t *dst, const uint8_t *src,
+                            size_t rec_size)
+{
+    switch (rec_size)
+    {
+        case 4:  memcpy (dst, src, 4); break;
+        case 8:  memcpy (dst, src, 8); break;
+        case 16: memcpy (dst, src, 16); break;
+        case 24: memcpy (dst, src, 24); break;
+        case 32: memcpy (dst, src, 32); break;
+        default: memcpy (dst, src, rec_size); break;
+    }
+}
+
+/*******************************************************************************
+ * NAME          : std_radix_sort_pass
+ *
+ * DESCRIPTION   : One counting sort pass of src into dst on the byte at 'pos'
+ *                 in each record.  'count' is the histogram of that byte and
+ *                 is turned into the output offsets.
+ ***************************************************************************/
+static void std_radix_sort_pass (const uint8_t *src, uint8_t *dst,
+                            size_t num_records, size_t rec_size, size_t pos,
+                            size_t *count)
+{
+    size_t offset = 0;
+    size_t index;
+    size_t bucket;
+
+    for (bucket = 0; bucket < STD_RADIX_SORT_BUCKETS; bucket++)
+    {
+        size_t n = count[bucket];
+        count[bucket] = offset;
+        offset += n;
+    }
+
+    for (index = 0; index < num_records; index++)
+    {
+        const uint8_t *rec = src + index * rec_size;
+        std_radix_sort_copy (dst + count[rec[pos]]++ * rec_size, rec, rec_size);
+    }
+}
+
+/*******************************************************************************
+ * NAME          : std_radix_sort_core
+ *
+ * DESCRIPTION   : LSD radix sort.  positions[] lists the byte offsets in the
+ *                 record of the key bytes from least to most significant.
+ *                 The histograms of all key bytes are gathered in a single
+ *                 read of the array (when there are few enough key bytes),
+ *                 any byte that has the same value in every record is
+ *                 skipped, and the passes alternate between records and
+ *                 tmp_records.
+ ***************************************************************************/
+static void std_radix_sort_core (uint8_t *records, size_t num_records,
+                            size_t rec_size, const size_t *positions,
+                            size_t ndigits, uint8_t *tmp_records)
+{
+    size_t hist[STD_RADIX_SORT_MAX_HIST][STD_RADIX_SORT_BUCKETS];
+    uint8_t *src = records;
+    uint8_t *dst = tmp_records;
+    uint8_t *swap;
+    size_t digit, index, chunk;
+
+    for (chunk = 0; chunk < ndigits; chunk += STD_RADIX_SORT_MAX_HIST)
+    {
+        size_t count = ndigits - chunk;
+        if (count > STD_RADIX_SORT_MAX_HIST)
+            count = STD_RADIX_SORT_MAX_HIST;
+
+        memset (hist, 0, sizeof (hist[0]) * count);
+        for (index = 0; index < num_records; index++)
+        {
+            const uint8_t *rec = src + index * rec_size;
+            for (digit = 0; digit < count; digit++)
+                hist[digit][rec[positions[chunk + digit]]]++;
+        }
+
+        for (digit = 0; digit < count; digit++)
+        {
+            /* the byte is the same in all records - the pass would be a copy */
+            if (hist[digit][src[positions[chunk + digit]]] == num_records)
+                continue;
+
+            std_radix_sort_pass (src, dst, num_records, rec_size,
+                                 positions[chunk + digit], hist[digit]);
+            swap = src;
+            src = dst;
+            dst = swap;
+        }
+    }
+
+    if (src != records)
+        memcpy (records, src, num_records * rec_size);
+}
+
+static void std_radix_sort_small (void *records, size_t num_records,
+                            size_t rec_size, std_radix_key_t *key,
+                            void *tmp_records)
+{
+    std_merge_sort_elem (key, records, num_records, rec_size, tmp_records,
+                         std_radix_sort_key_cmp);
+}
+
+static void std_radix_sort_int (void *records, size_t num_records,
+                            size_t rec_size, size_t key_offset,
+                            size_t key_size, std_radix_key_type_t type,
+                            void *tmp_records)
+{
+    size_t positions[sizeof (uint64_t)];
+    size_t index;
+
+    if (num_records < STD_RADIX_SORT_MIN)
+    {
+        std_radix_key_t key = { type, key_offset, key_size };
+        std_radix_sort_small (records, num_records, rec_size, &key, tmp_records);
+        return;
+    }
+
+    /* least significant byte first */
+    for (index = 0; index < key_size; index++)
+    {
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        positions[index] = key_offset + index;
+#else
+        positions[index] = key_offset + key_size - 1 - index;
+#endif
+    }
+    std_radix_sort_core ((uint8_t *) records, num_records, rec_size,
+                         positions, key_size, (uint8_t *) tmp_records);
+}
+
+void std_radix_sort_u32 (void *records, size_t num_records, size_t rec_size,
+             size_t key_offset, void *tmp_records)
+{
+    std_radix_sort_int (records, num_records, rec_size, key_offset,
+                        sizeof (uint32_t), STD_RADIX_KEY_U32, tmp_records);
+}
+
+void std_radix_sort_u64 (void *records, size_t num_records, size_t rec_size,
+             size_t key_offset, void *tmp_records)
+{
+    std_radix_sort_int (records, num_records, rec_size, key_offset,
+                        sizeof (uint64_t), STD_RADIX_KEY_U64, tmp_records);
+}
+
+void std_radix_sort_bytes (void *records, size_t num_records, size_t rec_size,
+             size_t key_offset, size_t key_len, void *tmp_records)
+{
+    std_radix_key_t key = { STD_RADIX_KEY_BYTES, key_offset, key_len };
+    size_t *positions;
+    size_t index;
+
+    if (num_records < STD_RADIX_SORT_MIN)
+    {
+        std_radix_sort_small (records, num_records, rec_size, &key, tmp_records);
+        return;
+    }
+
+    positions = (size_t *) malloc (key_len * sizeof (*positions));
+    if (positions == NULL)
+    {
+        std_radix_sort_small (records, num_records, rec_size, &key, tmp_records);
+        return;
+    }
+
+    /* the last byte of the key is the least significant for memcmp order */
+    for (index = 0; index < key_len; index++)
+        positions[index] = key_offset + key_len - 1 - index;
+
+    std_radix_sort_core ((uint8_t *) records, num_records, rec_size,
+                         positions, key_len, (uint8_t *) tmp_records);
+    free (positions);
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_skiplist.c
+ */
+
+/*!
+ * \file   std_skiplist.c
+ * \brief  Sorted linked list with skip list express lanes
+ */
+
+#include "std_skiplist.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct _std_skiplist_link {
+    std_skiplist_node *next;
+    std_skiplist_node *prev;    //! NULL when the previous is the head
+} std_skiplist_link;
+
+/*
+ * Express lane links for a node - link[0] is the first lane above the
+ * base list.  Only allocated for nodes that are on at least one lane
+ */
+struct _std_skiplist_tower {
+    unsigned int levels;
+    std_skiplist_link link[];
+};
+
+static inline const void * key_of(std_skiplist_head *head, const void *node)
+{
+    return ((const char *)node) + head->list.offset;
+}
+
+static inline int node_cmp(std_skiplist_head *head, const void *lhs, const void *rhs)
+{
+    return head->list.compare(key_of(head, lhs), key_of(head, rhs), head->list.len);
+}
+
+static inline std_skiplist_node * lane_next(std_skiplist_head *head,
+                                            std_skiplist_node *x, unsigned int lvl)
+{
+    return (x == NULL) ? head->lanes[lvl] : x->tower->link[lvl].next;
+}
+
+/*
+ * Pick the number of lanes for a new node.  Each lane holds 1/4 of the
+ * nodes of the one below it
+ */
+static unsigned int random_levels(std_skiplist_head *head)
+{
+    uint32_t x = head->seed;
+    unsigned int levels = 0;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    head->seed = x;
+
+    while ((x & 3) == 0 && levels < STD_SKIPLIST_MAX_LEVEL) {
+        ++levels;
+        x >>= 2;
+    }
+    return levels;
+}
+
+/*
+ * Walk the lanes from the top and return the last base list node before the
+ * position of key.  When after_equal is set the position is after any nodes
+ * equal to the key (insert position) otherwise before them (search position).
+ * update (if not NULL) is filled with the last node on each lane before the
+ * position - NULL meaning the head
+ */
+static std_dll * find_position(std_skiplist_head *head, const void *key,
+                               bool after_equal, std_skiplist_node **update)
+{
+    std_skiplist_node *x = NULL;
+    std_skiplist_node *nxt;
+    std_dll *walk;
+    unsigned int lvl = head->levels;
+    int limit = after_equal ? 0 : -1;
+
+    while (lvl-- > 0) {
+        nxt = lane_next(head, x, lvl);
+        /* a node taken off the base list with std_dll_remove is still on the lanes */
+        assert(nxt == NULL || std_dll_islinked(&nxt->dll));
+        while (nxt != NULL && node_cmp(head, nxt, key) <= limit) {
+            x = nxt;
+            nxt = x->tower->link[lvl].next;
+            assert(nxt == NULL || std_dll_islinked(&nxt->dll));
+        }
+        if (update != NULL) update[lvl] = x;
+    }
+
+    /* finish on the base list - a handful of nodes on average */
+    walk = (x == NULL) ? &head->list.head : &x->dll;
+    while (walk->dll_next != &head->list.tail &&
+           node_cmp(head, walk->dll_next, key) <= limit)
+        walk = walk->dll_next;
+    return walk;
+}
+
+void std_skiplist_init(std_skiplist_head *head, std_compare_function compare,
+                       unsigned int offset, unsigned int len)
+{
+    std_dll_init_sort(&head->list, compare, offset, len);
+    memset(head->lanes, 0, sizeof(head->lanes));
+    head->levels = 0;
+    head->seed = 0x2545f491;
+    head->count = 0;
+}
+
+void std_skiplist_insert(std_skiplist_head *head, std_skiplist_node *node)
+{
+    std_skiplist_node *update[STD_SKIPLIST_MAX_LEVEL];
+    unsigned int levels = random_levels(head);
+    unsigned int lvl;
+    std_dll *after;
+
+    assert(head->list.compare != NULL);
+
+    after = find_position(head, node, true, update);
+    std_dll_insertafter(&head->list, after, &node->dll);
+    ++head->count;
+
+    node->tower = NULL;
+    if (levels == 0)
+        return;
+
+    /* if there is no memory the node just stays on the base list */
+    node->tower = (struct _std_skiplist_tower *)malloc(sizeof(*node->tower) +
+                        levels * sizeof(std_skiplist_link));
+    if (node->tower == NULL)
+        return;
+    node->tower->levels = levels;
+
+    for (lvl = head->levels; lvl < levels; ++lvl)
+        update[lvl] = NULL;
+    if (levels > head->levels)
+        head->levels = levels;
+
+    for (lvl = 0; lvl < levels; ++lvl) {
+        std_skiplist_link *link = &node->tower->link[lvl];
+        link->prev = update[lvl];
+        link->next = lane_next(head, update[lvl], lvl);
+        if (link->next != NULL)
+            link->next->tower->link[lvl].prev = node;
+        if (update[lvl] != NULL)
+            update[lvl]->tower->link[lvl].next = node;
+        else
+            head->lanes[lvl] = node;
+    }
+}
+
+void std_skiplist_remove(std_skiplist_head *head, std_skiplist_node *node)
+{
+    unsigned int lvl;
+
+    if (node->tower != NULL) {
+        for (lvl = 0; lvl < node->tower->levels; ++lvl) {
+            std_skiplist_link *link = &node->tower->link[lvl];
+            if (link->next != NULL)
+                link->next->tower->link[lvl].prev = link->prev;
+            if (link->prev != NULL)
+                link->prev->tower->link[lvl].next = link->next;
+            else
+                head->lanes[lvl] = link->next;
+        }
+        free(node->tower);
+        node->tower = NULL;
+
+        while (head->levels > 0 && head->lanes[head->levels - 1] == NULL)
+            --head->levels;
+    }
+
+    std_dll_remove(&head->list, &node->dll);
+    --head->count;
+}
+
+std_skiplist_node * std_skiplist_getexactornext(std_skiplist_head *head, const void *key_node)
+{
+    std_dll *before = find_position(head, key_node, false, NULL);
+
+    if (before->dll_next == &head->list.tail)
+        return NULL;
+    return (std_skiplist_node *)before->dll_next;
+}
+
+std_skiplist_node * std_skiplist_getexact(std_skiplist_head *head, const void *key_node)
+{
+    std_skiplist_node *node = std_skiplist_getexactornext(head, key_node);
+
+    if (node != NULL && node_cmp(head, node, key_node) != 0)
+        return NULL;
+    return node;
+}
+
+std_skiplist_node * std_skiplist_getfirst(std_skiplist_head *head)
+{
+    return (std_skiplist_node *)std_dll_getfirst(&head->list);
+}
+
+std_skiplist_node * std_skiplist_getnext(std_skiplist_head *head, std_skiplist_node *node)
+{
+    return (std_skiplist_node *)std_dll_getnext(&head->list, &node->dll);
+}
+
+size_t std_skiplist_count(std_skiplist_head *head)
+{
+    return head->count;
+}
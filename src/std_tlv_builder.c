@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_builder.c
+ */
+
+/*!
+ * \file   std_tlv_builder.c
+ * \brief  Growable TLV writer with nested TLVs and iovec output
+ */
+
+#include "std_tlv_builder.h"
+
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TLV_BUILDER_CHUNK   4096
+
+typedef struct tlv_chunk_s {
+    struct tlv_chunk_s *next;
+    size_t size;
+    size_t used;
+    uint8_t data[];
+} tlv_chunk_t;
+
+typedef struct {
+    uint8_t *hdr;       //! the header of the open TLV (in the arena)
+    size_t start;       //! message length after its header
+} tlv_open_t;
+
+struct std_tlv_builder_s {
+    size_t chunk_size;
+    tlv_chunk_t *chunks;    //! the arena - chunks before cur are full
+    tlv_chunk_t *cur;
+
+    struct iovec *iov;
+    size_t num_iov;
+    size_t cap_iov;
+    uint8_t *iov_end;       //! end of the last arena iovec - or NULL if the last is a reference
+
+    tlv_open_t *open;
+    size_t num_open;
+    size_t cap_open;
+
+    size_t len;
+    bool failed;            //! an add ran out of memory part way
+};
+
+std_tlv_builder_t * std_tlv_builder_create(size_t chunk_size) {
+    std_tlv_builder_t *b = (std_tlv_builder_t *)calloc(1, sizeof(*b));
+    if (b == NULL) return NULL;
+    b->chunk_size = chunk_size ? chunk_size : TLV_BUILDER_CHUNK;
+    return b;
+}
+
+void std_tlv_builder_free(std_tlv_builder_t *b) {
+    if (b == NULL) return;
+    while (b->chunks != NULL) {
+        tlv_chunk_t *next = b->chunks->next;
+        free(b->chunks);
+        b->chunks = next;
+    }
+    free(b->iov);
+    free(b->open);
+    free(b);
+}
+
+void std_tlv_builder_reset(std_tlv_builder_t *b) {
+    b->cur = b->chunks;
+    if (b->cur != NULL) b->cur->used = 0;
+    b->num_iov = 0;
+    b->iov_end = NULL;
+    b->num_open = 0;
+    b->len = 0;
+    b->failed = false;
+}
+
+/* take len contiguous bytes from the arena */
+static uint8_t * tlv_builder_alloc(std_tlv_builder_t *b, size_t len) {
+    tlv_chunk_t *c = b->cur;
+    uint8_t *p;
+
+    if (c == NULL || c->size - c->used < len) {
+        tlv_chunk_t *next = (c != NULL) ? c->next : b->chunks;
+        if (next == NULL || next->size < len) {
+            size_t size = (len > b->chunk_size) ? len : b->chunk_size;
+            tlv_chunk_t *n = (tlv_chunk_t *)malloc(sizeof(*n) + size);
+            if (n == NULL) return NULL;
+            n->size = size;
+            n->next = next;
+            if (c != NULL) c->next = n;
+            else b->chunks = n;
+            next = n;
+        }
+        next->used = 0;
+        b->cur = c = next;
+    }
+    p = c->data + c->used;
+    c->used += len;
+    return p;
+}
+
+static bool tlv_builder_push_iov(std_tlv_builder_t *b, const void *base, size_t len) {
+    if (b->num_iov == b->cap_iov) {
+        size_t cap = b->cap_iov ? b->cap_iov * 2 : 16;
+        struct iovec *iov = (struct iovec *)realloc(b->iov, cap * sizeof(*iov));
+        if (iov == NULL) return false;
+        b->iov = iov;
+        b->cap_iov = cap;
+    }
+    b->iov[b->num_iov].iov_base = (void *)base;
+    b->iov[b->num_iov].iov_len = len;
+    b->num_iov++;
+    return true;
+}
+
+/* copy len bytes into the message - returns where they went */
+static uint8_t * tlv_builder_reserve(std_tlv_builder_t *b, size_t len) {
+    uint8_t *p = tlv_builder_alloc(b, len);
+    if (p == NULL) return NULL;
+
+    if (p == b->iov_end) {
+        b->iov[b->num_iov - 1].iov_len += len;
+    } else if (!tlv_builder_push_iov(b, p, len)) {
+        /* give the space back */
+        b->cur->used -= len;
+        return NULL;
+    }
+    b->iov_end = p + len;
+    b->len += len;
+    return p;
+}
+
+static void tlv_builder_hdr(uint8_t *p, std_tlv_tag_t tag, size_t len) {
+    std_tlv_set_tag(p, tag);
+    std_tlv_set_len(p, len);
+}
+
+t_std_error std_tlv_builder_add(std_tlv_builder_t *b, std_tlv_tag_t tag, const void *data,
+        size_t len) {
+    uint8_t *p = tlv_builder_reserve(b, STD_TLV_HDR_LEN + len);
+    if (p == NULL) return STD_ERR(COM, NOMEM, 0);
+    tlv_builder_hdr(p, tag, len);
+    if (len > 0) memcpy(p + STD_TLV_HDR_LEN, data, len);
+    return STD_ERR_OK;
+}
+
+t_std_error std_tlv_builder_add_ref(std_tlv_builder_t *b, std_tlv_tag_t tag,
+        const void *data, size_t len) {
+    uint8_t *p = tlv_builder_reserve(b, STD_TLV_HDR_LEN);
+    if (p == NULL) return STD_ERR(COM, NOMEM, 0);
+    tlv_builder_hdr(p, tag, len);
+    if (len == 0) return STD_ERR_OK;
+
+    if (!tlv_builder_push_iov(b, data, len)) {
+        /* the header is in, the message can't be sent */
+        b->failed = true;
+        return STD_ERR(COM, NOMEM, 0);
+    }
+    b->iov_end = NULL;
+    b->len += len;
+    return STD_ERR_OK;
+}
+
+t_std_error std_tlv_builder_add_u16(std_tlv_builder_t *b, std_tlv_tag_t tag, uint16_t val) {
+    val = htole16(val);
+    return std_tlv_builder_add(b, tag, &val, sizeof(val));
+}
+
+t_std_error std_tlv_builder_add_u32(std_tlv_builder_t *b, std_tlv_tag_t tag, uint32_t val) {
+    val = htole32(val);
+    return std_tlv_builder_add(b, tag, &val, sizeof(val));
+}
+
+t_std_error std_tlv_builder_add_u64(std_tlv_builder_t *b, std_tlv_tag_t tag, uint64_t val) {
+    val = htole64(val);
+    return std_tlv_builder_add(b, tag, &val, sizeof(val));
+}
+
+t_std_error std_tlv_builder_open(std_tlv_builder_t *b, std_tlv_tag_t tag) {
+    uint8_t *p;
+
+    if (b->num_open == b->cap_open) {
+        size_t cap = b->cap_open ? b->cap_open * 2 : 8;
+        tlv_open_t *o = (tlv_open_t *)realloc(b->open, cap * sizeof(*o));
+        if (o == NULL) return STD_ERR(COM, NOMEM, 0);
+        b->open = o;
+        b->cap_open = cap;
+    }
+    p = tlv_builder_reserve(b, STD_TLV_HDR_LEN);
+    if (p == NULL) return STD_ERR(COM, NOMEM, 0);
+    tlv_builder_hdr(p, tag, 0);
+
+    b->open[b->num_open].hdr = p;
+    b->open[b->num_open].start = b->len;
+    b->num_open++;
+    return STD_ERR_OK;
+}
+
+t_std_error std_tlv_builder_close(std_tlv_builder_t *b) {
+    tlv_open_t *o;
+
+    if (b->num_open == 0) return STD_ERR(COM, PARAM, 0);
+    o = &b->open[--b->num_open];
+    /* the arena never moves so the header can be patched in place */
+    std_tlv_set_len(o->hdr, b->len - o->start);
+    return STD_ERR_OK;
+}
+
+size_t std_tlv_builder_len(const std_tlv_builder_t *b) {
+    return b->len;
+}
+
+t_std_error std_tlv_builder_iov(const std_tlv_builder_t *b, const struct iovec **iov,
+        size_t *count) {
+    if (b->num_open != 0) return STD_ERR(COM, PARAM, 0);
+    if (b->failed) return STD_ERR(COM, FAIL, 0);
+    *iov = b->iov;
+    *count = b->num_iov;
+    return STD_ERR_OK;
+}
+
+t_std_error std_tlv_builder_copy(const std_tlv_builder_t *b, void *buf, size_t len) {
+    const struct iovec *iov;
+    size_t count, ix;
+    uint8_t *p = (uint8_t *)buf;
+    t_std_error rc = std_tlv_builder_iov(b, &iov, &count);
+
+    if (rc != STD_ERR_OK) return rc;
+    if (len < b->len) return STD_ERR(COM, TOOBIG, 0);
+    for (ix = 0; ix < count; ++ix) {
+        memcpy(p, iov[ix].iov_base, iov[ix].iov_len);
+        p += iov[ix].iov_len;
+    }
+    return STD_ERR_OK;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_index.c
+ */
+
+/*!
+ * \file   std_tlv_index.c
+ * \brief  Tag index over a TLV buffer
+ */
+
+#include "std_tlv_index.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TLV_IX_NOT_BUILT    0
+#define TLV_IX_INVALID      UINT32_MAX
+
+typedef struct {
+    std_tlv_tag_t tag;
+    size_t pos;         //! offset of the TLV in the buffer
+    uint32_t level;     //! level of the TLVs in the value, TLV_IX_NOT_BUILT or TLV_IX_INVALID
+} tlv_ix_entry_t;
+
+/* one run of TLVs - the entries of a level are contiguous and sorted by tag */
+typedef struct {
+    size_t first;
+    size_t count;
+    size_t end;         //! offset of the end of the level in the buffer
+} tlv_ix_level_t;
+
+struct std_tlv_index_s {
+    uint8_t *data;
+    size_t len;
+    tlv_ix_entry_t *entries;
+    size_t num_entries;
+    size_t cap_entries;
+    tlv_ix_level_t *levels;
+    size_t num_levels;
+    size_t cap_levels;
+};
+
+std_tlv_index_t * std_tlv_index_create(void) {
+    return (std_tlv_index_t *)calloc(1, sizeof(std_tlv_index_t));
+}
+
+void std_tlv_index_free(std_tlv_index_t *idx) {
+    if (idx == NULL) return;
+    free(idx->entries);
+    free(idx->levels);
+    free(idx);
+}
+
+static int tlv_ix_cmp(const void *a, const void *b) {
+    const tlv_ix_entry_t *ea = (const tlv_ix_entry_t *)a;
+    const tlv_ix_entry_t *eb = (const tlv_ix_entry_t *)b;
+    if (ea->tag != eb->tag) return ea->tag < eb->tag ? -1 : 1;
+    return ea->pos < eb->pos ? -1 : (ea->pos > eb->pos);
+}
+
+static bool tlv_ix_sorted(const tlv_ix_entry_t *e, size_t n) {
+    size_t ix;
+    for (ix = 1; ix < n; ++ix) {
+        if (e[ix].tag < e[ix - 1].tag) return false;
+    }
+    return true;
+}
+
+/*
+ * Index the TLVs in [pos, end) of the buffer as a new level.  Returns the
+ * level, TLV_IX_INVALID if the TLVs don't fill the space exactly or
+ * TLV_IX_NOT_BUILT if out of memory
+ */
+static uint32_t tlv_ix_add_level(std_tlv_index_t *idx, size_t pos, size_t end) {
+    size_t first = idx->num_entries;
+    tlv_ix_level_t *lvl;
+
+    if (idx->num_levels == idx->cap_levels) {
+        size_t cap = idx->cap_levels ? idx->cap_levels * 2 : 8;
+        tlv_ix_level_t *l = (tlv_ix_level_t *)realloc(idx->levels, cap * sizeof(*l));
+        if (l == NULL) return TLV_IX_NOT_BUILT;
+        idx->levels = l;
+        idx->cap_levels = cap;
+    }
+
+    while (pos < end) {
+        size_t left = end - pos;
+        std_tlv_len_t vlen;
+        tlv_ix_entry_t *e;
+
+        if (left < STD_TLV_HDR_LEN) break;
+        vlen = std_tlv_len(idx->data + pos);
+        if (vlen > left - STD_TLV_HDR_LEN) break;
+
+        if (idx->num_entries == idx->cap_entries) {
+            size_t cap = idx->cap_entries ? idx->cap_entries * 2 : 64;
+            e = (tlv_ix_entry_t *)realloc(idx->entries, cap * sizeof(*e));
+            if (e == NULL) {
+                idx->num_entries = first;
+                return TLV_IX_NOT_BUILT;
+            }
+            idx->entries = e;
+            idx->cap_entries = cap;
+        }
+        e = &idx->entries[idx->num_entries++];
+        e->tag = std_tlv_tag(idx->data + pos);
+        e->pos = pos;
+        e->level = TLV_IX_NOT_BUILT;
+        pos += STD_TLV_HDR_LEN + (size_t)vlen;
+    }
+    if (pos != end) {
+        idx->num_entries = first;
+        return TLV_IX_INVALID;
+    }
+
+    /* messages are often already in tag order */
+    if (!tlv_ix_sorted(&idx->entries[first], idx->num_entries - first)) {
+        qsort(&idx->entries[first], idx->num_entries - first, sizeof(tlv_ix_entry_t),
+              tlv_ix_cmp);
+    }
+
+    lvl = &idx->levels[idx->num_levels];
+    lvl->first = first;
+    lvl->count = idx->num_entries - first;
+    lvl->end = end;
+    return (uint32_t)idx->num_levels++;
+}
+
+t_std_error std_tlv_index_build(std_tlv_index_t *idx, void *data, size_t len) {
+    uint32_t level;
+
+    idx->data = (uint8_t *)data;
+    idx->len = len;
+    idx->num_entries = 0;
+    /* level 0 is the top level, so TLV_IX_NOT_BUILT can't be a real child */
+    idx->num_levels = 0;
+
+    level = tlv_ix_add_level(idx, 0, len);
+    if (level == TLV_IX_INVALID) {
+        idx->len = 0;
+        return STD_ERR(COM, PARAM, 0);
+    }
+    if (idx->num_levels == 0) {
+        idx->len = 0;
+        return STD_ERR(COM, NOMEM, 0);
+    }
+    return STD_ERR_OK;
+}
+
+/* index of the first entry in the level with the tag or SIZE_MAX */
+static size_t tlv_ix_lookup(const std_tlv_index_t *idx, size_t level, std_tlv_tag_t tag) {
+    const tlv_ix_level_t *lvl;
+    size_t lo, hi;
+
+    if (level >= idx->num_levels) return SIZE_MAX;
+    lvl = &idx->levels[level];
+    lo = lvl->first;
+    hi = lvl->first + lvl->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idx->entries[mid].tag < tag) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < lvl->first + lvl->count && idx->entries[lo].tag == tag) return lo;
+    return SIZE_MAX;
+}
+
+void * std_tlv_index_find(std_tlv_index_t *idx, std_tlv_tag_t tag) {
+    size_t ix = tlv_ix_lookup(idx, 0, tag);
+    return (ix == SIZE_MAX) ? NULL : idx->data + idx->entries[ix].pos;
+}
+
+size_t std_tlv_index_find_all(std_tlv_index_t *idx, std_tlv_tag_t tag, void **tlvs,
+        size_t max) {
+    size_t ix = tlv_ix_lookup(idx, 0, tag);
+    size_t end, count = 0;
+
+    if (ix == SIZE_MAX) return 0;
+    end = idx->levels[0].first + idx->levels[0].count;
+    for ( ; ix < end && idx->entries[ix].tag == tag; ++ix, ++count) {
+        if (count < max) tlvs[count] = idx->data + idx->entries[ix].pos;
+    }
+    return count;
+}
+
+void * std_tlv_index_efind(std_tlv_index_t *idx, const std_tlv_tag_t *tags, size_t tlen,
+        size_t *dlen) {
+    size_t level = 0;
+    size_t ix = SIZE_MAX;
+    size_t t;
+
+    for (t = 0; t < tlen; ++t) {
+        ix = tlv_ix_lookup(idx, level, tags[t]);
+        if (ix == SIZE_MAX) return NULL;
+        if (t + 1 == tlen) break;
+
+        if (idx->entries[ix].level == TLV_IX_NOT_BUILT) {
+            size_t pos = idx->entries[ix].pos;
+            size_t vlen = (size_t)std_tlv_len(idx->data + pos);
+            /* entries can move when the new level is added */
+            uint32_t child = tlv_ix_add_level(idx, pos + STD_TLV_HDR_LEN,
+                                              pos + STD_TLV_HDR_LEN + vlen);
+            if (child == TLV_IX_NOT_BUILT) return NULL;
+            idx->entries[ix].level = child;
+        }
+        if (idx->entries[ix].level == TLV_IX_INVALID) return NULL;
+        level = idx->entries[ix].level;
+    }
+    if (ix == SIZE_MAX) return NULL;
+
+    *dlen = idx->levels[level].end - idx->entries[ix].pos;
+    return idx->data + idx->entries[ix].pos;
+}
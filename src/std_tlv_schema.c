@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_schema.c
+ */
+
+/*!
+ * \file   std_tlv_schema.c
+ * \brief  Validate TLV buffers once and extract many attributes in one scan
+ */
+
+#include "std_tlv_schema.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* nesting deeper than this is taken as a bad buffer */
+#define TLV_SCHEMA_MAX_DEPTH    64
+
+/* tags below this are looked up directly rather than with a binary search */
+#define TLV_SCHEMA_DIRECT_MAX   1024
+
+struct std_tlv_schema_s {
+    std_tlv_field_t *fields;    //! sorted by tag
+    size_t num;
+    uint16_t *direct;           //! field index + 1 by tag or NULL if the tags are too big
+    size_t direct_len;
+    size_t *order;              //! the caller's index of each sorted field
+};
+
+/* the length of the TLV at p or SIZE_MAX if it doesn't fit in left */
+static inline size_t tlv_checked_len(void *p, size_t left) {
+    std_tlv_len_t vlen;
+    if (left < STD_TLV_HDR_LEN) return SIZE_MAX;
+    vlen = std_tlv_len(p);
+    if (vlen > left - STD_TLV_HDR_LEN) return SIZE_MAX;
+    return (size_t)vlen;
+}
+
+static bool tlv_validate_level(uint8_t *p, size_t len, std_tlv_nested_fn nested,
+        void *context, int depth) {
+    if (depth > TLV_SCHEMA_MAX_DEPTH) return false;
+    while (len > 0) {
+        size_t vlen = tlv_checked_len(p, len);
+        if (vlen == SIZE_MAX) return false;
+        if (nested != NULL && nested(context, std_tlv_tag(p)) &&
+            !tlv_validate_level(p + STD_TLV_HDR_LEN, vlen, nested, context, depth + 1)) {
+            return false;
+        }
+        p += STD_TLV_HDR_LEN + vlen;
+        len -= STD_TLV_HDR_LEN + vlen;
+    }
+    return true;
+}
+
+t_std_error std_tlv_validate(void *data, size_t len, std_tlv_nested_fn nested,
+        void *context) {
+    if (len > 0 && data == NULL) return STD_ERR(COM, PARAM, 0);
+    if (!tlv_validate_level((uint8_t *)data, len, nested, context, 0))
+        return STD_ERR(COM, PARAM, 0);
+    return STD_ERR_OK;
+}
+
+static int tlv_field_cmp(const void *a, const void *b) {
+    std_tlv_tag_t ta = ((const std_tlv_field_t *)a)->tag;
+    std_tlv_tag_t tb = ((const std_tlv_field_t *)b)->tag;
+    return (ta < tb) ? -1 : (ta > tb);
+}
+
+void std_tlv_schema_free(std_tlv_schema_t *schema) {
+    if (schema == NULL) return;
+    free(schema->fields);
+    free(schema->direct);
+    free(schema->order);
+    free(schema);
+}
+
+std_tlv_schema_t * std_tlv_schema_create(const std_tlv_field_t *fields, size_t num) {
+    std_tlv_schema_t *s = (std_tlv_schema_t *)calloc(1, sizeof(*s));
+    size_t ix, jx;
+
+    if (s == NULL) return NULL;
+    s->num = num;
+    s->fields = (std_tlv_field_t *)malloc((num ? num : 1) * sizeof(*fields));
+    s->order = (size_t *)malloc((num ? num : 1) * sizeof(size_t));
+    if (s->fields == NULL || s->order == NULL || num >= UINT16_MAX) {
+        std_tlv_schema_free(s);
+        return NULL;
+    }
+    memcpy(s->fields, fields, num * sizeof(*fields));
+    qsort(s->fields, num, sizeof(*fields), tlv_field_cmp);
+
+    for (ix = 0; ix < num; ++ix) {
+        if (ix > 0 && s->fields[ix].tag == s->fields[ix - 1].tag) {
+            std_tlv_schema_free(s);
+            return NULL;
+        }
+        /* remember where each field was in the caller's list for 'found' */
+        for (jx = 0; fields[jx].tag != s->fields[ix].tag; ++jx) ;
+        s->order[ix] = jx;
+    }
+
+    if (num > 0 && s->fields[num - 1].tag < TLV_SCHEMA_DIRECT_MAX) {
+        s->direct_len = (size_t)s->fields[num - 1].tag + 1;
+        s->direct = (uint16_t *)calloc(s->direct_len, sizeof(uint16_t));
+        if (s->direct == NULL) {
+            std_tlv_schema_free(s);
+            return NULL;
+        }
+        for (ix = 0; ix < num; ++ix) s->direct[s->fields[ix].tag] = (uint16_t)(ix + 1);
+    }
+    return s;
+}
+
+/* index of the field with the tag or SIZE_MAX */
+static inline size_t tlv_schema_lookup(const std_tlv_schema_t *s, std_tlv_tag_t tag) {
+    size_t lo = 0, hi = s->num;
+
+    if (s->direct != NULL) {
+        return (tag < s->direct_len) ? (size_t)s->direct[tag] - 1 : SIZE_MAX;
+    }
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (s->fields[mid].tag < tag) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < s->num && s->fields[lo].tag == tag) ? lo : SIZE_MAX;
+}
+
+static t_std_error tlv_extract_level(const std_tlv_schema_t *s, uint8_t *p, size_t len,
+        uint8_t *obj, bool *found, int depth) {
+    if (depth > TLV_SCHEMA_MAX_DEPTH) return STD_ERR(COM, PARAM, 0);
+
+    while (len > 0) {
+        size_t vlen = tlv_checked_len(p, len);
+        uint8_t *val = p + STD_TLV_HDR_LEN;
+        const std_tlv_field_t *f;
+        size_t ix;
+
+        if (vlen == SIZE_MAX) return STD_ERR(COM, PARAM, 0);
+        ix = tlv_schema_lookup(s, std_tlv_tag(p));
+        p += STD_TLV_HDR_LEN + vlen;
+        len -= STD_TLV_HDR_LEN + vlen;
+        if (ix == SIZE_MAX) continue;
+
+        f = &s->fields[ix];
+        switch (f->type) {
+        case STD_TLV_FIELD_U8:
+            if (vlen != sizeof(uint8_t)) return STD_ERR(COM, PARAM, 0);
+            obj[f->offset] = *val;
+            break;
+        case STD_TLV_FIELD_U16: {
+            uint16_t v;
+            if (vlen != sizeof(v)) return STD_ERR(COM, PARAM, 0);
+            memcpy(&v, val, sizeof(v));
+            v = le16toh(v);
+            memcpy(obj + f->offset, &v, sizeof(v));
+            break;
+        }
+        case STD_TLV_FIELD_U32: {
+            uint32_t v;
+            if (vlen != sizeof(v)) return STD_ERR(COM, PARAM, 0);
+            memcpy(&v, val, sizeof(v));
+            v = le32toh(v);
+            memcpy(obj + f->offset, &v, sizeof(v));
+            break;
+        }
+        case STD_TLV_FIELD_U64: {
+            uint64_t v;
+            if (vlen != sizeof(v)) return STD_ERR(COM, PARAM, 0);
+            memcpy(&v, val, sizeof(v));
+            v = le64toh(v);
+            memcpy(obj + f->offset, &v, sizeof(v));
+            break;
+        }
+        case STD_TLV_FIELD_BYTES:
+            if (vlen > f->size) return STD_ERR(COM, TOOBIG, 0);
+            memcpy(obj + f->offset, val, vlen);
+            break;
+        case STD_TLV_FIELD_PTR:
+            memcpy(obj + f->offset, &val, sizeof(val));
+            break;
+        case STD_TLV_FIELD_NESTED: {
+            t_std_error rc;
+            if (f->nested == NULL) break;
+            rc = tlv_extract_level(f->nested, val, vlen, obj, NULL, depth + 1);
+            if (rc != STD_ERR_OK) return rc;
+            break;
+        }
+        default:
+            return STD_ERR(COM, PARAM, 0);
+        }
+        if (f->len_offset != STD_TLV_NO_FIELD) memcpy(obj + f->len_offset, &vlen, sizeof(vlen));
+        if (found != NULL) found[s->order[ix]] = true;
+    }
+    return STD_ERR_OK;
+}
+
+t_std_error std_tlv_extract(const std_tlv_schema_t *schema, void *data, size_t len,
+        void *obj, bool *found) {
+    if (found != NULL) memset(found, 0, schema->num * sizeof(*found));
+    if (len > 0 && data == NULL) return STD_ERR(COM, PARAM, 0);
+    return tlv_extract_level(schema, (uint8_t *)data, len, (uint8_t *)obj, found, 0);
+}
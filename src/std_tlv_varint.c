@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_varint.c
+ */
+
+/*!
+ * \file   std_tlv_varint.c
+ * \brief  Conversion between the std_tlv and varint TLV formats
+ */
+
+#include "std_tlv_varint.h"
+
+#include <stdint.h>
+
+/* nesting deeper than this is taken as a bad message */
+#define VTLV_MAX_DEPTH  64
+
+typedef struct {
+    bool from_varint;
+    std_tlv_nested_fn nested;
+    void *context;
+} vtlv_conv_t;
+
+/* read a header in the source format checking it against the space left */
+static size_t vtlv_read_hdr(const vtlv_conv_t *cv, uint8_t *p, size_t left,
+        std_tlv_tag_t *tag, size_t *len) {
+    uint64_t vlen;
+    size_t hlen;
+
+    if (cv->from_varint) {
+        size_t tl, ll;
+        if ((tl = std_vtlv_get_varint(p, left, tag)) == 0) return 0;
+        if ((ll = std_vtlv_get_varint(p + tl, left - tl, &vlen)) == 0) return 0;
+        hlen = tl + ll;
+    } else {
+        if (left < STD_TLV_HDR_LEN) return 0;
+        *tag = std_tlv_tag(p);
+        vlen = std_tlv_len(p);
+        hlen = STD_TLV_HDR_LEN;
+    }
+    if (vlen > left - hlen) return 0;
+    *len = (size_t)vlen;
+    return hlen;
+}
+
+static size_t vtlv_hdr_size(const vtlv_conv_t *cv, std_tlv_tag_t tag, size_t len) {
+    if (cv->from_varint) return STD_TLV_HDR_LEN;
+    return std_vtlv_varint_len(tag) + std_vtlv_varint_len(len);
+}
+
+static size_t vtlv_write_hdr(const vtlv_conv_t *cv, uint8_t *p, std_tlv_tag_t tag, size_t len) {
+    if (cv->from_varint) {
+        std_tlv_set_tag(p, tag);
+        std_tlv_set_len(p, len);
+        return STD_TLV_HDR_LEN;
+    }
+    p += std_vtlv_put_varint(p, tag);
+    std_vtlv_put_varint(p, len);
+    return std_vtlv_varint_len(tag) + std_vtlv_varint_len(len);
+}
+
+static bool vtlv_is_nested(const vtlv_conv_t *cv, std_tlv_tag_t tag) {
+    return cv->nested != NULL && cv->nested(cv->context, tag);
+}
+
+/* the size of the TLVs in [p, p+len) once converted or SIZE_MAX if they aren't valid */
+static size_t vtlv_conv_size(const vtlv_conv_t *cv, uint8_t *p, size_t len, int depth) {
+    size_t total = 0;
+
+    if (depth > VTLV_MAX_DEPTH) return SIZE_MAX;
+    while (len > 0) {
+        std_tlv_tag_t tag;
+        size_t vlen, out;
+        size_t hlen = vtlv_read_hdr(cv, p, len, &tag, &vlen);
+        if (hlen == 0) return SIZE_MAX;
+
+        out = vlen;
+        if (vtlv_is_nested(cv, tag)) {
+            out = vtlv_conv_size(cv, p + hlen, vlen, depth + 1);
+            if (out == SIZE_MAX) return SIZE_MAX;
+        }
+        total += vtlv_hdr_size(cv, tag, out) + out;
+        p += hlen + vlen;
+        len -= hlen + vlen;
+    }
+    return total;
+}
+
+/* convert TLVs that vtlv_conv_size has checked - returns the bytes written */
+static size_t vtlv_conv_write(const vtlv_conv_t *cv, uint8_t *p, size_t len, uint8_t *dst) {
+    uint8_t *start = dst;
+
+    while (len > 0) {
+        std_tlv_tag_t tag;
+        size_t vlen;
+        size_t hlen = vtlv_read_hdr(cv, p, len, &tag, &vlen);
+
+        if (vtlv_is_nested(cv, tag)) {
+            size_t out = vtlv_conv_size(cv, p + hlen, vlen, 0);
+            dst += vtlv_write_hdr(cv, dst, tag, out);
+            dst += vtlv_conv_write(cv, p + hlen, vlen, dst);
+        } else {
+            dst += vtlv_write_hdr(cv, dst, tag, vlen);
+            memcpy(dst, p + hlen, vlen);
+            dst += vlen;
+        }
+        p += hlen + vlen;
+        len -= hlen + vlen;
+    }
+    return dst - start;
+}
+
+static t_std_error vtlv_convert(const vtlv_conv_t *cv, uint8_t *src, size_t src_len,
+        uint8_t *dst, size_t *dst_len, size_t prefix) {
+    size_t size = vtlv_conv_size(cv, src, src_len, 0);
+
+    if (size == SIZE_MAX) return STD_ERR(COM, PARAM, 0);
+    size += prefix;
+    if (dst != NULL) {
+        if (*dst_len < size) return STD_ERR(COM, TOOBIG, 0);
+        if (prefix > 0) memcpy(dst, STD_VTLV_MAGIC, STD_VTLV_MAGIC_LEN);
+        vtlv_conv_write(cv, src, src_len, dst + prefix);
+    }
+    *dst_len = size;
+    return STD_ERR_OK;
+}
+
+t_std_error std_tlv_to_vtlv(void *src, size_t src_len, void *dst, size_t *dst_len,
+        std_tlv_nested_fn nested, void *context) {
+    vtlv_conv_t cv = { false, nested, context };
+    return vtlv_convert(&cv, (uint8_t *)src, src_len, (uint8_t *)dst, dst_len,
+                        STD_VTLV_MAGIC_LEN);
+}
+
+t_std_error std_vtlv_to_tlv(void *src, size_t src_len, void *dst, size_t *dst_len,
+        std_tlv_nested_fn nested, void *context) {
+    vtlv_conv_t cv = { true, nested, context };
+    uint8_t *first = (uint8_t *)std_vtlv_first(src, &src_len);
+    if (first == NULL) return STD_ERR(COM, PARAM, 0);
+    return vtlv_convert(&cv, first, src_len, (uint8_t *)dst, dst_len, 0);
+}
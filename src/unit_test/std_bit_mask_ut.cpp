@@ -29,6 +29,9 @@
 
 #include "gtest/gtest.h"
 
+#include <thread>
+#include <vector>
+
 TEST(std_bit_masks, function){
     STD_BIT_ARRAY_CREATE(t,100);
     memset(t,0,sizeof(t));
@@ -114,6 +117,222 @@ TEST(std_bit_masks, macros){
 
 
 
+/*
+ * The byte at a time search the word and vector scans replaced - the new ones
+ * have to give exactly the same answers
+ */
+static int ref_find_first_bit(const uint8_t *array, size_t len, size_t from) {
+    if (from >= len) return -1;
+    size_t mx = (len/8) + ((len%8)!=0 ? 1 : 0);
+    for (size_t bit = from; bit < mx*8 ; ++bit) {
+        if (STD_BIT_ARRAY_TEST(array,bit)) return bit;
+    }
+    return -1;
+}
+
+static int ref_find_last_bit(const uint8_t *array, size_t len, size_t from) {
+    if (from >= len) return -1;
+    from = len - from;
+    size_t mx = (from/8) + ((from%8)!=0 ? 1 : 0);
+    for (size_t bit = mx*8; bit > 0 ; --bit) {
+        if (STD_BIT_ARRAY_TEST(array,bit-1)) return bit-1;
+    }
+    return -1;
+}
+
+TEST(std_bit_masks, scan_matches_reference){
+    const size_t lens[] = { 1, 7, 8, 9, 63, 64, 65, 100, 255, 4096, 4099, 65536 };
+    std::vector<uint8_t> bits(65536/8 + 1);
+
+    for (size_t len : lens) {
+        size_t bytes = STD_BYTES_FOR_BITS(len);
+        for (int density = 0; density < 4 ; ++density) {
+            /* sparse, single bit, dense and almost full */
+            memset(bits.data(),density==3 ? 0xff : 0,bytes);
+            if (density==1) STD_BIT_ARRAY_SET(bits.data(),rand()%len);
+            if (density==0) {
+                for (int ix = 0; ix < 3 ; ++ix) STD_BIT_ARRAY_SET(bits.data(),rand()%len);
+            }
+            if (density==2) {
+                for (size_t ix = 0; ix < bytes ; ++ix) bits[ix] = rand();
+            }
+            if (density==3) STD_BIT_ARRAY_CLR(bits.data(),rand()%len);
+
+            for (int ix = 0; ix < 50 ; ++ix) {
+                size_t from = rand() % (len + 2);
+                ASSERT_EQ(ref_find_first_bit(bits.data(),len,from),
+                          std_find_first_bit(bits.data(),len,from));
+                ASSERT_EQ(ref_find_last_bit(bits.data(),len,from),
+                          std_find_last_bit(bits.data(),len,from));
+
+                int zero = -1;
+                for (size_t bit = from; bit < len ; ++bit) {
+                    if (!STD_BIT_ARRAY_TEST(bits.data(),bit)) { zero = bit; break; }
+                }
+                ASSERT_EQ(zero,std_find_first_zero_bit(bits.data(),len,from));
+            }
+
+            size_t count = 0;
+            int last = -1;
+            for (int bit = std_find_next_set_bit(bits.data(),len,-1); bit >= 0;
+                    bit = std_find_next_set_bit(bits.data(),len,bit)) {
+                ASSERT_GT(bit,last);
+                ASSERT_LT((size_t)bit,len);
+                ASSERT_TRUE(STD_BIT_ARRAY_TEST(bits.data(),bit));
+                last = bit;
+                ++count;
+            }
+            size_t expect = 0;
+            for (size_t bit = 0; bit < len ; ++bit) expect += STD_BIT_ARRAY_TEST(bits.data(),bit);
+            ASSERT_EQ(expect,count);
+        }
+    }
+}
+
+TEST(std_bit_masks, bulk_ops){
+    const size_t lens[] = { 1, 9, 64, 100, 257, 4096, 4099 };
+
+    for (size_t len : lens) {
+        size_t bytes = STD_BYTES_FOR_BITS(len);
+        std::vector<uint8_t> a(bytes), b(bytes), dst(bytes);
+        for (size_t ix = 0; ix < bytes ; ++ix) {
+            a[ix] = rand();
+            b[ix] = rand() & rand();
+        }
+
+        std_bitmap_and(dst.data(),a.data(),b.data(),len);
+        for (size_t ix = 0; ix < bytes ; ++ix) ASSERT_EQ((uint8_t)(a[ix] & b[ix]),dst[ix]);
+        std_bitmap_or(dst.data(),a.data(),b.data(),len);
+        for (size_t ix = 0; ix < bytes ; ++ix) ASSERT_EQ((uint8_t)(a[ix] | b[ix]),dst[ix]);
+        std_bitmap_xor(dst.data(),a.data(),b.data(),len);
+        for (size_t ix = 0; ix < bytes ; ++ix) ASSERT_EQ((uint8_t)(a[ix] ^ b[ix]),dst[ix]);
+        std_bitmap_andnot(dst.data(),a.data(),b.data(),len);
+        for (size_t ix = 0; ix < bytes ; ++ix) ASSERT_EQ((uint8_t)(a[ix] & ~b[ix]),dst[ix]);
+
+        size_t count = 0;
+        bool common = false;
+        for (size_t bit = 0; bit < len ; ++bit) {
+            count += STD_BIT_ARRAY_TEST(a.data(),bit);
+            common |= STD_BIT_ARRAY_TEST(a.data(),bit) && STD_BIT_ARRAY_TEST(b.data(),bit);
+        }
+        ASSERT_EQ(count,std_bitmap_popcount(a.data(),len));
+        ASSERT_EQ(common,std_bitmap_intersects(a.data(),b.data(),len));
+
+        /* a & b is a subset of a and equal to itself, bits past len don't count */
+        std_bitmap_and(dst.data(),a.data(),b.data(),len);
+        ASSERT_TRUE(std_bitmap_is_subset(dst.data(),a.data(),len));
+        std::vector<uint8_t> copy(dst);
+        if (len % 8) copy[bytes-1] ^= 0x80;
+        ASSERT_TRUE(std_bitmap_equal(dst.data(),copy.data(),len));
+        STD_BIT_ARRAY_SET(copy.data(),len-1);
+        STD_BIT_ARRAY_CLR(dst.data(),len-1);
+        ASSERT_FALSE(std_bitmap_equal(dst.data(),copy.data(),len));
+        ASSERT_FALSE(std_bitmap_is_subset(copy.data(),dst.data(),len));
+        ASSERT_TRUE(std_bitmap_is_subset(dst.data(),copy.data(),len));
+
+        /* walk the set bits in small batches */
+        std::vector<uint32_t> expect;
+        for (size_t bit = 0; bit < len ; ++bit) {
+            if (STD_BIT_ARRAY_TEST(b.data(),bit)) expect.push_back(bit);
+        }
+        std::vector<uint32_t> got;
+        uint32_t pos[7];
+        size_t from = 0;
+        size_t n;
+        while ((n = std_bitmap_get_set_bits(b.data(),len,&from,pos,7)) > 0) {
+            got.insert(got.end(),pos,pos+n);
+        }
+        ASSERT_EQ(expect,got);
+    }
+}
+
+TEST(std_bit_masks, get_set_bits_sparse){
+    std::vector<uint8_t> a(65536/8);
+    STD_BIT_ARRAY_SET(a.data(),3);
+    STD_BIT_ARRAY_SET(a.data(),40000);
+    STD_BIT_ARRAY_SET(a.data(),65535);
+
+    uint32_t pos[8];
+    size_t from = 4;
+    ASSERT_EQ(2,std_bitmap_get_set_bits(a.data(),65536,&from,pos,8));
+    ASSERT_EQ(40000,pos[0]);
+    ASSERT_EQ(65535,pos[1]);
+    ASSERT_EQ(0,std_bitmap_get_set_bits(a.data(),65536,&from,pos,8));
+}
+
+TEST(std_bit_masks, atomic_layout){
+    STD_BIT_ARRAY_ATOMIC_CREATE(a,200);
+    memset(a,0,sizeof(a));
+    ASSERT_EQ(4*sizeof(uint64_t),sizeof(a));
+
+    for (size_t bit = 0; bit < 200 ; bit += 7) {
+        ASSERT_FALSE(std_bit_atomic_test_and_set(a,bit,__ATOMIC_SEQ_CST));
+        ASSERT_TRUE(std_bit_atomic_test_and_set(a,bit,__ATOMIC_SEQ_CST));
+        ASSERT_TRUE(STD_BIT_ARRAY_TEST(a,bit));
+        ASSERT_TRUE(std_bit_atomic_test(a,bit,__ATOMIC_ACQUIRE));
+    }
+    ASSERT_EQ(29,std_bitmap_popcount(a,200));
+    ASSERT_EQ(7,std_find_next_set_bit(a,200,0));
+
+    STD_BIT_ARRAY_SET(a,101);
+    ASSERT_TRUE(std_bit_atomic_test_and_clear(a,101,__ATOMIC_SEQ_CST));
+    ASSERT_FALSE(std_bit_atomic_test_and_clear(a,101,__ATOMIC_SEQ_CST));
+    std_bit_atomic_set(a,102,__ATOMIC_RELEASE);
+    ASSERT_TRUE(STD_BIT_ARRAY_TEST(a,102));
+    std_bit_atomic_clear(a,102,__ATOMIC_RELEASE);
+    ASSERT_FALSE(STD_BIT_ARRAY_TEST(a,102));
+
+    ASSERT_EQ(1,std_bit_atomic_find_and_set_first_clear(a,200,0,__ATOMIC_ACQ_REL));
+    ASSERT_EQ(64,std_bit_atomic_find_and_set_first_clear(a,200,63,__ATOMIC_ACQ_REL));
+    ASSERT_TRUE(STD_BIT_ARRAY_TEST(a,64));
+
+    /* fill the array - the bits past len are never handed out */
+    while (std_bit_atomic_find_and_set_first_clear(a,200,0,__ATOMIC_ACQ_REL) >= 0) ;
+    ASSERT_EQ(200,std_bitmap_popcount(a,200));
+    ASSERT_EQ(-1,std_find_first_zero_bit(a,200,0));
+    ASSERT_FALSE(STD_BIT_ARRAY_TEST(a,200));
+}
+
+TEST(std_bit_masks, atomic_threads){
+    const size_t len = 100000;
+    const int threads = 8;
+    void *claimed = std_bitmap_create_atomic_array(len);
+    void *flags = std_bitmap_create_atomic_array(len);
+    ASSERT_TRUE(claimed!=NULL && flags!=NULL);
+    std::vector<std::vector<int>> got(threads);
+    std::vector<std::thread> th;
+
+    for (int t = 0; t < threads ; ++t) {
+        th.push_back(std::thread([&,t]() {
+            int bit;
+            while ((bit = std_bit_atomic_find_and_set_first_clear(claimed,len,
+                    (t*len)/threads,__ATOMIC_ACQ_REL)) >= 0 ||
+                   (bit = std_bit_atomic_find_and_set_first_clear(claimed,len,
+                    0,__ATOMIC_ACQ_REL)) >= 0) {
+                got[t].push_back(bit);
+            }
+            /* neighbouring bits of the same words from every thread */
+            for (size_t ix = t; ix < len ; ix += threads) {
+                std_bit_atomic_set(flags,ix,__ATOMIC_RELAXED);
+            }
+            for (size_t ix = t; ix < len ; ix += 2*threads) {
+                std_bit_atomic_clear(flags,ix,__ATOMIC_RELAXED);
+            }
+        }));
+    }
+    for (auto &it : th) it.join();
+
+    std::vector<int> seen(len,0);
+    for (auto &v : got) for (auto bit : v) seen[bit]++;
+    for (size_t ix = 0; ix < len ; ++ix) ASSERT_EQ(1,seen[ix]);
+
+    for (size_t ix = 0; ix < len ; ++ix) {
+        ASSERT_EQ((ix % (2*threads)) >= (size_t)threads,STD_BIT_ARRAY_TEST(flags,ix));
+    }
+    std_bitmaparray_free_data(claimed);
+    std_bitmaparray_free_data(flags);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
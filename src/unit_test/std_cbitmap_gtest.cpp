@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_cbitmap_gtest.cpp
+ */
+
+#include "std_cbitmap.h"
+
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+#include <set>
+#include <vector>
+
+static std::vector<uint32_t> all_values(const std_cbitmap_t *bm, size_t batch) {
+    std::vector<uint32_t> out;
+    std::vector<uint32_t> vals(batch);
+    uint64_t from = 0;
+    size_t n;
+    while ((n = std_cbitmap_get_values(bm,&from,&vals[0],batch)) > 0) {
+        out.insert(out.end(),vals.begin(),vals.begin()+n);
+    }
+    return out;
+}
+
+static void check_same(const std_cbitmap_t *bm, const std::set<uint32_t> &ref) {
+    ASSERT_EQ(ref.size(),std_cbitmap_cardinality(bm));
+    std::vector<uint32_t> vals = all_values(bm,1 + rand() % 300);
+    ASSERT_EQ(std::vector<uint32_t>(ref.begin(),ref.end()),vals);
+}
+
+/* values clustered in a few chunks so that all container types get used */
+static uint32_t random_value(uint32_t spread) {
+    return ((rand() % 4) << 16) | (rand() % spread);
+}
+
+static void fill_random(std_cbitmap_t *bm, std::set<uint32_t> &ref, int ops, uint32_t spread) {
+    for (int ix = 0; ix < ops ; ++ix) {
+        uint32_t v = random_value(spread);
+        if (rand() % 4) {
+            ASSERT_EQ(STD_ERR_OK,std_cbitmap_add(bm,v));
+            ref.insert(v);
+        } else {
+            ASSERT_EQ(STD_ERR_OK,std_cbitmap_remove(bm,v));
+            ref.erase(v);
+        }
+        ASSERT_EQ(ref.count(v)!=0,std_cbitmap_contains(bm,v));
+    }
+}
+
+TEST(std_cbitmap, add_remove) {
+    std_cbitmap_t *bm = std_cbitmap_create();
+    ASSERT_TRUE(bm!=NULL);
+    std::set<uint32_t> ref;
+
+    /* sparse (arrays) then dense enough to become bitsets and back again */
+    fill_random(bm,ref,20000,65536);
+    check_same(bm,ref);
+    fill_random(bm,ref,60000,16384);
+    check_same(bm,ref);
+    for (int ix = 0; ix < 80000 ; ++ix) {
+        uint32_t v = random_value(65536);
+        std_cbitmap_remove(bm,v);
+        ref.erase(v);
+    }
+    check_same(bm,ref);
+
+    ASSERT_EQ(STD_ERR_OK,std_cbitmap_add(bm,0xffffffff));
+    ASSERT_TRUE(std_cbitmap_contains(bm,0xffffffff));
+    ref.insert(0xffffffff);
+    check_same(bm,ref);
+    std_cbitmap_free(bm);
+}
+
+TEST(std_cbitmap, ranges_and_runs) {
+    std_cbitmap_t *bm = std_cbitmap_create();
+    std::set<uint32_t> ref;
+
+    ASSERT_NE(STD_ERR_OK,std_cbitmap_add_range(bm,10,9));
+    ASSERT_EQ(STD_ERR_OK,std_cbitmap_add_range(bm,1000,250000));
+    for (uint32_t v = 1000; v <= 250000 ; ++v) ref.insert(v);
+    check_same(bm,ref);
+    /* four run containers */
+    ASSERT_LT(std_cbitmap_memory_usage(bm),1024);
+
+    /* punch holes in the runs and fill some of them back in */
+    for (int ix = 0; ix < 5000 ; ++ix) {
+        uint32_t v = rand() % 260000;
+        if (rand() % 3) {
+            std_cbitmap_remove(bm,v);
+            ref.erase(v);
+        } else {
+            std_cbitmap_add(bm,v);
+            ref.insert(v);
+        }
+    }
+    check_same(bm,ref);
+
+    ASSERT_EQ(STD_ERR_OK,std_cbitmap_add_range(bm,2000,3000));
+    for (uint32_t v = 2000; v <= 3000 ; ++v) ref.insert(v);
+    check_same(bm,ref);
+
+    std_cbitmap_optimize(bm);
+    check_same(bm,ref);
+    std_cbitmap_free(bm);
+}
+
+TEST(std_cbitmap, optimize) {
+    std_cbitmap_t *bm = std_cbitmap_create();
+    std::set<uint32_t> ref;
+    for (uint32_t v = 0; v < 60000 ; ++v) {
+        std_cbitmap_add(bm,v);
+        ref.insert(v);
+    }
+    size_t before = std_cbitmap_memory_usage(bm);
+    std_cbitmap_optimize(bm);
+    ASSERT_LT(std_cbitmap_memory_usage(bm),before / 50);
+    check_same(bm,ref);
+    std_cbitmap_free(bm);
+}
+
+static void check_ops(uint32_t spread_a, uint32_t spread_b, bool optimize) {
+    std_cbitmap_t *a = std_cbitmap_create();
+    std_cbitmap_t *b = std_cbitmap_create();
+    std::set<uint32_t> ra, rb;
+    fill_random(a,ra,20000,spread_a);
+    fill_random(b,rb,20000,spread_b);
+    std_cbitmap_add_range(a,300000,400000);
+    std_cbitmap_add_range(b,350000,360000);
+    for (uint32_t v = 300000; v <= 400000 ; ++v) ra.insert(v);
+    for (uint32_t v = 350000; v <= 360000 ; ++v) rb.insert(v);
+    if (optimize) {
+        std_cbitmap_optimize(a);
+        std_cbitmap_optimize(b);
+    }
+
+    std::set<uint32_t> ru(ra), ri;
+    ru.insert(rb.begin(),rb.end());
+    for (auto v : ra) if (rb.count(v)) ri.insert(v);
+
+    std_cbitmap_t *u = std_cbitmap_or(a,b);
+    std_cbitmap_t *i = std_cbitmap_and(a,b);
+    ASSERT_TRUE(u!=NULL && i!=NULL);
+    check_same(u,ru);
+    check_same(i,ri);
+    std_cbitmap_free(u);
+    std_cbitmap_free(i);
+    std_cbitmap_free(a);
+    std_cbitmap_free(b);
+}
+
+TEST(std_cbitmap, or_and) {
+    check_ops(65536,65536,false);
+    check_ops(8192,65536,false);
+    check_ops(8192,4096,false);
+    check_ops(8192,4096,true);
+    check_ops(300,65536,true);
+}
+
+TEST(std_cbitmap, get_values_from) {
+    std_cbitmap_t *bm = std_cbitmap_create();
+    std::set<uint32_t> ref;
+    fill_random(bm,ref,30000,20000);
+    std_cbitmap_add_range(bm,1000000,1100000);
+    for (uint32_t v = 1000000; v <= 1100000 ; ++v) ref.insert(v);
+
+    for (int ix = 0; ix < 200 ; ++ix) {
+        uint64_t from = rand() % 1200000;
+        uint32_t vals[64];
+        auto it = ref.lower_bound(from);
+        size_t n = std_cbitmap_get_values(bm,&from,vals,64);
+        for (size_t j = 0; j < n ; ++j, ++it) {
+            ASSERT_TRUE(it!=ref.end());
+            ASSERT_EQ(*it,vals[j]);
+        }
+        if (it!=ref.end()) {
+            ASSERT_LE(from,*it);
+        }
+    }
+    std_cbitmap_free(bm);
+}
+
+TEST(std_cbitmap, serialize) {
+    std_cbitmap_t *bm = std_cbitmap_create();
+    std::set<uint32_t> ref;
+    fill_random(bm,ref,30000,20000);
+    std_cbitmap_add_range(bm,1000000,1100000);
+    for (uint32_t v = 1000000; v <= 1100000 ; ++v) ref.insert(v);
+
+    size_t len = std_cbitmap_serialized_size(bm);
+    std::vector<uint8_t> buf(len);
+    ASSERT_EQ(len,std_cbitmap_serialize(bm,&buf[0]));
+
+    std_cbitmap_t *copy = std_cbitmap_deserialize(&buf[0],len);
+    ASSERT_TRUE(copy!=NULL);
+    check_same(copy,ref);
+    std_cbitmap_free(copy);
+
+    ASSERT_TRUE(std_cbitmap_deserialize(&buf[0],len-1)==NULL);
+    ASSERT_TRUE(std_cbitmap_deserialize(&buf[0],4)==NULL);
+
+    /* unsorted values in an array container */
+    std_cbitmap_t *small = std_cbitmap_create();
+    std_cbitmap_add(small,5);
+    std_cbitmap_add(small,10);
+    std_cbitmap_add(small,20);
+    len = std_cbitmap_serialize(small,&buf[0]);
+    std_cbitmap_free(small);
+    std::vector<uint8_t> bad(buf);
+    std::swap(bad[20],bad[22]);
+    std::swap(bad[21],bad[23]);
+    ASSERT_TRUE(std_cbitmap_deserialize(&bad[0],len)==NULL);
+
+    /* wrong cardinality */
+    bad = buf;
+    bad[12]++;
+    ASSERT_TRUE(std_cbitmap_deserialize(&bad[0],len)==NULL);
+
+    std_cbitmap_t *empty = std_cbitmap_create();
+    len = std_cbitmap_serialize(empty,&buf[0]);
+    copy = std_cbitmap_deserialize(&buf[0],len);
+    ASSERT_TRUE(copy!=NULL);
+    ASSERT_EQ(0,std_cbitmap_cardinality(copy));
+    std_cbitmap_free(copy);
+    std_cbitmap_free(empty);
+    std_cbitmap_free(bm);
+}
+
+TEST(std_cbitmap, sparse_memory) {
+    /* 10000 values over 4M - a flat bitmap would take 512K */
+    std_cbitmap_t *bm = std_cbitmap_create();
+    for (uint32_t ix = 0; ix < 10000 ; ++ix) {
+        std_cbitmap_add(bm,ix * 419);
+    }
+    ASSERT_EQ(10000,std_cbitmap_cardinality(bm));
+    ASSERT_LT(std_cbitmap_memory_usage(bm),10000 * 4);
+    std_cbitmap_free(bm);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * std_concurrent_hash_gtest.cpp
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "gtest/gtest.h"
+
+#include "std_concurrent_hash.h"
+
+#include <atomic>
+
+typedef struct {
+    uint32_t ifindex;
+    uint32_t value;
+} chash_entry_t;
+
+static std_chash_handle_t map;
+static std::atomic<int> freed(0);
+static std::atomic<bool> stop(false);
+
+enum { KEYS = 1000, ROUNDS = 20000 };
+
+static void free_entry(void *data) {
+    ++freed;
+    free(data);
+}
+
+static void *reader(void *param) {
+    chash_entry_t key;
+    uint32_t ix = 0;
+    while (!stop.load()) {
+        key.ifindex = (ix++) % KEYS;
+        std_chash_read_enter(map);
+        chash_entry_t *e = (chash_entry_t *)std_chash_find(map,&key);
+        if (e!=NULL) {
+            /* the node must stay valid until the read section is done */
+            EXPECT_EQ(e->value,e->ifindex * 3);
+        }
+        std_chash_read_exit(map);
+    }
+    return NULL;
+}
+
+static void *writer(void *param) {
+    uint32_t base = *(uint32_t*)param;
+    uint32_t ix = 0;
+    for ( ; ix < ROUNDS ; ++ix ) {
+        chash_entry_t *e = (chash_entry_t*)malloc(sizeof(*e));
+        e->ifindex = (base + ix) % KEYS;
+        e->value = e->ifindex * 3;
+        if (std_chash_insert(map,e)!=STD_ERR_OK) {
+            chash_entry_t *old = (chash_entry_t*)std_chash_remove(map,e);
+            free(e);
+            if (old!=NULL) std_chash_retire(map,old,free_entry);
+        }
+    }
+    return NULL;
+}
+
+TEST(std_chash_test, basic)
+{
+    std_chash_handle_t h;
+    ASSERT_EQ(std_chash_create(&h,"basic",offsetof(chash_entry_t,ifindex),sizeof(uint32_t),4),STD_ERR_OK);
+
+    chash_entry_t entries[100];
+    size_t ix = 0;
+    for ( ; ix < 100 ; ++ix ) {
+        entries[ix].ifindex = ix;
+        ASSERT_EQ(std_chash_insert(h,&entries[ix]),STD_ERR_OK);
+    }
+    ASSERT_NE(std_chash_insert(h,&entries[5]),STD_ERR_OK);
+    ASSERT_EQ(std_chash_count(h),100);
+    ASSERT_EQ(std_chash_find(h,&entries[42]),&entries[42]);
+    ASSERT_EQ(std_chash_remove(h,&entries[42]),&entries[42]);
+    ASSERT_TRUE(std_chash_find(h,&entries[42])==NULL);
+    ASSERT_EQ(std_chash_count(h),99);
+    ASSERT_EQ(std_chash_destroy(h),STD_ERR_OK);
+}
+
+TEST(std_chash_test, threads)
+{
+    ASSERT_EQ(std_chash_create(&map,"threads",offsetof(chash_entry_t,ifindex),sizeof(uint32_t),0),STD_ERR_OK);
+
+    pthread_t readers[4];
+    pthread_t writers[4];
+    uint32_t bases[4];
+    size_t ix = 0;
+    for ( ; ix < 4 ; ++ix ) {
+        pthread_create(&readers[ix],NULL,reader,NULL);
+    }
+    for ( ix = 0 ; ix < 4 ; ++ix ) {
+        bases[ix] = ix * 250;
+        pthread_create(&writers[ix],NULL,writer,&bases[ix]);
+    }
+    for ( ix = 0 ; ix < 4 ; ++ix ) {
+        pthread_join(writers[ix],NULL);
+    }
+    stop.store(true);
+    for ( ix = 0 ; ix < 4 ; ++ix ) {
+        pthread_join(readers[ix],NULL);
+    }
+    std_chash_reclaim(map);
+    ASSERT_GT(freed.load(),0);
+
+    chash_entry_t key;
+    for ( ix = 0 ; ix < KEYS ; ++ix ) {
+        key.ifindex = ix;
+        void *e = std_chash_remove(map,&key);
+        if (e!=NULL) free(e);
+    }
+    ASSERT_EQ(std_chash_count(map),0);
+    ASSERT_EQ(std_chash_destroy(map),STD_ERR_OK);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
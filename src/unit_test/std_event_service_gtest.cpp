@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_event_service_gtest.cpp
+ */
+
+#include "std_event_service.h"
+#include "private/std_event_ring.h"
+#include "private/std_event_utils.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+static const char *channel = "/tmp/std_event_service_gtest";
+
+static std_event_key_t make_key(std::vector<uint32_t> k) {
+    std_event_key_t key;
+    memset(&key,0,sizeof(key));
+    key.len = k.size();
+    for (size_t ix = 0; ix < k.size() ; ++ix) key.event_key[ix] = k[ix];
+    return key;
+}
+
+static std_event_client_handle connect_client() {
+    std_event_client_handle h = -1;
+    EXPECT_EQ(STD_ERR_OK,std_server_client_connect(&h,channel));
+    return h;
+}
+
+static void subscribe(std_event_client_handle h, std::vector<uint32_t> k) {
+    std_event_key_t key = make_key(k);
+    ASSERT_EQ(STD_ERR_OK,std_client_register_interest(h,&key,1));
+}
+
+static void publish(std_event_client_handle h, std::vector<uint32_t> k, uint32_t val) {
+    std_event_key_t key = make_key(k);
+    ASSERT_EQ(STD_ERR_OK,std_client_publish_msg_data(h,&key,&val,sizeof(val)));
+}
+
+/* count the events received until nothing arrives for 'ms' */
+static size_t drain(std_event_client_handle h, std::vector<uint32_t> *vals=NULL, int ms=300) {
+    std_event_msg_buff_t buff = std_client_allocate_msg_buff(1000,false);
+    size_t count = 0;
+    struct pollfd pfd = { h, POLLIN, 0 };
+    while (poll(&pfd,1,ms)==1) {
+        if (std_client_wait_for_event(h,buff)!=STD_ERR_OK) break;
+        std_event_msg_t *msg = std_event_msg_from_buff(buff);
+        if (msg==NULL) break;
+        if (vals!=NULL) vals->push_back(*(uint32_t*)std_event_get_data(msg));
+        ++count;
+    }
+    std_client_free_msg_buff(&buff);
+    return count;
+}
+
+static std_event_server_handle_t server;
+
+TEST(std_event_service, init) {
+    unlink(channel);
+    ASSERT_EQ(STD_ERR_OK,std_event_server_init(&server,channel,4));
+}
+
+TEST(std_event_service, fanout_once_per_client) {
+    std_event_client_handle a = connect_client();
+    std_event_client_handle b = connect_client();
+    std_event_client_handle pub = connect_client();
+
+    /* a matches the key at three levels, b at the last one only */
+    subscribe(a,{1});
+    subscribe(a,{1,2});
+    subscribe(a,{1,2,3});
+    subscribe(b,{1,2,3});
+    subscribe(b,{7});
+    usleep(100000);
+
+    for (uint32_t ix = 0; ix < 10 ; ++ix) publish(pub,{1,2,3},ix);
+    publish(pub,{1,5},100);
+    publish(pub,{2,2,3},200);
+
+    std::vector<uint32_t> vals;
+    ASSERT_EQ(11U,drain(a,&vals));
+    for (uint32_t ix = 0; ix < 10 ; ++ix) ASSERT_EQ(ix,vals[ix]);
+    ASSERT_EQ(100U,vals[10]);
+    ASSERT_EQ(10U,drain(b));
+
+    std_server_client_disconnect(a);
+    std_server_client_disconnect(b);
+    std_server_client_disconnect(pub);
+}
+
+TEST(std_event_service, remove_and_reuse) {
+    std_event_client_handle a = connect_client();
+    std_event_client_handle b = connect_client();
+    std_event_client_handle pub = connect_client();
+    subscribe(a,{4,4});
+    subscribe(b,{4});
+    usleep(100000);
+
+    /* a closing frees its slot for the next client */
+    std_server_client_disconnect(a);
+    std_event_client_handle c = connect_client();
+    subscribe(c,{4,4,4});
+    std_event_key_t key = make_key({4});
+    ASSERT_EQ(STD_ERR_OK,std_client_remove_interest(b,&key,1));
+    usleep(100000);
+
+    publish(pub,{4,4,4},1);
+    publish(pub,{4,4},2);
+    ASSERT_EQ(1U,drain(c));
+    ASSERT_EQ(0U,drain(b,NULL,100));
+
+    std_server_client_disconnect(b);
+    std_server_client_disconnect(c);
+    std_server_client_disconnect(pub);
+}
+
+TEST(std_event_service, prefix_match) {
+    std_event_client_handle a = connect_client();
+    std_event_client_handle b = connect_client();
+    std_event_client_handle pub = connect_client();
+    subscribe(a,{9});
+    subscribe(b,{9,8,7,6});
+    subscribe(b,{9,8,5});
+    usleep(100000);
+
+    publish(pub,{9,8,7,6,5,4,3},1);  /* a and b */
+    publish(pub,{9,8,7},2);          /* a */
+    publish(pub,{9,8,1,6},3);        /* a */
+    publish(pub,{9,8,5,6},4);        /* a and b */
+    publish(pub,{8,8,5},5);          /* none */
+    publish(pub,{},6);               /* none */
+
+    std::vector<uint32_t> vals;
+    ASSERT_EQ(4U,drain(a,&vals));
+    ASSERT_EQ(std::vector<uint32_t>({1,2,3,4}),vals);
+    vals.clear();
+    ASSERT_EQ(2U,drain(b,&vals));
+    ASSERT_EQ(std::vector<uint32_t>({1,4}),vals);
+
+    std_server_client_disconnect(a);
+    std_server_client_disconnect(b);
+    std_server_client_disconnect(pub);
+}
+
+TEST(std_event_service, shm_ring) {
+    std_event_client_handle sub = -1;
+    ASSERT_EQ(STD_ERR_OK,std_server_client_connect_shm(&sub,channel,1));
+    std_event_client_handle pub = connect_client();
+    subscribe(sub,{3});
+    usleep(100000);
+
+    /* enough to wrap the smallest ring a few times while it is read */
+    const uint32_t count = 5000;
+    std::vector<uint8_t> big(40000,0x5a);
+    std::thread t([&]() {
+        for (uint32_t ix = 0; ix < count ; ++ix) publish(pub,{3,ix},ix);
+        std_event_key_t key = make_key({3,1});
+        std_client_publish_msg_data(pub,&key,&big[0],big.size());
+        publish(pub,{3},count);
+    });
+
+    std_event_msg_buff_t buff = std_client_allocate_msg_buff(100,false);
+    for (uint32_t ix = 0; ix < count ; ++ix) {
+        ASSERT_EQ(STD_ERR_OK,std_client_wait_for_event(sub,buff));
+        std_event_msg_t *msg = std_event_msg_from_buff(buff);
+        ASSERT_TRUE(msg!=NULL);
+        ASSERT_EQ(ix,*(uint32_t*)std_event_get_data(msg));
+        ASSERT_EQ(ix,msg->key.event_key[1]);
+    }
+
+    /* the large one comes over the socket so the order of the last two is not fixed */
+    size_t big_seen = 0, last_seen = 0;
+    for (size_t ix = 0; ix < 2 ; ++ix) {
+        ASSERT_EQ(STD_ERR_OK,std_client_wait_for_event(sub,buff));
+        std_event_msg_t *msg = std_event_msg_from_buff(buff);
+        ASSERT_TRUE(msg!=NULL);
+        if (msg->data_len==big.size()) {
+            ASSERT_EQ(0,memcmp(&big[0],std_event_get_data(msg),big.size()));
+            ++big_seen;
+        } else {
+            ASSERT_EQ(count,*(uint32_t*)std_event_get_data(msg));
+            ++last_seen;
+        }
+    }
+    ASSERT_EQ(1U,big_seen);
+    ASSERT_EQ(1U,last_seen);
+    t.join();
+
+    /* and through the copy out API */
+    publish(pub,{3,3},77);
+    std_event_msg_t msg;
+    uint32_t val = 0;
+    ASSERT_EQ(STD_ERR_OK,std_client_wait_for_event_data(sub,&msg,&val,sizeof(val)));
+    ASSERT_EQ(77U,val);
+    ASSERT_EQ(2U,msg.key.len);
+
+    std_client_free_msg_buff(&buff);
+    std_server_client_disconnect(sub);
+    std_server_client_disconnect(pub);
+}
+
+/*
+ * stands in for a server that supports rings but is too slow to answer before
+ * the client gives up.  The reply and two events follow - the client must
+ * skip the reply and never ask to use the ring
+ */
+static void slow_ring_server(int lsock, int *errors) {
+    int fd = accept(lsock,NULL,NULL);
+    if (fd<0) {
+        ++*errors;
+        return;
+    }
+    uint8_t req[sizeof(std_event_ipc_data_t)+sizeof(event_serv_msg_t)+sizeof(uint64_t)];
+    if (recv(fd,req,sizeof(req),MSG_WAITALL)!=(ssize_t)sizeof(req)) ++*errors;
+    usleep(2500*1000);
+
+    std_event_ring_t *ring = NULL;
+    if (std_event_ring_create(1,&ring)!=STD_ERR_OK) ++*errors;
+    uint64_t size = ring->size;
+    event_serv_msg_t m;
+    m.op = event_serv_msg_t_SHM_RING;
+    std_event_msg_descr_t d[2];
+    d[0].data = &size;
+    d[0].len = sizeof(size);
+    std::vector<uint8_t> out;
+    std_event_util_event_frame(out,&m,d,1);
+    if (std_event_ring_send_fds(fd,ring,&out[0],out.size())!=STD_ERR_OK) ++*errors;
+
+    out.clear();
+    m.op = event_serv_msg_t_PUBLISH;
+    for (uint32_t val = 42; val < 44 ; ++val) {
+        std_event_msg_t msg;
+        msg.key = make_key({9});
+        msg.data_len = sizeof(val);
+        d[0].data = &msg;
+        d[0].len = sizeof(msg);
+        d[1].data = &val;
+        d[1].len = sizeof(val);
+        std_event_util_event_frame(out,&m,d,2);
+    }
+    if (write(fd,&out[0],out.size())!=(ssize_t)out.size()) ++*errors;
+
+    /* nothing more until the client disconnects */
+    uint8_t b;
+    if (read(fd,&b,1)!=0) ++*errors;
+    std_event_ring_free(ring);
+    close(fd);
+}
+
+static void check_late_ring_reply(bool copy_out) {
+    const char *slow = "/tmp/std_event_service_gtest_slow";
+    unlink(slow);
+    int lsock = socket(AF_UNIX,SOCK_STREAM,0);
+    ASSERT_GE(lsock,0);
+    struct sockaddr_un addr;
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path,slow,sizeof(addr.sun_path)-1);
+    ASSERT_EQ(0,bind(lsock,(struct sockaddr*)&addr,sizeof(addr)));
+    ASSERT_EQ(0,listen(lsock,1));
+
+    int errors = 0;
+    std::thread t(slow_ring_server,lsock,&errors);
+
+    std_event_client_handle sub = -1;
+    ASSERT_EQ(STD_ERR_OK,std_server_client_connect_shm(&sub,slow,1));
+    for (uint32_t val = 42; val < 44 ; ++val) {
+        if (copy_out) {
+            /* the socket path wants room for the message header as well */
+            std_event_msg_t msg;
+            uint32_t got[32] = { 0 };
+            ASSERT_EQ(STD_ERR_OK,std_client_wait_for_event_data(sub,&msg,got,sizeof(got)));
+            ASSERT_EQ(sizeof(val),msg.data_len);
+            ASSERT_EQ(val,got[0]);
+        } else {
+            std_event_msg_buff_t buff = std_client_allocate_msg_buff(100,false);
+            ASSERT_EQ(STD_ERR_OK,std_client_wait_for_event(sub,buff));
+            std_event_msg_t *msg = std_event_msg_from_buff(buff);
+            ASSERT_TRUE(msg!=NULL);
+            ASSERT_EQ(val,*(uint32_t*)std_event_get_data(msg));
+            std_client_free_msg_buff(&buff);
+        }
+    }
+    std_server_client_disconnect(sub);
+    t.join();
+    close(lsock);
+    unlink(slow);
+    ASSERT_EQ(0,errors);
+}
+
+TEST(std_event_service, late_ring_reply) {
+    check_late_ring_reply(false);
+    check_late_ring_reply(true);
+}
+
+static void check_batches(std_event_client_handle sub, uint32_t count, size_t *largest) {
+    std_event_msg_buff_t buff = std_client_allocate_msg_buff(100,true);
+    std_event_msg_t *msgs[64];
+    uint32_t next = 0;
+    *largest = 0;
+    while (next < count) {
+        size_t n = 0;
+        ASSERT_EQ(STD_ERR_OK,std_client_wait_for_events(sub,buff,msgs,64,&n));
+        ASSERT_TRUE(n>=1 && n<=64);
+        if (n > *largest) *largest = n;
+        for (size_t ix = 0; ix < n ; ++ix, ++next) {
+            ASSERT_EQ(sizeof(uint32_t),msgs[ix]->data_len);
+            ASSERT_EQ(next,*(uint32_t*)std_event_get_data(msgs[ix]));
+        }
+    }
+    std_client_free_msg_buff(&buff);
+}
+
+TEST(std_event_service, batch_receive) {
+    std_event_client_handle sub = connect_client();
+    std_event_client_handle ring_sub = -1;
+    ASSERT_EQ(STD_ERR_OK,std_server_client_connect_shm(&ring_sub,channel,1));
+    std_event_client_handle pub = connect_client();
+    subscribe(sub,{6});
+    subscribe(ring_sub,{6});
+    usleep(100000);
+
+    const uint32_t count = 200;
+    for (uint32_t ix = 0; ix < count ; ++ix) publish(pub,{6,ix},ix);
+
+    size_t largest;
+    check_batches(sub,count,&largest);
+    /* they were all waiting so they can't have come one at a time */
+    ASSERT_GT(largest,1U);
+    check_batches(ring_sub,count,&largest);
+    ASSERT_GT(largest,1U);
+
+    /* the single receive picks up after a batch receive on the same buffer */
+    publish(pub,{6},1);
+    publish(pub,{6},2);
+    usleep(100000);
+    std_event_msg_buff_t buff = std_client_allocate_msg_buff(100,true);
+    std_event_msg_t *msg;
+    size_t n;
+    ASSERT_EQ(STD_ERR_OK,std_client_wait_for_events(sub,buff,&msg,1,&n));
+    ASSERT_EQ(1U,*(uint32_t*)std_event_get_data(msg));
+    ASSERT_EQ(STD_ERR_OK,std_client_wait_for_event(sub,buff));
+    ASSERT_EQ(2U,*(uint32_t*)std_event_get_data(std_event_msg_from_buff(buff)));
+    std_client_free_msg_buff(&buff);
+
+    std_server_client_disconnect(sub);
+    std_server_client_disconnect(ring_sub);
+    std_server_client_disconnect(pub);
+}
+
+TEST(std_event_service, flush_latency) {
+    ASSERT_EQ(STD_ERR_OK,std_event_server_set_flush_latency(server,50));
+
+    std_event_client_handle sub = connect_client();
+    std_event_client_handle pub = connect_client();
+    subscribe(sub,{8});
+    usleep(100000);
+
+    /* held by the server until the flusher writes it */
+    publish(pub,{8},5);
+    struct pollfd pfd = { sub, POLLIN, 0 };
+    ASSERT_EQ(0,poll(&pfd,1,20));
+    std::vector<uint32_t> vals;
+    ASSERT_EQ(1U,drain(sub,&vals,500));
+    ASSERT_EQ(5U,vals[0]);
+
+    ASSERT_EQ(STD_ERR_OK,std_event_server_set_flush_latency(server,0));
+    publish(pub,{8},6);
+    ASSERT_EQ(1U,drain(sub));
+
+    std_server_client_disconnect(sub);
+    std_server_client_disconnect(pub);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
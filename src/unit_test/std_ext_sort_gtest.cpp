@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_ext_sort_gtest.cpp
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+#include "std_ext_sort.h"
+
+#include <algorithm>
+#include <vector>
+
+typedef struct {
+    uint32_t key;
+    uint32_t seq;
+    char payload[8];
+} ext_entry_t;
+
+static int entry_cmp(void *context, const void *a, const void *b) {
+    uint32_t ka = ((const ext_entry_t*)a)->key;
+    uint32_t kb = ((const ext_entry_t*)b)->key;
+    return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
+}
+
+/* add len records in batches of batch and check they come back in stable order */
+static void check_sort(size_t len, uint32_t range, size_t budget, size_t batch) {
+    std::vector<ext_entry_t> v(len);
+    for (size_t ix = 0; ix < len ; ++ix) {
+        v[ix].key = rand() % range;
+        v[ix].seq = ix;
+    }
+
+    std_ext_sort_handle_t h;
+    ASSERT_EQ(STD_ERR_OK, std_ext_sort_create(&h, sizeof(ext_entry_t), budget,
+                                              NULL, NULL, entry_cmp));
+    for (size_t ix = 0; ix < len ; ix += batch) {
+        ASSERT_EQ(STD_ERR_OK, std_ext_sort_add(h, &v[ix], std::min(batch, len - ix)));
+    }
+    ASSERT_EQ(len, std_ext_sort_count(h));
+    ASSERT_EQ(STD_ERR_OK, std_ext_sort_finish(h));
+
+    std::stable_sort(v.begin(), v.end(), [](const ext_entry_t &a, const ext_entry_t &b) {
+        return a.key < b.key; });
+
+    std::vector<ext_entry_t> out(37);
+    size_t pos = 0;
+    size_t n;
+    while (std_ext_sort_read(h, out.data(), out.size(), &n) == STD_ERR_OK && n != 0) {
+        for (size_t ix = 0; ix < n ; ++ix, ++pos) {
+            ASSERT_LT(pos, len);
+            ASSERT_EQ(v[pos].seq, out[ix].seq);
+        }
+    }
+    ASSERT_EQ(len, pos);
+    std_ext_sort_destroy(h);
+}
+
+TEST(std_ext_sort, in_memory) {
+    check_sort(0, 100, 1024*1024, 100);
+    check_sort(5000, 100, 1024*1024, 100);
+}
+
+TEST(std_ext_sort, single_merge) {
+    /* 64K budget holds 2K records per run - about 50 runs */
+    check_sort(100000, 1000, 64*1024, 333);
+}
+
+TEST(std_ext_sort, multi_pass) {
+    /* tiny budget forces the runs to be merged in several passes */
+    check_sort(20000, 50, 64*sizeof(ext_entry_t), 1000);
+}
+
+TEST(std_ext_sort, bad_params) {
+    std_ext_sort_handle_t h;
+    ASSERT_NE(STD_ERR_OK, std_ext_sort_create(&h, sizeof(ext_entry_t), sizeof(ext_entry_t),
+                                              NULL, NULL, entry_cmp));
+    ASSERT_NE(STD_ERR_OK, std_ext_sort_create(&h, 0, 1024, NULL, NULL, entry_cmp));
+    ASSERT_EQ(STD_ERR_OK, std_ext_sort_create(&h, sizeof(ext_entry_t), 1024,
+                                              "/nonexistent_dir", NULL, entry_cmp));
+    std::vector<ext_entry_t> v(200);
+    ASSERT_NE(STD_ERR_OK, std_ext_sort_add(h, v.data(), v.size()));
+    std_ext_sort_destroy(h);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_hash_gtest.cpp
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "std_hash.h"
+
+typedef struct {
+    int other;
+    uint32_t ifindex;
+    char name[16];
+} hash_entry_t;
+
+static int count_walk(void *context, void *data) {
+    ++*(size_t*)context;
+    return 0;
+}
+
+TEST(std_hash_test, insert_find_remove)
+{
+    std_hash_handle h = std_hash_create_simple("test", offsetof(hash_entry_t,ifindex),
+            sizeof(uint32_t));
+    ASSERT_TRUE(h != NULL);
+
+    const size_t mx = 100000;
+    std::vector<hash_entry_t> entries(mx);
+    size_t ix = 0;
+    for ( ; ix < mx ; ++ix ) {
+        entries[ix].ifindex = ix * 7;
+        snprintf(entries[ix].name,sizeof(entries[ix].name),"e%d",(int)ix);
+        ASSERT_EQ(std_hash_insert(h,&entries[ix]),STD_ERR_OK);
+    }
+    ASSERT_EQ(std_hash_count(h),mx);
+
+    /* duplicates are rejected */
+    hash_entry_t key;
+    key.ifindex = 7;
+    ASSERT_NE(std_hash_insert(h,&key),STD_ERR_OK);
+
+    for ( ix = 0; ix < mx ; ++ix ) {
+        key.ifindex = ix * 7;
+        ASSERT_EQ(std_hash_getexact(h,&key),&entries[ix]);
+        key.ifindex = ix * 7 + 1;
+        ASSERT_TRUE(std_hash_getexact(h,&key) == NULL);
+    }
+
+    size_t walked = 0;
+    ASSERT_TRUE(std_hash_walk(h,count_walk,&walked)==NULL);
+    ASSERT_EQ(walked,mx);
+
+    for ( ix = 0; ix < mx ; ix += 2 ) {
+        key.ifindex = ix * 7;
+        ASSERT_EQ(std_hash_remove(h,&key),&entries[ix]);
+        ASSERT_TRUE(std_hash_remove(h,&key) == NULL);
+    }
+    ASSERT_EQ(std_hash_count(h),mx/2);
+
+    for ( ix = 0; ix < mx ; ++ix ) {
+        key.ifindex = ix * 7;
+        void *expect = (ix % 2) ? &entries[ix] : NULL;
+        ASSERT_EQ(std_hash_getexact(h,&key),expect);
+    }
+    std_hash_destroy(h);
+}
+
+TEST(std_hash_test, churn)
+{
+    /* repeated insert/remove leaves tombstones that must be cleaned up */
+    std_hash_handle h = std_hash_create("churn", offsetof(hash_entry_t,name),
+            sizeof(((hash_entry_t*)0)->name), 0);
+    ASSERT_TRUE(h != NULL);
+
+    std::vector<hash_entry_t> entries(64);
+    size_t round = 0;
+    for ( ; round < 1000 ; ++round ) {
+        size_t ix = 0;
+        for ( ; ix < entries.size() ; ++ix ) {
+            memset(entries[ix].name,0,sizeof(entries[ix].name));
+            snprintf(entries[ix].name,sizeof(entries[ix].name),"%d-%d",(int)round,(int)ix);
+            ASSERT_EQ(std_hash_insert(h,&entries[ix]),STD_ERR_OK);
+        }
+        ASSERT_EQ(std_hash_count(h),entries.size());
+        for ( ix = 0; ix < entries.size() ; ++ix ) {
+            ASSERT_EQ(std_hash_remove(h,&entries[ix]),&entries[ix]);
+        }
+        ASSERT_EQ(std_hash_count(h),0);
+    }
+    std_hash_destroy(h);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_hbitmap_gtest.cpp
+ */
+
+#include "std_hbitmap.h"
+
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+#include <vector>
+
+static int ref_find(const std::vector<bool> &ref, size_t from, bool val) {
+    for (size_t ix = from; ix < ref.size() ; ++ix) {
+        if (ref[ix]==val) return ix;
+    }
+    return -1;
+}
+
+static void check_random(size_t len, bool initial, int ops) {
+    std_hbitmap_t *bm = std_hbitmap_create(len,initial);
+    ASSERT_TRUE(bm!=NULL);
+    ASSERT_EQ(len,std_hbitmap_len(bm));
+    std::vector<bool> ref(len,initial);
+
+    for (int ix = 0; ix < ops ; ++ix) {
+        size_t bit = rand() % len;
+        if (rand() & 1) {
+            std_hbitmap_set(bm,bit);
+            ref[bit] = true;
+        } else {
+            std_hbitmap_clear(bm,bit);
+            ref[bit] = false;
+        }
+        size_t from = (rand() & 3) ? 0 : rand() % (len + 1);
+        ASSERT_EQ(ref_find(ref,from,true),std_hbitmap_find_first_set(bm,from));
+        ASSERT_EQ(ref_find(ref,from,false),std_hbitmap_find_first_clear(bm,from));
+        ASSERT_EQ((bool)ref[bit],std_hbitmap_test(bm,bit));
+    }
+    std_hbitmap_free(bm);
+}
+
+TEST(std_hbitmap, random_ops) {
+    check_random(1,false,100);
+    check_random(64,true,500);
+    check_random(65,false,500);
+    check_random(4097,true,2000);
+    check_random(300000,false,300);
+}
+
+TEST(std_hbitmap, allocate_all) {
+    /* use it as an id allocator over a 1M space */
+    const size_t len = 1 << 20;
+    std_hbitmap_t *bm = std_hbitmap_create(len,false);
+    ASSERT_TRUE(bm!=NULL);
+    for (size_t ix = 0; ix < len ; ++ix) {
+        int id = std_hbitmap_find_first_clear(bm,0);
+        ASSERT_EQ((int)ix,id);
+        std_hbitmap_set(bm,id);
+    }
+    ASSERT_EQ(-1,std_hbitmap_find_first_clear(bm,0));
+    ASSERT_EQ(0,std_hbitmap_find_first_set(bm,0));
+
+    std_hbitmap_clear(bm,777777);
+    ASSERT_EQ(777777,std_hbitmap_find_first_clear(bm,0));
+    ASSERT_EQ(777777,std_hbitmap_find_first_clear(bm,777777));
+    ASSERT_EQ(-1,std_hbitmap_find_first_clear(bm,777778));
+    ASSERT_EQ(777778,std_hbitmap_find_first_set(bm,777777));
+    std_hbitmap_free(bm);
+}
+
+TEST(std_hbitmap, bad_len) {
+    ASSERT_TRUE(std_hbitmap_create(0,false)==NULL);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
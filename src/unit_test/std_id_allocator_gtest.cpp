@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_id_allocator_gtest.cpp
+ */
+
+#include "std_id_allocator.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST(std_id_allocator, basic) {
+    std_id_allocator_handle_t h;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_create(&h,100,200));
+
+    std::set<uint64_t> ids;
+    uint64_t id;
+    for (size_t ix = 0; ix < 200 ; ++ix) {
+        ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc(h,&id));
+        ASSERT_GE(id,100);
+        ASSERT_LT(id,300);
+        ASSERT_TRUE(ids.insert(id).second);
+    }
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_alloc(h,&id));
+
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_free(h,150));
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_free(h,150));
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_free(h,99));
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_alloc_specific(h,151));
+
+    /* 150 is in this thread's cache but can still be taken by id */
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc_specific(h,150));
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_alloc(h,&id));
+
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_free(h,170));
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc(h,&id));
+    ASSERT_EQ(170,id);
+
+    std_id_allocator_destroy(h);
+}
+
+TEST(std_id_allocator, contiguous_and_reserve) {
+    std_id_allocator_handle_t h;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_create(&h,0,1000));
+
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_reserve(h,0,10));
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_reserve(h,5,10));
+    /* the failed reserve must not have left 10-14 in use */
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc_specific(h,12));
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_free(h,12));
+
+    uint64_t first;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc_contiguous(h,100,&first));
+    ASSERT_GE(first,10);
+    for (uint64_t id = first; id < first + 100 ; ++id) {
+        ASSERT_NE(STD_ERR_OK,std_id_allocator_alloc_specific(h,id));
+    }
+    uint64_t second;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc_contiguous(h,500,&second));
+    ASSERT_TRUE(second >= first + 100 || second + 500 <= first);
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_alloc_contiguous(h,500,&first));
+
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_free_range(h,second,500));
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_free_range(h,second,500));
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc_contiguous(h,500,&first));
+    ASSERT_EQ(second,first);
+
+    std_id_allocator_destroy(h);
+}
+
+TEST(std_id_allocator, threads) {
+    const size_t ids_per_thread = 20000;
+    const size_t threads = 4;
+    std_id_allocator_handle_t h;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_create(&h,1,threads * ids_per_thread));
+
+    std::vector<std::atomic<int>> owner(threads * ids_per_thread + 1);
+    for (auto &it : owner) it.store(0);
+    std::atomic<int> errors(0);
+
+    std::vector<std::thread> th;
+    for (size_t t = 0; t < threads ; ++t) {
+        th.emplace_back([&,t]() {
+            std::vector<uint64_t> mine;
+            for (int round = 0; round < 3 ; ++round) {
+                for (size_t ix = 0; ix < ids_per_thread ; ++ix) {
+                    uint64_t id;
+                    if (std_id_allocator_alloc(h,&id)!=STD_ERR_OK) {
+                        /* other threads' caches can hold the last few */
+                        continue;
+                    }
+                    if (owner[id].exchange(t+1)!=0) ++errors;
+                    mine.push_back(id);
+                }
+                for (auto id : mine) {
+                    owner[id].store(0);
+                    if (std_id_allocator_free(h,id)!=STD_ERR_OK) ++errors;
+                }
+                mine.clear();
+            }
+        });
+    }
+    for (auto &it : th) it.join();
+    ASSERT_EQ(0,errors.load());
+
+    /* the exited threads gave their caches back so everything is free again */
+    uint64_t first;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc_contiguous(h,threads * ids_per_thread,&first));
+    ASSERT_EQ(1,first);
+    std_id_allocator_destroy(h);
+}
+
+TEST(std_id_allocator, exhaust_with_other_caches) {
+    /* a small pool where a live thread's cache holds half of the IDs */
+    const size_t count = 64;
+    std_id_allocator_handle_t h;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_create(&h,1,count));
+
+    std::atomic<int> step(0);
+    std::atomic<int> errors(0);
+    auto wait_for = [&](int s) { while (step.load()!=s) std::this_thread::yield(); };
+
+    std::thread other([&]() {
+        uint64_t id;
+        if (std_id_allocator_alloc(h,&id)!=STD_ERR_OK) ++errors;
+        if (std_id_allocator_free(h,id)!=STD_ERR_OK) ++errors;
+        step.store(1);
+        wait_for(2);
+        /* this thread's cache was emptied - the one free ID is in the other one */
+        if (std_id_allocator_alloc(h,&id)!=STD_ERR_OK || id!=10) ++errors;
+        if (std_id_allocator_free(h,id)!=STD_ERR_OK) ++errors;
+        step.store(3);
+        wait_for(4);
+    });
+
+    wait_for(1);
+    std::set<uint64_t> ids;
+    uint64_t id;
+    for (size_t ix = 0; ix < count ; ++ix) {
+        ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc(h,&id));
+        ASSERT_GE(id,1);
+        ASSERT_LE(id,count);
+        ASSERT_TRUE(ids.insert(id).second);
+    }
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_alloc(h,&id));
+
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_free(h,10));
+    ids.erase(10);
+    step.store(2);
+    wait_for(3);
+    ASSERT_EQ(0,errors.load());
+
+    /* the whole range is free even with 10 cached by a thread that is still running */
+    for (auto it : ids) ASSERT_EQ(STD_ERR_OK,std_id_allocator_free(h,it));
+    uint64_t first;
+    ASSERT_EQ(STD_ERR_OK,std_id_allocator_alloc_contiguous(h,count,&first));
+    ASSERT_EQ(1,first);
+    ASSERT_NE(STD_ERR_OK,std_id_allocator_alloc(h,&id));
+
+    step.store(4);
+    other.join();
+    std_id_allocator_destroy(h);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
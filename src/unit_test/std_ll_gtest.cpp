@@ -30,6 +30,8 @@
 #include <stdlib.h>
 #include "gtest/gtest.h"
 
+#include <vector>
+
 extern "C" {
 #include "std_llist.h"
 }
@@ -89,6 +91,87 @@ TEST(std_ll_test, SortedList)
         }
 }
 
+typedef struct {
+        std_dll lst;
+        uint32_t value;
+        uint32_t seq;
+} sort_;
+
+static void check_sorted(std_dll_head *list, size_t expected)
+{
+        size_t count = 0;
+        sort_ *prev = NULL;
+        std_dll *walk = std_dll_getfirst(list);
+        for ( ; walk != NULL ; walk = std_dll_getnext(list,walk)) {
+                sort_ *cur = (sort_*)walk;
+                ASSERT_EQ(std_dll_getprev(list,walk),(std_dll*)prev);
+                if (prev != NULL) {
+                        ASSERT_LE(prev->value, cur->value);
+                        if (prev->value == cur->value) ASSERT_LT(prev->seq, cur->seq);
+                }
+                prev = cur;
+                ++count;
+        }
+        ASSERT_EQ(std_dll_getlast(list),(std_dll*)prev);
+        ASSERT_EQ(count, expected);
+}
+
+TEST(std_ll_test, SortMerge)
+{
+        std_dll_head a, b;
+        std_dll_init_sort(&a,std_compare_uint32_function,offsetof(sort_,value),sizeof(uint32_t));
+        std_dll_init_sort(&b,std_compare_uint32_function,offsetof(sort_,value),sizeof(uint32_t));
+
+        const size_t mx = 10000;
+        std::vector<sort_> items(mx);
+        srand(1);
+        for (size_t ix = 0; ix < mx; ++ix) {
+                items[ix].value = rand() % 1000;
+                items[ix].seq = ix;
+                std_dll_insertatback(ix < mx/2 ? &a : &b, &items[ix].lst);
+        }
+        std_dll_sort(&a);
+        check_sorted(&a, mx/2);
+        std_dll_sort(&b);
+        check_sorted(&b, mx - mx/2);
+
+        std_dll_merge(&a, &b);
+        check_sorted(&a, mx);
+        ASSERT_TRUE(std_dll_getfirst(&b) == NULL);
+
+        std_dll_sort(&b);
+        ASSERT_TRUE(std_dll_getfirst(&b) == NULL);
+}
+
+TEST(std_ll_test, Splice)
+{
+        std_dll_head a, b;
+        std_dll_init(&a);
+        std_dll_init(&b);
+
+        sort_ items[10];
+        for (size_t ix = 0; ix < 10; ++ix) {
+                items[ix].value = ix;
+                items[ix].seq = ix;
+                std_dll_insertatback(&a, &items[ix].lst);
+        }
+
+        /* move 3..5 to b then everything else after them */
+        std_dll_splice(&b, NULL, &a, &items[3].lst, &items[5].lst);
+        ASSERT_EQ(std_dll_getfirst(&b), &items[3].lst);
+        ASSERT_EQ(std_dll_getlast(&b), &items[5].lst);
+        ASSERT_EQ(std_dll_getnext(&a, &items[2].lst), &items[6].lst);
+
+        std_dll_splice(&b, &items[5].lst, &a, &items[6].lst, &items[9].lst);
+        std_dll_splice(&b, NULL, &a, &items[0].lst, &items[2].lst);
+        ASSERT_TRUE(std_dll_getfirst(&a) == NULL);
+        check_sorted(&b, 10);
+
+        std_dll_splice_list(&a, &b);
+        ASSERT_TRUE(std_dll_getfirst(&b) == NULL);
+        check_sorted(&a, 10);
+}
+
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
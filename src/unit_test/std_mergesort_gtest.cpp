@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_mergesort_gtest.cpp
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+#include "std_mergesort.h"
+
+#include <algorithm>
+#include <vector>
+
+typedef struct {
+    uint32_t key;
+    uint32_t seq;
+    char payload[24];
+} sort_entry_t;
+
+static bool entry_less(const sort_entry_t &a, const sort_entry_t &b) {
+    return a.key < b.key;
+}
+
+static int entry_cmp(void *context, const void *a, const void *b) {
+    uint32_t ka = ((const sort_entry_t*)a)->key;
+    uint32_t kb = ((const sort_entry_t*)b)->key;
+    return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
+}
+
+static int old_cmp(void *context, void *array_a, int index_a, void *array_b, int index_b) {
+    return entry_cmp(context,((sort_entry_t*)array_a)+index_a,((sort_entry_t*)array_b)+index_b);
+}
+
+static void old_copy(void *context, void *dst, int dst_index, void *src, int src_index) {
+    ((sort_entry_t*)dst)[dst_index] = ((sort_entry_t*)src)[src_index];
+}
+
+static std::vector<sort_entry_t> make_entries(size_t len, uint32_t range) {
+    std::vector<sort_entry_t> v(len);
+    for (size_t ix = 0; ix < len ; ++ix) {
+        v[ix].key = rand() % range;
+        v[ix].seq = ix;
+    }
+    return v;
+}
+
+static void check_same(const std::vector<sort_entry_t> &a, const std::vector<sort_entry_t> &b) {
+    ASSERT_EQ(a.size(),b.size());
+    for (size_t ix = 0; ix < a.size() ; ++ix) {
+        ASSERT_EQ(a[ix].key,b[ix].key);
+        ASSERT_EQ(a[ix].seq,b[ix].seq);
+    }
+}
+
+TEST(std_mergesort_test, elem)
+{
+    const size_t sizes[] = { 0, 1, 2, 15, 16, 17, 33, 100, 1000, 4097, 100000 };
+    for (auto len : sizes) {
+        std::vector<sort_entry_t> v = make_entries(len,len/4+1);
+        std::vector<sort_entry_t> expected = v;
+        std::stable_sort(expected.begin(),expected.end(),entry_less);
+
+        std::vector<sort_entry_t> tmp(len);
+        std::vector<sort_entry_t> c = v;
+        std_merge_sort_elem(NULL,c.data(),c.size(),sizeof(sort_entry_t),tmp.data(),entry_cmp);
+        check_same(c,expected);
+
+        std::vector<sort_entry_t> t = v;
+        std_merge_sort_typed(t.data(),t.size(),tmp.data(),entry_less);
+        check_same(t,expected);
+
+        if (len > 0) {
+            std::vector<sort_entry_t> o = v;
+            std_merge_sort(NULL,o.data(),(int)o.size(),tmp.data(),old_cmp,old_copy);
+            check_same(o,expected);
+        }
+    }
+}
+
+TEST(std_mergesort_test, presorted)
+{
+    std::vector<uint64_t> v(10000);
+    for (size_t ix = 0; ix < v.size() ; ++ix) v[ix] = v.size() - ix;
+    std::vector<uint64_t> tmp(v.size());
+    std_merge_sort_typed(v.data(),v.size(),tmp.data(),[](uint64_t a, uint64_t b) { return a < b; });
+    ASSERT_TRUE(std::is_sorted(v.begin(),v.end()));
+    std_merge_sort_typed(v.data(),v.size(),tmp.data(),[](uint64_t a, uint64_t b) { return a < b; });
+    ASSERT_TRUE(std::is_sorted(v.begin(),v.end()));
+}
+
+TEST(std_mergesort_test, parallel)
+{
+    std_thread_create_param_t param;
+    std_thread_init_struct(&param);
+    param.name = "sort";
+    std_thread_pool_handle_t pool;
+    ASSERT_EQ(std_thread_pool_create(&pool,&param,4),STD_ERR_OK);
+
+    const size_t sizes[] = { 10, 100000, 300001 };
+    const size_t threads[] = { 1, 3, 4, 8 };
+    for (auto len : sizes) {
+        std::vector<sort_entry_t> v = make_entries(len,len/8+1);
+        std::vector<sort_entry_t> expected = v;
+        std::stable_sort(expected.begin(),expected.end(),entry_less);
+        std::vector<sort_entry_t> tmp(len);
+        for (auto t : threads) {
+            std::vector<sort_entry_t> p = v;
+            std_merge_sort_parallel(pool,t,NULL,p.data(),(int)p.size(),tmp.data(),old_cmp,old_copy);
+            check_same(p,expected);
+        }
+    }
+    std_thread_pool_delete(pool);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
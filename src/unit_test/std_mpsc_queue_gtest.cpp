@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_mpsc_queue_gtest.cpp
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include "gtest/gtest.h"
+
+#include "std_mpsc_queue.h"
+
+#include <vector>
+
+typedef struct {
+    std_mpsc_node link;
+    size_t producer;
+    size_t seq;
+} work_t;
+
+enum { PRODUCERS = 4, ITEMS = 100000 };
+
+static std_mpsc_queue_t queue;
+static std::vector<work_t> work[PRODUCERS];
+
+static void *producer(void *param) {
+    size_t id = *(size_t*)param;
+    size_t ix = 0;
+    for ( ; ix < ITEMS ; ++ix ) {
+        std_mpsc_queue_push(&queue,&work[id][ix].link);
+    }
+    return NULL;
+}
+
+static void run(bool wait) {
+    ASSERT_EQ(std_mpsc_queue_init(&queue,wait),STD_ERR_OK);
+    ASSERT_TRUE(std_mpsc_queue_empty(&queue));
+    ASSERT_TRUE(std_mpsc_queue_pop(&queue)==NULL);
+
+    pthread_t threads[PRODUCERS];
+    size_t ids[PRODUCERS];
+    size_t ix = 0;
+    for ( ; ix < PRODUCERS ; ++ix ) {
+        ids[ix] = ix;
+        work[ix].resize(ITEMS);
+        for (size_t seq = 0; seq < ITEMS ; ++seq) {
+            work[ix][seq].producer = ix;
+            work[ix][seq].seq = seq;
+        }
+        pthread_create(&threads[ix],NULL,producer,&ids[ix]);
+    }
+
+    /* items from each producer come out in the order they were pushed */
+    size_t next[PRODUCERS] = {0};
+    size_t total = 0;
+    while (total < PRODUCERS * ITEMS) {
+        std_mpsc_node *n = wait ? std_mpsc_queue_pop_wait(&queue,1000) : std_mpsc_queue_pop(&queue);
+        if (n==NULL) {
+            ASSERT_FALSE(wait);
+            continue;
+        }
+        work_t *w = (work_t*)n;
+        ASSERT_EQ(w->seq,next[w->producer]);
+        ++next[w->producer];
+        ++total;
+    }
+    for ( ix = 0 ; ix < PRODUCERS ; ++ix ) {
+        pthread_join(threads[ix],NULL);
+    }
+    ASSERT_TRUE(std_mpsc_queue_empty(&queue));
+    if (wait) {
+        ASSERT_TRUE(std_mpsc_queue_pop_wait(&queue,10)==NULL);
+    }
+    std_mpsc_queue_destroy(&queue);
+}
+
+TEST(std_mpsc_queue_test, poll)
+{
+    run(false);
+}
+
+TEST(std_mpsc_queue_test, wait)
+{
+    run(true);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
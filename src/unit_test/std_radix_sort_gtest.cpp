@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_radix_sort_gtest.cpp
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtest/gtest.h"
+
+#include "std_radix_sort.h"
+
+#include <algorithm>
+#include <vector>
+
+typedef struct {
+    uint32_t seq;
+    uint32_t key32;
+    uint64_t key64;
+    uint8_t addr[16];
+} radix_entry_t;
+
+static std::vector<radix_entry_t> make_entries(size_t len, uint64_t range) {
+    std::vector<radix_entry_t> v(len);
+    for (size_t ix = 0; ix < len ; ++ix) {
+        uint64_t r = (((uint64_t)rand() << 31) ^ rand()) % range;
+        v[ix].seq = ix;
+        v[ix].key32 = (uint32_t)r;
+        v[ix].key64 = r << 20;
+        memset(v[ix].addr, 0, sizeof(v[ix].addr));
+        /* only the last few bytes of the address vary - like a subnet */
+        memcpy(v[ix].addr + 12, &r, 4);
+    }
+    return v;
+}
+
+static void check_sort(size_t len, uint64_t range) {
+    std::vector<radix_entry_t> v = make_entries(len, range);
+    std::vector<radix_entry_t> tmp(len);
+    std::vector<radix_entry_t> ref;
+
+    ref = v;
+    std::stable_sort(ref.begin(), ref.end(),
+        [](const radix_entry_t &a, const radix_entry_t &b) { return a.key32 < b.key32; });
+    std::vector<radix_entry_t> s32 = v;
+    std_radix_sort_u32(s32.data(), len, sizeof(radix_entry_t),
+                       offsetof(radix_entry_t, key32), tmp.data());
+    for (size_t ix = 0; ix < len ; ++ix) ASSERT_EQ(ref[ix].seq, s32[ix].seq);
+
+    ref = v;
+    std::stable_sort(ref.begin(), ref.end(),
+        [](const radix_entry_t &a, const radix_entry_t &b) { return a.key64 < b.key64; });
+    std::vector<radix_entry_t> s64 = v;
+    std_radix_sort_u64(s64.data(), len, sizeof(radix_entry_t),
+                       offsetof(radix_entry_t, key64), tmp.data());
+    for (size_t ix = 0; ix < len ; ++ix) ASSERT_EQ(ref[ix].seq, s64[ix].seq);
+
+    ref = v;
+    std::stable_sort(ref.begin(), ref.end(),
+        [](const radix_entry_t &a, const radix_entry_t &b) {
+            return memcmp(a.addr, b.addr, sizeof(a.addr)) < 0; });
+    std::vector<radix_entry_t> sb = v;
+    std_radix_sort_bytes(sb.data(), len, sizeof(radix_entry_t),
+                         offsetof(radix_entry_t, addr), sizeof(sb[0].addr), tmp.data());
+    for (size_t ix = 0; ix < len ; ++ix) ASSERT_EQ(ref[ix].seq, sb[ix].seq);
+}
+
+TEST(std_radix_sort, small) {
+    check_sort(0, 10);
+    check_sort(1, 10);
+    check_sort(63, 10);
+    check_sort(64, 10);
+}
+
+TEST(std_radix_sort, stable_duplicates) {
+    check_sort(10000, 17);
+}
+
+TEST(std_radix_sort, wide_keys) {
+    check_sort(100000, 1ULL << 40);
+}
+
+TEST(std_radix_sort, already_sorted) {
+    std::vector<radix_entry_t> v = make_entries(5000, 1 << 30);
+    std::vector<radix_entry_t> tmp(v.size());
+    std_radix_sort_u32(v.data(), v.size(), sizeof(radix_entry_t),
+                       offsetof(radix_entry_t, key32), tmp.data());
+    std_radix_sort_u32(v.data(), v.size(), sizeof(radix_entry_t),
+                       offsetof(radix_entry_t, key32), tmp.data());
+    for (size_t ix = 1; ix < v.size() ; ++ix) ASSERT_LE(v[ix-1].key32, v[ix].key32);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
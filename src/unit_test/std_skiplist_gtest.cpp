@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_skiplist_gtest.cpp
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "std_skiplist.h"
+
+typedef struct {
+    std_skiplist_node node;
+    uint32_t expiry;
+    uint32_t seq;
+} sl_timer_t;
+
+static void check_sorted(std_skiplist_head *head, size_t expected) {
+    size_t count = 0;
+    sl_timer_t *prev = NULL;
+    /* the base list can be walked with the plain std_dll calls */
+    std_dll *walk = std_dll_getfirst(&head->list);
+    for ( ; walk != NULL ; walk = std_dll_getnext(&head->list,walk) ) {
+        sl_timer_t *t = (sl_timer_t*)walk;
+        if (prev!=NULL) {
+            ASSERT_LE(prev->expiry,t->expiry);
+            if (prev->expiry==t->expiry) ASSERT_LT(prev->seq,t->seq);
+        }
+        prev = t;
+        ++count;
+    }
+    ASSERT_EQ(count,expected);
+    ASSERT_EQ(std_skiplist_count(head),expected);
+}
+
+TEST(std_skiplist_test, insert_remove)
+{
+    std_skiplist_head head;
+    std_skiplist_init(&head,std_compare_uint32_function,offsetof(sl_timer_t,expiry),sizeof(uint32_t));
+
+    const size_t mx = 50000;
+    std::vector<sl_timer_t> timers(mx);
+    srand(1);
+    size_t ix = 0;
+    for ( ; ix < mx ; ++ix ) {
+        timers[ix].expiry = rand() % (mx/4);
+        timers[ix].seq = ix;
+        std_skiplist_insert(&head,&timers[ix].node);
+    }
+    check_sorted(&head,mx);
+
+    sl_timer_t key;
+    for ( ix = 0 ; ix < 1000 ; ++ix ) {
+        key.expiry = timers[ix].expiry;
+        sl_timer_t *t = (sl_timer_t*)std_skiplist_getexact(&head,&key);
+        ASSERT_TRUE(t!=NULL);
+        ASSERT_EQ(t->expiry,key.expiry);
+        /* the first of the equal keys is returned */
+        sl_timer_t *prev = (sl_timer_t*)std_dll_getprev(&head.list,&t->node.dll);
+        ASSERT_TRUE(prev==NULL || prev->expiry < key.expiry);
+    }
+    key.expiry = mx;
+    ASSERT_TRUE(std_skiplist_getexactornext(&head,&key)==NULL);
+    key.expiry = 0;
+    ASSERT_EQ(std_skiplist_getexactornext(&head,&key),std_skiplist_getfirst(&head));
+
+    for ( ix = 0 ; ix < mx ; ix += 2 ) {
+        std_skiplist_remove(&head,&timers[ix].node);
+    }
+    check_sorted(&head,mx/2);
+
+    /* drain from the front like a timer list */
+    std_skiplist_node *n;
+    while ((n = std_skiplist_getfirst(&head))!=NULL) {
+        std_skiplist_remove(&head,n);
+    }
+    check_sorted(&head,0);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_bench.cpp
+ */
+
+/*
+ * TLV encode/decode benchmark.  Not a unit test - run it by hand and keep the
+ * output to compare against later runs.
+ *
+ *   std_tlv_bench [-j] [-t ms] [filter]
+ *      -j      JSON lines instead of CSV
+ *      -t ms   the time to spend on each measurement (default 200)
+ *      filter  only run the cases whose name contains it
+ *
+ * Each line is one operation on one message shape with the ns per attribute
+ * and the bytes of message handled a second.  Every case checks what it read
+ * back and the program exits with 1 if anything is wrong.
+ */
+
+#include "std_tlv.h"
+#include "std_tlv_builder.h"
+#include "std_tlv_index.h"
+#include "std_tlv_schema.h"
+#include "std_tlv_varint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+static bool json = false;
+static double min_ms = 200;
+static const char *filter = NULL;
+static int failures = 0;
+/* results are added in here so that the compiler can't drop the work */
+static volatile uint64_t sink;
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const std::string &shape, const char *op, size_t attrs, size_t bytes,
+        double ns_per_msg) {
+    double ns_attr = ns_per_msg / attrs;
+    double bps = bytes / (ns_per_msg / 1e9);
+    if (json) {
+        printf("{\"shape\":\"%s\",\"op\":\"%s\",\"attrs\":%zu,\"bytes\":%zu,"
+               "\"ns_per_attr\":%.2f,\"bytes_per_sec\":%.0f}\n",
+               shape.c_str(), op, attrs, bytes, ns_attr, bps);
+    } else {
+        printf("%s,%s,%zu,%zu,%.2f,%.0f\n", shape.c_str(), op, attrs, bytes, ns_attr, bps);
+    }
+    fflush(stdout);
+}
+
+/* run fn until min_ms has passed and return the ns per call */
+template <typename F>
+static double measure(F fn) {
+    size_t iters = 1;
+    for ( ;; ) {
+        double start = now_ns();
+        for (size_t ix = 0; ix < iters; ++ix) fn();
+        double took = now_ns() - start;
+        if (took >= min_ms * 1e6) return took / iters;
+        /* aim a bit past the target */
+        size_t next = (took <= 0) ? iters * 10 : (size_t)(iters * (min_ms * 1.2e6 / took)) + 1;
+        iters = (next > iters * 10) ? iters * 10 : next;
+    }
+}
+
+static void check(bool ok, const std::string &shape, const char *op) {
+    if (!ok) {
+        fprintf(stderr, "FAIL %s %s\n", shape.c_str(), op);
+        ++failures;
+    }
+}
+
+static bool selected(const std::string &shape) {
+    return filter == NULL || shape.find(filter) != std::string::npos;
+}
+
+/* flat message of n u32 attributes with tags 0..n-1 */
+static void bench_flat(size_t n) {
+    std::string shape = "flat_" + std::to_string(n);
+    if (!selected(shape)) return;
+
+    std::vector<uint8_t> buf(n * (STD_TLV_HDR_LEN + sizeof(uint32_t)));
+    size_t len = buf.size();
+    uint64_t expect = (uint64_t)n * (n - 1) / 2;
+
+    double t = measure([&]() {
+        size_t left = buf.size();
+        void *p = &buf[0];
+        for (size_t ix = 0; ix < n; ++ix) p = std_tlv_add_u32(p, &left, ix, ix);
+        sink += left;
+    });
+    report(shape, "add_u32", n, len, t);
+
+    uint64_t sum = 0;
+    t = measure([&]() {
+        size_t left = len;
+        sum = 0;
+        for (void *p = &buf[0]; p != NULL && left > 0; p = std_tlv_next(p, &left))
+            sum += std_tlv_data_u32(p);
+        sink += sum;
+    });
+    check(sum == expect, shape, "iterate");
+    report(shape, "iterate", n, len, t);
+
+    /* fetch every attribute by tag - quadratic so skip the big shapes */
+    if (n <= 1000) {
+        t = measure([&]() {
+            sum = 0;
+            for (size_t ix = 0; ix < n; ++ix) {
+                size_t left = len;
+                void *p = std_tlv_find_next(&buf[0], &left, ix);
+                if (p != NULL) sum += std_tlv_data_u32(p);
+            }
+            sink += sum;
+        });
+        check(sum == expect, shape, "find_next_each");
+        report(shape, "find_next_each", n, len, t);
+    }
+
+    std_tlv_index_t *idx = std_tlv_index_create();
+    t = measure([&]() {
+        sum = 0;
+        std_tlv_index_build(idx, &buf[0], len);
+        for (size_t ix = 0; ix < n; ++ix) {
+            void *p = std_tlv_index_find(idx, ix);
+            if (p != NULL) sum += std_tlv_data_u32(p);
+        }
+        sink += sum;
+    });
+    check(sum == expect, shape, "index_find_each");
+    report(shape, "index_find_each", n, len, t);
+    std_tlv_index_free(idx);
+
+    t = measure([&]() {
+        sink += (std_tlv_validate(&buf[0], len, NULL, NULL) == STD_ERR_OK);
+    });
+    report(shape, "validate", n, len, t);
+
+    std::vector<std_tlv_field_t> fields(n);
+    for (size_t ix = 0; ix < n; ++ix) {
+        std_tlv_field_t f = { ix, STD_TLV_FIELD_U32, ix * sizeof(uint32_t), 0,
+                              STD_TLV_NO_FIELD, NULL };
+        fields[ix] = f;
+    }
+    std_tlv_schema_t *schema = std_tlv_schema_create(&fields[0], n);
+    std::vector<uint32_t> obj(n);
+    t = measure([&]() {
+        sink += (std_tlv_extract(schema, &buf[0], len, &obj[0], NULL) == STD_ERR_OK);
+    });
+    sum = 0;
+    for (auto v : obj) sum += v;
+    check(sum == expect, shape, "schema_extract");
+    report(shape, "schema_extract", n, len, t);
+    std_tlv_schema_free(schema);
+
+    std_tlv_builder_t *b = std_tlv_builder_create(0);
+    t = measure([&]() {
+        std_tlv_builder_reset(b);
+        for (size_t ix = 0; ix < n; ++ix) std_tlv_builder_add_u32(b, ix, ix);
+        sink += std_tlv_builder_len(b);
+    });
+    check(std_tlv_builder_len(b) == len, shape, "builder_add_u32");
+    report(shape, "builder_add_u32", n, len, t);
+    std_tlv_builder_free(b);
+
+    /* the varint format */
+    size_t vlen = 0;
+    std_tlv_to_vtlv(&buf[0], len, NULL, &vlen, NULL, NULL);
+    std::vector<uint8_t> vbuf(vlen);
+    t = measure([&]() {
+        size_t l = vbuf.size();
+        sink += (std_tlv_to_vtlv(&buf[0], len, &vbuf[0], &l, NULL, NULL) == STD_ERR_OK);
+    });
+    report(shape, "to_vtlv", n, len, t);
+
+    t = measure([&]() {
+        size_t left = vbuf.size();
+        void *p = std_vtlv_start(&vbuf[0], &left);
+        for (size_t ix = 0; ix < n; ++ix) p = std_vtlv_add_u32(p, &left, ix, ix);
+        sink += left;
+    });
+    report(shape, "vtlv_add_u32", n, vlen, t);
+
+    t = measure([&]() {
+        size_t left = vlen;
+        sum = 0;
+        for (void *p = std_vtlv_first(&vbuf[0], &left); p != NULL && left > 0;
+                p = std_vtlv_next(p, &left))
+            sum += std_vtlv_data_u32(p);
+        sink += sum;
+    });
+    check(sum == expect, shape, "vtlv_iterate");
+    report(shape, "vtlv_iterate", n, vlen, t);
+}
+
+/*
+ * depth levels of nesting, each level with 'width' u32 attributes and one
+ * nested attribute (tag width) holding the next level
+ */
+static size_t build_nested(std::vector<uint8_t> &out, size_t depth, size_t width) {
+    std::vector<uint8_t> inner;
+    for (size_t level = 0; level < depth; ++level) {
+        std::vector<uint8_t> cur(width * (STD_TLV_HDR_LEN + 4) + STD_TLV_HDR_LEN + inner.size());
+        size_t left = cur.size();
+        void *p = &cur[0];
+        for (size_t ix = 0; ix < width; ++ix) p = std_tlv_add_u32(p, &left, ix, level);
+        if (level > 0) p = std_tlv_add(p, &left, width, inner.size(), &inner[0]);
+        cur.resize(cur.size() - left);
+        inner.swap(cur);
+    }
+    out.swap(inner);
+    return depth * width + (depth - 1);
+}
+
+static void bench_nested(size_t depth) {
+    const size_t width = 10;
+    std::string shape = "nested_" + std::to_string(depth);
+    if (!selected(shape)) return;
+
+    std::vector<uint8_t> buf;
+    size_t attrs = build_nested(buf, depth, width);
+    size_t len = buf.size();
+
+    /* path to the last attribute of the innermost level */
+    std::vector<std_tlv_tag_t> path(depth - 1, width);
+    path.push_back(width - 1);
+
+    uint64_t got = ~0ULL;
+    double t = measure([&]() {
+        size_t l = len;
+        void *p = std_tlv_efind(&buf[0], &l, &path[0], path.size());
+        got = (p != NULL) ? std_tlv_data_u32(p) : ~0ULL;
+        sink += got;
+    });
+    check(got == 0, shape, "efind");
+    report(shape, "efind", attrs, len, t);
+
+    std_tlv_index_t *idx = std_tlv_index_create();
+    t = measure([&]() {
+        size_t l;
+        std_tlv_index_build(idx, &buf[0], len);
+        void *p = std_tlv_index_efind(idx, &path[0], path.size(), &l);
+        got = (p != NULL) ? std_tlv_data_u32(p) : ~0ULL;
+        sink += got;
+    });
+    check(got == 0, shape, "index_efind");
+    report(shape, "index_efind", attrs, len, t);
+    std_tlv_index_free(idx);
+
+    auto nested = [](void *ctx, std_tlv_tag_t tag) { return tag == *(size_t *)ctx; };
+    size_t ctx = width;
+    t = measure([&]() {
+        sink += (std_tlv_validate(&buf[0], len, nested, &ctx) == STD_ERR_OK);
+    });
+    report(shape, "validate", attrs, len, t);
+
+    std_tlv_builder_t *b = std_tlv_builder_create(0);
+    t = measure([&]() {
+        std_tlv_builder_reset(b);
+        for (size_t level = depth; level-- > 0; ) {
+            for (size_t ix = 0; ix < width; ++ix) std_tlv_builder_add_u32(b, ix, level);
+            if (level > 0) std_tlv_builder_open(b, width);
+        }
+        for (size_t level = 1; level < depth; ++level) std_tlv_builder_close(b);
+        sink += std_tlv_builder_len(b);
+    });
+    check(std_tlv_builder_len(b) == len, shape, "builder_nested");
+    report(shape, "builder_nested", attrs, len, t);
+    std_tlv_builder_free(b);
+}
+
+/* a few attributes with large binary values */
+static void bench_blob(size_t blob_len) {
+    const size_t count = 4;
+    std::string shape = "blob_" + std::to_string(blob_len);
+    if (!selected(shape)) return;
+
+    std::vector<uint8_t> blob(blob_len, 0xa5);
+    std::vector<uint8_t> buf(count * (STD_TLV_HDR_LEN + blob_len));
+    size_t len = buf.size();
+
+    double t = measure([&]() {
+        size_t left = buf.size();
+        void *p = &buf[0];
+        for (size_t ix = 0; ix < count; ++ix) p = std_tlv_add(p, &left, ix, blob_len, &blob[0]);
+        sink += left;
+    });
+    report(shape, "add", count, len, t);
+
+    std_tlv_builder_t *b = std_tlv_builder_create(0);
+    t = measure([&]() {
+        std_tlv_builder_reset(b);
+        for (size_t ix = 0; ix < count; ++ix) std_tlv_builder_add_ref(b, ix, &blob[0], blob_len);
+        const struct iovec *iov;
+        size_t n;
+        std_tlv_builder_iov(b, &iov, &n);
+        sink += n;
+    });
+    check(std_tlv_builder_len(b) == len, shape, "builder_add_ref");
+    report(shape, "builder_add_ref", count, len, t);
+    std_tlv_builder_free(b);
+
+    uint64_t seen = 0;
+    t = measure([&]() {
+        size_t left = len;
+        seen = 0;
+        for (void *p = &buf[0]; p != NULL && left > 0; p = std_tlv_next(p, &left))
+            seen += std_tlv_len(p);
+        sink += seen;
+    });
+    check(seen == count * blob_len, shape, "iterate");
+    report(shape, "iterate", count, len, t);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "jt:")) != -1) {
+        switch (opt) {
+        case 'j':
+            json = true;
+            break;
+        case 't':
+            min_ms = atof(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-j] [-t ms] [filter]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind < argc) filter = argv[optind];
+
+    if (!json) printf("shape,op,attrs,bytes,ns_per_attr,bytes_per_sec\n");
+
+    bench_flat(10);
+    bench_flat(100);
+    bench_flat(1000);
+    bench_nested(3);
+    bench_nested(5);
+    bench_blob(4096);
+    bench_blob(1 << 20);
+
+    return failures ? 1 : 0;
+}
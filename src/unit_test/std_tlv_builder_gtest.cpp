@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_builder_gtest.cpp
+ */
+
+#include "std_tlv_builder.h"
+#include "std_socket_tools.h"
+
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "gtest/gtest.h"
+
+#include <vector>
+
+static std::vector<uint8_t> flat(std_tlv_builder_t *b) {
+    std::vector<uint8_t> out(std_tlv_builder_len(b));
+    EXPECT_EQ(STD_ERR_OK,std_tlv_builder_copy(b,out.data(),out.size()));
+    return out;
+}
+
+TEST(std_tlv_builder, same_as_std_tlv_add) {
+    std::vector<uint8_t> blob(10000);
+    for (size_t ix = 0; ix < blob.size() ; ++ix) blob[ix] = rand();
+
+    /* the reference built by hand */
+    std::vector<uint8_t> inner(256), mid(1024), ref(20000);
+    size_t ilen = inner.size(), mlen = mid.size(), rlen = ref.size();
+    void *p = inner.data();
+    p = std_tlv_add_u16(p,&ilen,5,0x1234);
+    p = std_tlv_add(p,&ilen,6,3,"abc");
+    ilen = inner.size() - ilen;
+    p = mid.data();
+    p = std_tlv_add_u64(p,&mlen,3,77);
+    p = std_tlv_add(p,&mlen,4,ilen,inner.data());
+    mlen = mid.size() - mlen;
+    p = ref.data();
+    p = std_tlv_add_u32(p,&rlen,1,42);
+    p = std_tlv_add(p,&rlen,2,mlen,mid.data());
+    p = std_tlv_add(p,&rlen,9,blob.size(),blob.data());
+    p = std_tlv_add(p,&rlen,10,0,NULL);
+    rlen = ref.size() - rlen;
+    ref.resize(rlen);
+
+    /* small chunks so that the message spans several and the blob gets its own */
+    for (size_t chunk : {0, 24, 100, 20000}) {
+        std_tlv_builder_t *b = std_tlv_builder_create(chunk);
+        ASSERT_TRUE(b!=NULL);
+        for (int round = 0; round < 3 ; ++round) {
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_add_u32(b,1,42));
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_open(b,2));
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_add_u64(b,3,77));
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_open(b,4));
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_add_u16(b,5,0x1234));
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_add(b,6,"abc",3));
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_close(b));
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_close(b));
+            if (round & 1) {
+                ASSERT_EQ(STD_ERR_OK,std_tlv_builder_add(b,9,blob.data(),blob.size()));
+            } else {
+                ASSERT_EQ(STD_ERR_OK,std_tlv_builder_add_ref(b,9,blob.data(),blob.size()));
+            }
+            ASSERT_EQ(STD_ERR_OK,std_tlv_builder_add(b,10,NULL,0));
+            ASSERT_EQ(ref,flat(b));
+            std_tlv_builder_reset(b);
+            ASSERT_EQ(0,std_tlv_builder_len(b));
+        }
+        std_tlv_builder_free(b);
+    }
+}
+
+TEST(std_tlv_builder, reference_not_copied) {
+    std::vector<uint8_t> blob(100000,7);
+    std_tlv_builder_t *b = std_tlv_builder_create(0);
+    for (int ix = 0; ix < 100 ; ++ix) std_tlv_builder_add_u32(b,ix,ix);
+    std_tlv_builder_add_ref(b,1000,blob.data(),blob.size());
+    std_tlv_builder_add_u32(b,1001,1);
+
+    const struct iovec *iov;
+    size_t n;
+    ASSERT_EQ(STD_ERR_OK,std_tlv_builder_iov(b,&iov,&n));
+    /* the small TLVs share chunks - only the blob stands alone */
+    ASSERT_EQ(3,n);
+    ASSERT_EQ(blob.data(),iov[1].iov_base);
+    ASSERT_EQ(blob.size(),iov[1].iov_len);
+
+    /* the change shows up in the message */
+    blob[0] = 8;
+    std::vector<uint8_t> out = flat(b);
+    size_t len = out.size();
+    std_tlv_tag_t path[] = {1000};
+    void *t = std_tlv_efind(out.data(),&len,path,1);
+    ASSERT_TRUE(t!=NULL);
+    ASSERT_EQ(8,((uint8_t*)std_tlv_data(t))[0]);
+    std_tlv_builder_free(b);
+}
+
+TEST(std_tlv_builder, errors) {
+    std_tlv_builder_t *b = std_tlv_builder_create(0);
+    const struct iovec *iov;
+    size_t n;
+    uint8_t buf[64];
+
+    ASSERT_NE(STD_ERR_OK,std_tlv_builder_close(b));
+    std_tlv_builder_open(b,1);
+    ASSERT_NE(STD_ERR_OK,std_tlv_builder_iov(b,&iov,&n));
+    ASSERT_NE(STD_ERR_OK,std_tlv_builder_copy(b,buf,sizeof(buf)));
+    std_tlv_builder_add(b,2,buf,sizeof(buf));
+    std_tlv_builder_close(b);
+    ASSERT_EQ(STD_ERR_OK,std_tlv_builder_iov(b,&iov,&n));
+    ASSERT_NE(STD_ERR_OK,std_tlv_builder_copy(b,buf,sizeof(buf)));
+    std_tlv_builder_free(b);
+}
+
+TEST(std_tlv_builder, send) {
+    int fds[2];
+    ASSERT_EQ(0,socketpair(AF_UNIX,SOCK_STREAM,0,fds));
+    std::vector<uint8_t> blob(3000,1);
+
+    std_tlv_builder_t *b = std_tlv_builder_create(0);
+    std_tlv_builder_open(b,1);
+    std_tlv_builder_add_u32(b,2,2);
+    std_tlv_builder_add_ref(b,3,blob.data(),blob.size());
+    std_tlv_builder_close(b);
+
+    const struct iovec *iov;
+    size_t n;
+    ASSERT_EQ(STD_ERR_OK,std_tlv_builder_iov(b,&iov,&n));
+    std_socket_msg_t msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = (struct iovec*)iov;
+    msg.msg_iovlen = n;
+    t_std_error rc = STD_ERR_OK;
+    ASSERT_EQ((ssize_t)std_tlv_builder_len(b),std_socket_op(std_socket_transit_o_WRITE,fds[0],&msg,
+            std_socket_transit_f_ALL,0,&rc));
+
+    std::vector<uint8_t> got(std_tlv_builder_len(b));
+    ASSERT_EQ((ssize_t)got.size(),read(fds[1],got.data(),got.size()));
+    ASSERT_EQ(flat(b),got);
+    ASSERT_EQ(got.size() - STD_TLV_HDR_LEN,std_tlv_len(got.data()));
+    std_tlv_builder_free(b);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_codec_gtest.cpp
+ */
+
+#include "std_tlv_codec.h"
+
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+enum class test_state_t : uint8_t { DOWN = 0, UP = 1, TESTING = 2 };
+
+struct test_peer_t {
+    uint32_t ifindex;
+    uint64_t mac;
+};
+
+struct test_intf_t {
+    uint8_t admin;
+    uint16_t vlan;
+    uint32_t ifindex;
+    uint64_t speed;
+    int32_t offset;
+    bool lag;
+    test_state_t state;
+    std::string name;
+    std::vector<uint8_t> blob;
+    test_peer_t peer;
+};
+
+enum { T_ADMIN=1, T_VLAN, T_IFINDEX, T_SPEED, T_OFFSET, T_LAG, T_STATE, T_NAME, T_BLOB,
+       T_PEER, T_PEER_IFINDEX, T_PEER_MAC };
+
+typedef std_tlv_schema<test_peer_t,
+        STD_TLV_FIELD(test_peer_t, ifindex, T_PEER_IFINDEX),
+        STD_TLV_FIELD(test_peer_t, mac, T_PEER_MAC)> test_peer_schema;
+
+typedef std_tlv_schema<test_intf_t,
+        STD_TLV_FIELD(test_intf_t, admin, T_ADMIN),
+        STD_TLV_FIELD(test_intf_t, vlan, T_VLAN),
+        STD_TLV_FIELD(test_intf_t, ifindex, T_IFINDEX),
+        STD_TLV_FIELD(test_intf_t, speed, T_SPEED),
+        STD_TLV_FIELD(test_intf_t, offset, T_OFFSET),
+        STD_TLV_FIELD(test_intf_t, lag, T_LAG),
+        STD_TLV_FIELD(test_intf_t, state, T_STATE),
+        STD_TLV_FIELD(test_intf_t, name, T_NAME),
+        STD_TLV_FIELD(test_intf_t, blob, T_BLOB),
+        STD_TLV_NESTED(test_intf_t, peer, T_PEER, test_peer_schema)> test_intf_schema;
+
+static_assert(test_peer_schema::fixed, "all fixed");
+static_assert(test_peer_schema::fixed_size == 2*STD_TLV_HDR_LEN + 4 + 8, "size");
+static_assert(!test_intf_schema::fixed, "has strings");
+
+static test_intf_t make_intf() {
+    test_intf_t i;
+    i.admin = 1;
+    i.vlan = 4000;
+    i.ifindex = 0x12345678;
+    i.speed = 100000000000ULL;
+    i.offset = -5;
+    i.lag = true;
+    i.state = test_state_t::TESTING;
+    i.name = "e101-001-0";
+    i.blob.assign(100,0x5a);
+    i.peer.ifindex = 7;
+    i.peer.mac = 0x0011223344ULL;
+    return i;
+}
+
+TEST(std_tlv_codec, round_trip) {
+    test_intf_t in = make_intf();
+    uint8_t buf[1024];
+    size_t len = test_intf_schema::encode(in,buf,sizeof(buf));
+    ASSERT_EQ(test_intf_schema::encode_size(in),len);
+    ASSERT_EQ(10*STD_TLV_HDR_LEN + 1+2+4+8+4+1+1+10+100 + test_peer_schema::fixed_size,len);
+
+    test_intf_t out;
+    out.offset = 0;
+    ASSERT_TRUE(test_intf_schema::decode(out,buf,len));
+    ASSERT_EQ(in.admin,out.admin);
+    ASSERT_EQ(in.vlan,out.vlan);
+    ASSERT_EQ(in.ifindex,out.ifindex);
+    ASSERT_EQ(in.speed,out.speed);
+    ASSERT_EQ(in.offset,out.offset);
+    ASSERT_EQ(in.lag,out.lag);
+    ASSERT_TRUE(in.state == out.state);
+    ASSERT_EQ(in.name,out.name);
+    ASSERT_EQ(in.blob,out.blob);
+    ASSERT_EQ(in.peer.ifindex,out.peer.ifindex);
+    ASSERT_EQ(in.peer.mac,out.peer.mac);
+
+    ASSERT_EQ(0,test_intf_schema::encode(in,buf,len-1));
+}
+
+TEST(std_tlv_codec, same_as_std_tlv) {
+    test_intf_t in = make_intf();
+    uint8_t buf[1024];
+    size_t len = test_intf_schema::encode(in,buf,sizeof(buf));
+
+    size_t rest = len;
+    void *t = std_tlv_find_next(buf,&rest,T_IFINDEX);
+    ASSERT_TRUE(t!=NULL);
+    ASSERT_EQ(in.ifindex,std_tlv_data_u32(t));
+    rest = len;
+    t = std_tlv_find_next(buf,&rest,T_VLAN);
+    ASSERT_EQ(in.vlan,std_tlv_data_u16(t));
+    std_tlv_tag_t path[] = { T_PEER, T_PEER_MAC };
+    rest = len;
+    t = std_tlv_efind(buf,&rest,path,2);
+    ASSERT_TRUE(t!=NULL);
+    ASSERT_EQ(in.peer.mac,std_tlv_data_u64(t));
+
+    /* and a hand built message decodes, skipping what it doesn't know */
+    uint8_t msg[256];
+    size_t left = sizeof(msg);
+    void *p = msg;
+    p = std_tlv_add_u32(p,&left,999,1);
+    p = std_tlv_add_u64(p,&left,T_SPEED,42);
+    p = std_tlv_add(p,&left,T_NAME,3,"abc");
+    test_intf_t out = make_intf();
+    ASSERT_TRUE(test_intf_schema::decode(out,msg,sizeof(msg)-left));
+    ASSERT_EQ(42,out.speed);
+    ASSERT_EQ("abc",out.name);
+    ASSERT_EQ(in.ifindex,out.ifindex);
+}
+
+TEST(std_tlv_codec, bad_input) {
+    test_intf_t in = make_intf();
+    uint8_t buf[1024];
+    size_t len = test_intf_schema::encode(in,buf,sizeof(buf));
+    test_intf_t out;
+    ASSERT_FALSE(test_intf_schema::decode(out,buf,len-1));
+    ASSERT_FALSE(test_intf_schema::decode(out,buf,len+3));
+
+    /* a u32 member sent as a u64 */
+    uint8_t msg[64];
+    size_t left = sizeof(msg);
+    std_tlv_add_u64(msg,&left,T_IFINDEX,1);
+    ASSERT_FALSE(test_intf_schema::decode(out,msg,sizeof(msg)-left));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
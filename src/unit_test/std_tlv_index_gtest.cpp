@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_index_gtest.cpp
+ */
+
+#include "std_tlv_index.h"
+
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+#include <vector>
+
+/* 50 attributes in random tag order with some repeats and 3 nested levels */
+static size_t build_msg(std::vector<uint8_t> &buf) {
+    buf.assign(16384,0);
+    size_t left = buf.size();
+    void *p = &buf[0];
+    for (int ix = 0; ix < 50 ; ++ix) {
+        p = std_tlv_add_u32(p,&left,(ix * 37) % 45,ix);
+    }
+
+    uint8_t inner[256], mid[512];
+    size_t ilen = sizeof(inner), mlen = sizeof(mid);
+    void *q = inner;
+    q = std_tlv_add_u64(q,&ilen,7,0x1122334455667788ULL);
+    q = std_tlv_add_u16(q,&ilen,3,99);
+    ilen = sizeof(inner) - ilen;
+
+    q = mid;
+    q = std_tlv_add_u32(q,&mlen,1,1);
+    q = std_tlv_add(q,&mlen,2,ilen,inner);
+    mlen = sizeof(mid) - mlen;
+
+    p = std_tlv_add(p,&left,100,mlen,mid);
+    /* not TLVs inside */
+    p = std_tlv_add(p,&left,101,5,"abcde");
+    return buf.size() - left;
+}
+
+TEST(std_tlv_index, matches_linear_find) {
+    std::vector<uint8_t> buf;
+    size_t len = build_msg(buf);
+    std_tlv_index_t *idx = std_tlv_index_create();
+    ASSERT_TRUE(idx!=NULL);
+    ASSERT_EQ(STD_ERR_OK,std_tlv_index_build(idx,&buf[0],len));
+
+    for (std_tlv_tag_t tag = 0; tag < 110 ; ++tag) {
+        size_t dlen = len;
+        void *expect = std_tlv_find_next(&buf[0],&dlen,tag);
+        ASSERT_EQ(expect,std_tlv_index_find(idx,tag));
+
+        std::vector<void*> all;
+        size_t rest = len;
+        for (void *p = &buf[0]; (p = std_tlv_find_next(p,&rest,tag))!=NULL; p = std_tlv_next(p,&rest)) {
+            all.push_back(p);
+        }
+        void *got[8];
+        size_t n = std_tlv_index_find_all(idx,tag,got,8);
+        ASSERT_EQ(all.size(),n);
+        for (size_t ix = 0; ix < n ; ++ix) ASSERT_EQ(all[ix],got[ix]);
+    }
+    std_tlv_index_free(idx);
+}
+
+TEST(std_tlv_index, nested) {
+    std::vector<uint8_t> buf;
+    size_t len = build_msg(buf);
+    std_tlv_index_t *idx = std_tlv_index_create();
+    ASSERT_EQ(STD_ERR_OK,std_tlv_index_build(idx,&buf[0],len));
+
+    std_tlv_tag_t paths[][3] = { {100,2,7}, {100,2,3}, {100,1,0}, {100,2,9}, {5,1,0}, {101,1,0} };
+    size_t lens[] = { 3, 3, 2, 3, 2, 2 };
+    for (int round = 0; round < 2 ; ++round) {
+        for (size_t ix = 0; ix < sizeof(lens)/sizeof(lens[0]) ; ++ix) {
+            size_t elen = len, glen = 0;
+            void *expect = std_tlv_efind(&buf[0],&elen,paths[ix],lens[ix]);
+            void *got = std_tlv_index_efind(idx,paths[ix],lens[ix],&glen);
+            ASSERT_EQ(expect,got);
+            if (got!=NULL) {
+                ASSERT_EQ(elen,glen);
+            }
+        }
+    }
+    size_t dlen;
+    void *p = std_tlv_index_efind(idx,paths[0],3,&dlen);
+    ASSERT_EQ(0x1122334455667788ULL,std_tlv_data_u64(p));
+    std_tlv_index_free(idx);
+}
+
+TEST(std_tlv_index, invalid) {
+    std::vector<uint8_t> buf;
+    size_t len = build_msg(buf);
+    std_tlv_index_t *idx = std_tlv_index_create();
+
+    ASSERT_NE(STD_ERR_OK,std_tlv_index_build(idx,&buf[0],len-1));
+    ASSERT_NE(STD_ERR_OK,std_tlv_index_build(idx,&buf[0],len+3));
+    ASSERT_TRUE(std_tlv_index_find(idx,0)==NULL);
+
+    /* a length that runs past the end */
+    std_tlv_set_len(&buf[0],len);
+    ASSERT_NE(STD_ERR_OK,std_tlv_index_build(idx,&buf[0],len));
+
+    ASSERT_EQ(STD_ERR_OK,std_tlv_index_build(idx,&buf[0],0));
+    ASSERT_TRUE(std_tlv_index_find(idx,0)==NULL);
+    std_tlv_index_free(idx);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_schema_gtest.cpp
+ */
+
+#include "std_tlv_schema.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+#include <vector>
+
+typedef struct {
+    uint8_t admin;
+    uint16_t vlan;
+    uint32_t ifindex;
+    uint64_t speed;
+    char name[16];
+    size_t name_len;
+    void *blob;
+    size_t blob_len;
+    uint32_t peer_ifindex;
+    uint64_t peer_mac;
+} test_obj_t;
+
+enum { T_ADMIN=1, T_VLAN=2, T_IFINDEX=3, T_SPEED=4, T_NAME=5, T_BLOB=6, T_PEER=7,
+       T_PEER_IFINDEX=8, T_PEER_MAC=9, T_UNKNOWN=10 };
+
+static const std_tlv_field_t peer_fields[] = {
+    { T_PEER_IFINDEX, STD_TLV_FIELD_U32, offsetof(test_obj_t,peer_ifindex), 0, STD_TLV_NO_FIELD, NULL },
+    { T_PEER_MAC, STD_TLV_FIELD_U64, offsetof(test_obj_t,peer_mac), 0, STD_TLV_NO_FIELD, NULL },
+};
+
+static size_t build(std::vector<uint8_t> &buf, std_tlv_tag_t tag_base) {
+    uint8_t peer[64];
+    size_t plen = sizeof(peer);
+    void *q = peer;
+    q = std_tlv_add_u64(q,&plen,tag_base+T_PEER_MAC,0xaabbccddeeffULL);
+    q = std_tlv_add_u32(q,&plen,tag_base+T_PEER_IFINDEX,99);
+    plen = sizeof(peer) - plen;
+
+    buf.assign(1024,0);
+    size_t left = buf.size();
+    void *p = &buf[0];
+    uint8_t admin = 1;
+    p = std_tlv_add(p,&left,tag_base+T_UNKNOWN,3,"xyz");
+    p = std_tlv_add(p,&left,tag_base+T_ADMIN,1,&admin);
+    p = std_tlv_add_u16(p,&left,tag_base+T_VLAN,100);
+    p = std_tlv_add_u32(p,&left,tag_base+T_IFINDEX,12);
+    p = std_tlv_add_u64(p,&left,tag_base+T_SPEED,25000000000ULL);
+    p = std_tlv_add(p,&left,tag_base+T_NAME,5,"eth0");
+    p = std_tlv_add(p,&left,tag_base+T_BLOB,7,"blob123");
+    p = std_tlv_add(p,&left,tag_base+T_PEER,plen,peer);
+    buf.resize(buf.size() - left);
+    return buf.size();
+}
+
+static void check_extract(std_tlv_tag_t tag_base) {
+    std::vector<std_tlv_field_t> pf(peer_fields,peer_fields+2);
+    for (auto &f : pf) f.tag += tag_base;
+    std_tlv_schema_t *peer = std_tlv_schema_create(&pf[0],pf.size());
+    ASSERT_TRUE(peer!=NULL);
+
+    std_tlv_field_t fields[] = {
+        /* not in tag order on purpose */
+        { tag_base+T_SPEED, STD_TLV_FIELD_U64, offsetof(test_obj_t,speed), 0, STD_TLV_NO_FIELD, NULL },
+        { tag_base+T_ADMIN, STD_TLV_FIELD_U8, offsetof(test_obj_t,admin), 0, STD_TLV_NO_FIELD, NULL },
+        { tag_base+T_VLAN, STD_TLV_FIELD_U16, offsetof(test_obj_t,vlan), 0, STD_TLV_NO_FIELD, NULL },
+        { tag_base+T_IFINDEX, STD_TLV_FIELD_U32, offsetof(test_obj_t,ifindex), 0, STD_TLV_NO_FIELD, NULL },
+        { tag_base+T_NAME, STD_TLV_FIELD_BYTES, offsetof(test_obj_t,name), sizeof(((test_obj_t*)0)->name),
+                offsetof(test_obj_t,name_len), NULL },
+        { tag_base+T_BLOB, STD_TLV_FIELD_PTR, offsetof(test_obj_t,blob), 0, offsetof(test_obj_t,blob_len), NULL },
+        { tag_base+T_PEER, STD_TLV_FIELD_NESTED, 0, 0, STD_TLV_NO_FIELD, peer },
+        { tag_base+50, STD_TLV_FIELD_U32, offsetof(test_obj_t,peer_ifindex), 0, STD_TLV_NO_FIELD, NULL },
+    };
+    std_tlv_schema_t *schema = std_tlv_schema_create(fields,8);
+    ASSERT_TRUE(schema!=NULL);
+
+    std::vector<uint8_t> buf;
+    size_t len = build(buf,tag_base);
+    test_obj_t obj;
+    memset(&obj,0,sizeof(obj));
+    bool found[8];
+    ASSERT_EQ(STD_ERR_OK,std_tlv_extract(schema,&buf[0],len,&obj,found));
+    ASSERT_EQ(1,obj.admin);
+    ASSERT_EQ(100,obj.vlan);
+    ASSERT_EQ(12,obj.ifindex);
+    ASSERT_EQ(25000000000ULL,obj.speed);
+    ASSERT_STREQ("eth0",obj.name);
+    ASSERT_EQ(5,obj.name_len);
+    ASSERT_EQ(7,obj.blob_len);
+    ASSERT_EQ(0,memcmp(obj.blob,"blob123",7));
+    ASSERT_EQ(99,obj.peer_ifindex);
+    ASSERT_EQ(0xaabbccddeeffULL,obj.peer_mac);
+    for (int ix = 0; ix < 7 ; ++ix) ASSERT_TRUE(found[ix]);
+    ASSERT_FALSE(found[7]);
+
+    /* a value of the wrong size */
+    std::vector<uint8_t> bad(64);
+    size_t left = bad.size();
+    std_tlv_add_u64(&bad[0],&left,tag_base+T_IFINDEX,1);
+    ASSERT_NE(STD_ERR_OK,std_tlv_extract(schema,&bad[0],bad.size()-left,&obj,NULL));
+    left = bad.size();
+    std_tlv_add(&bad[0],&left,tag_base+T_NAME,20,"01234567890123456789");
+    ASSERT_NE(STD_ERR_OK,std_tlv_extract(schema,&bad[0],bad.size()-left,&obj,NULL));
+    /* cut short */
+    ASSERT_NE(STD_ERR_OK,std_tlv_extract(schema,&buf[0],len-1,&obj,NULL));
+
+    std_tlv_schema_free(schema);
+    std_tlv_schema_free(peer);
+}
+
+TEST(std_tlv_schema, extract_small_tags) {
+    check_extract(0);
+}
+
+TEST(std_tlv_schema, extract_large_tags) {
+    check_extract(0x100000000ULL);
+}
+
+TEST(std_tlv_schema, duplicate_tag) {
+    std_tlv_field_t fields[] = {
+        { 1, STD_TLV_FIELD_U32, 0, 0, STD_TLV_NO_FIELD, NULL },
+        { 1, STD_TLV_FIELD_U64, 0, 0, STD_TLV_NO_FIELD, NULL },
+    };
+    ASSERT_TRUE(std_tlv_schema_create(fields,2)==NULL);
+}
+
+static bool nested_tag(void *context, std_tlv_tag_t tag) {
+    return tag == T_PEER;
+}
+
+TEST(std_tlv_schema, validate) {
+    std::vector<uint8_t> buf;
+    size_t len = build(buf,0);
+    ASSERT_EQ(STD_ERR_OK,std_tlv_validate(&buf[0],len,nested_tag,NULL));
+    ASSERT_EQ(STD_ERR_OK,std_tlv_validate(&buf[0],len,NULL,NULL));
+    ASSERT_EQ(STD_ERR_OK,std_tlv_validate(NULL,0,NULL,NULL));
+    ASSERT_NE(STD_ERR_OK,std_tlv_validate(&buf[0],len-1,NULL,NULL));
+    ASSERT_NE(STD_ERR_OK,std_tlv_validate(&buf[0],len+4,NULL,NULL));
+
+    /* walk it with the unchecked accessors */
+    size_t count = 0;
+    for (uint8_t *p = &buf[0]; p < &buf[0] + len; p = (uint8_t*)std_tlv_next_unchecked(p)) ++count;
+    ASSERT_EQ(8,count);
+
+    /* break the nested level only */
+    size_t rest = len;
+    void *peer = std_tlv_find_next(&buf[0],&rest,T_PEER);
+    std_tlv_set_len(std_tlv_data(peer),100);
+    ASSERT_EQ(STD_ERR_OK,std_tlv_validate(&buf[0],len,NULL,NULL));
+    ASSERT_NE(STD_ERR_OK,std_tlv_validate(&buf[0],len,nested_tag,NULL));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: std_tlv_varint_gtest.cpp
+ */
+
+#include "std_tlv_varint.h"
+
+#include <stdlib.h>
+#include "gtest/gtest.h"
+
+#include <vector>
+
+TEST(std_tlv_varint, varints) {
+    uint64_t vals[] = { 0, 1, 127, 128, 300, 16383, 16384, (1ULL<<35)+5,
+            (1ULL<<63), ~0ULL };
+    for (auto v : vals) {
+        uint8_t buf[STD_VTLV_VARINT_MAX];
+        size_t len = std_vtlv_put_varint(buf,v);
+        ASSERT_EQ(std_vtlv_varint_len(v),len);
+        uint64_t got = 0;
+        ASSERT_EQ(len,std_vtlv_get_varint(buf,len,&got));
+        ASSERT_EQ(v,got);
+        /* cut short */
+        ASSERT_EQ(0,std_vtlv_get_varint(buf,len-1,&got));
+    }
+    ASSERT_EQ(1,std_vtlv_varint_len(127));
+    ASSERT_EQ(10,std_vtlv_varint_len(~0ULL));
+
+    /* more than 64 bits */
+    uint8_t big[] = {0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x02};
+    uint64_t v;
+    ASSERT_EQ(0,std_vtlv_get_varint(big,sizeof(big),&v));
+    uint8_t longer[12];
+    memset(longer,0x80,sizeof(longer));
+    longer[11] = 0;
+    ASSERT_EQ(0,std_vtlv_get_varint(longer,sizeof(longer),&v));
+}
+
+TEST(std_tlv_varint, accessors) {
+    uint8_t buf[256];
+    size_t left = sizeof(buf);
+    void *p = std_vtlv_start(buf,&left);
+    p = std_vtlv_add(p,&left,0,6,"Cliff");
+    p = std_vtlv_add_u16(p,&left,1,1);
+    p = std_vtlv_add_u32(p,&left,200,0x12345678);
+    p = std_vtlv_add_u64(p,&left,~0ULL,3);
+    ASSERT_TRUE(p!=NULL);
+    size_t len = sizeof(buf) - left;
+    /* header bytes: 2 + 2 + 3 + 11 */
+    ASSERT_EQ(STD_VTLV_MAGIC_LEN + 18 + 6 + 2 + 4 + 8,len);
+
+    ASSERT_EQ(STD_TLV_FORMAT_VARINT,std_tlv_format(buf,len));
+    void *t = std_vtlv_first(buf,&len);
+    ASSERT_TRUE(t!=NULL);
+    ASSERT_EQ(0,std_vtlv_tag(t));
+    ASSERT_STREQ("Cliff",(char*)std_vtlv_data(t));
+    t = std_vtlv_next(t,&len);
+    ASSERT_EQ(1,std_vtlv_tag(t));
+    ASSERT_EQ(1,std_vtlv_data_u16(t));
+    t = std_vtlv_next(t,&len);
+    ASSERT_EQ(200,std_vtlv_tag(t));
+    ASSERT_EQ(4,std_vtlv_len(t));
+    ASSERT_EQ(0x12345678,std_vtlv_data_u32(t));
+    t = std_vtlv_next(t,&len);
+    ASSERT_EQ(~0ULL,std_vtlv_tag(t));
+    ASSERT_EQ(3,std_vtlv_data_u64(t));
+    ASSERT_EQ(std_vtlv_total_len(t),len);
+    t = std_vtlv_next(t,&len);
+    ASSERT_EQ(0,len);
+    ASSERT_FALSE(std_vtlv_valid(t,len));
+
+    /* no room */
+    left = 5;
+    ASSERT_TRUE(std_vtlv_add_u32(buf,&left,1,1)==NULL);
+}
+
+/* tags 100 and up hold nested TLVs */
+static bool nested_tag(void *context, std_tlv_tag_t tag) {
+    return tag >= 100;
+}
+
+static size_t build_fixed(std::vector<uint8_t> &buf) {
+    uint8_t inner[512], mid[1024];
+    size_t ilen = sizeof(inner), mlen = sizeof(mid);
+    void *q = inner;
+    for (int ix = 0; ix < 10 ; ++ix) q = std_tlv_add_u32(q,&ilen,ix,ix*3);
+    ilen = sizeof(inner) - ilen;
+    q = mid;
+    q = std_tlv_add_u64(q,&mlen,1,1);
+    q = std_tlv_add(q,&mlen,101,ilen,inner);
+    q = std_tlv_add(q,&mlen,5,0,NULL);
+    mlen = sizeof(mid) - mlen;
+
+    buf.assign(8192,0);
+    size_t left = buf.size();
+    void *p = &buf[0];
+    for (int ix = 0; ix < 100 ; ++ix) p = std_tlv_add_u32(p,&left,ix % 90,ix);
+    p = std_tlv_add(p,&left,100,mlen,mid);
+    /* a blob that looks like TLVs but isn't marked as nested */
+    p = std_tlv_add(p,&left,50,ilen,inner);
+    buf.resize(buf.size() - left);
+    return buf.size();
+}
+
+TEST(std_tlv_varint, convert) {
+    std::vector<uint8_t> fixed;
+    size_t flen = build_fixed(fixed);
+
+    size_t vlen = 0;
+    ASSERT_EQ(STD_ERR_OK,std_tlv_to_vtlv(&fixed[0],flen,NULL,&vlen,nested_tag,NULL));
+    ASSERT_LT(vlen * 2,flen);
+    std::vector<uint8_t> var(vlen);
+    size_t small = vlen - 1;
+    ASSERT_NE(STD_ERR_OK,std_tlv_to_vtlv(&fixed[0],flen,&var[0],&small,nested_tag,NULL));
+    ASSERT_EQ(STD_ERR_OK,std_tlv_to_vtlv(&fixed[0],flen,&var[0],&vlen,nested_tag,NULL));
+    ASSERT_EQ(var.size(),vlen);
+    ASSERT_EQ(STD_TLV_FORMAT_VARINT,std_tlv_format(&var[0],vlen));
+    ASSERT_EQ(STD_TLV_FORMAT_FIXED,std_tlv_format(&fixed[0],flen));
+
+    /* the same lookups give the same values */
+    std_tlv_tag_t paths[][3] = { {100,101,7}, {100,1,0}, {100,5,0}, {42,0,0}, {50,0,0}, {100,101,77} };
+    size_t plen[] = { 3, 2, 2, 1, 1, 3 };
+    for (size_t ix = 0; ix < sizeof(plen)/sizeof(plen[0]) ; ++ix) {
+        size_t fl = flen, vl = vlen;
+        void *f = std_tlv_efind(&fixed[0],&fl,paths[ix],plen[ix]);
+        void *first = std_vtlv_first(&var[0],&vl);
+        void *v = std_vtlv_efind(first,&vl,paths[ix],plen[ix]);
+        ASSERT_EQ(f==NULL,v==NULL);
+        if (f==NULL) continue;
+        ASSERT_EQ(std_tlv_len(f),std_vtlv_len(v));
+        ASSERT_EQ(0,memcmp(std_tlv_data(f),std_vtlv_data(v),std_tlv_len(f)));
+    }
+
+    /* and back again */
+    size_t back_len = 0;
+    ASSERT_EQ(STD_ERR_OK,std_vtlv_to_tlv(&var[0],vlen,NULL,&back_len,nested_tag,NULL));
+    ASSERT_EQ(flen,back_len);
+    std::vector<uint8_t> back(back_len);
+    ASSERT_EQ(STD_ERR_OK,std_vtlv_to_tlv(&var[0],vlen,&back[0],&back_len,nested_tag,NULL));
+    ASSERT_EQ(fixed,back);
+
+    /* without the nested callback the values are copied as they are */
+    size_t raw = 0;
+    ASSERT_EQ(STD_ERR_OK,std_tlv_to_vtlv(&fixed[0],flen,NULL,&raw,NULL,NULL));
+    ASSERT_GT(raw,vlen);
+}
+
+TEST(std_tlv_varint, convert_invalid) {
+    std::vector<uint8_t> fixed;
+    size_t flen = build_fixed(fixed);
+    size_t len = 0;
+
+    ASSERT_NE(STD_ERR_OK,std_tlv_to_vtlv(&fixed[0],flen-1,NULL,&len,nested_tag,NULL));
+    /* fixed data isn't a vtlv message */
+    ASSERT_NE(STD_ERR_OK,std_vtlv_to_tlv(&fixed[0],flen,NULL,&len,nested_tag,NULL));
+
+    len = 0;
+    ASSERT_EQ(STD_ERR_OK,std_tlv_to_vtlv(&fixed[0],flen,NULL,&len,nested_tag,NULL));
+    std::vector<uint8_t> var(len);
+    ASSERT_EQ(STD_ERR_OK,std_tlv_to_vtlv(&fixed[0],flen,&var[0],&len,nested_tag,NULL));
+    ASSERT_NE(STD_ERR_OK,std_vtlv_to_tlv(&var[0],len-1,NULL,&len,nested_tag,NULL));
+
+    /* a nested tag whose value isn't TLVs */
+    uint8_t buf[64];
+    size_t left = sizeof(buf);
+    std_tlv_add(buf,&left,100,3,"abc");
+    len = 0;
+    ASSERT_NE(STD_ERR_OK,std_tlv_to_vtlv(buf,sizeof(buf)-left,NULL,&len,nested_tag,NULL));
+    ASSERT_EQ(STD_ERR_OK,std_tlv_to_vtlv(buf,sizeof(buf)-left,NULL,&len,NULL,NULL));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}